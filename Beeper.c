@@ -0,0 +1,98 @@
+/*==============================================================================
+    Beeper. Interrupt driven tones from a queue of notes.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "CHRPMini.h"        // Include CHRPMini constant symbols and functions
+#include    "Beeper.h"          // Include beeper constants and functions
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+unsigned int anBeepHalf[BEEP_QUEUE_SIZE], anBeepMs[BEEP_QUEUE_SIZE];
+//anBeepHalf is the half period of each queued note in TMR3 ticks, 0 for a rest
+//anBeepMs is how long each queued note lasts
+volatile unsigned char cBeepHead, cBeepTail;
+//cBeepHead is written only by beeperPlay(), cBeepTail only by beeperTick()
+unsigned int nBeepHalf, nBeepLeft;
+//nBeepHalf is the half period playing now, nBeepLeft its remaining ms
+
+/*==============================================================================
+    BEEPER PLAY
+        Queues a note of hz for ms milliseconds (hz = BEEP_REST for a gap).
+        The note is written before the head moves on, so the tick never sees
+        half a note and no interrupts have to be turned off.
+==============================================================================*/
+bool beeperPlay(unsigned int hz, unsigned int ms) {
+    unsigned char cHead = cBeepHead;
+
+    if (((cHead + 1) & (BEEP_QUEUE_SIZE - 1)) == cBeepTail) {
+        return false; // Full
+    }
+    if (hz != BEEP_REST && hz < BEEP_MIN_HZ) {
+        hz = BEEP_MIN_HZ;
+    }
+    anBeepHalf[cHead] = (hz == BEEP_REST) ? 0 : (unsigned int) (BEEP_TIMER_HZ / 2 / hz);
+    anBeepMs[cHead] = ms;
+    cBeepHead = (cHead + 1) & (BEEP_QUEUE_SIZE - 1);
+    return true;
+}
+
+/*==============================================================================
+    BEEPER TICK
+        Counts down the note that is playing and starts the next one from
+        the queue. The beeper is left off when the queue runs out.
+==============================================================================*/
+void beeperTick(void) {
+    if (nBeepLeft != 0) {
+        nBeepLeft--;
+        return;
+    }
+    if (cBeepTail == cBeepHead) {
+        if (TMR3ON) {
+            TMR3ON = 0; // Nothing left to play
+            TMR3IE = 0;
+            BEEPER = 0;
+        }
+        return;
+    }
+    nBeepHalf = anBeepHalf[cBeepTail];
+    nBeepLeft = anBeepMs[cBeepTail] - 1; // This tick is the first ms
+    if (anBeepMs[cBeepTail] == 0) {
+        nBeepLeft = 0;
+    }
+    cBeepTail = (cBeepTail + 1) & (BEEP_QUEUE_SIZE - 1);
+    TMR3IE = (nBeepHalf != 0); // A rest keeps TMR3 running with the beeper off
+    BEEPER = 0;
+    TMR3IF = 1; // Start the note on the next interrupt
+    TMR3ON = 1;
+}
+
+/*==============================================================================
+    BEEPER ISR
+        Toggles the beeper and reloads TMR3 for the next half period.
+==============================================================================*/
+void beeperISR(void) {
+    unsigned int nCount = -nBeepHalf;
+
+    TMR3IF = 0;
+    TMR3H = (unsigned char) (nCount >> 8); // High byte is written with the low byte
+    TMR3L = (unsigned char) nCount;
+    BEEPER = !BEEPER;
+}
+
+/*==============================================================================
+    INIT BEEPER
+        Sets up TMR3 as a low priority interrupt, stopped until a note plays.
+==============================================================================*/
+void initBeeper(void) {
+    cBeepHead = 0;
+    cBeepTail = 0;
+    nBeepLeft = 0;
+    T3CON = 0b00110010; // FOSC/4, 1:8 prescaler, 16-bit writes, TMR3 off
+    TMR3IP = 0; // Low priority
+    TMR3IE = 0;
+    BEEPER = 0;
+}
@@ -0,0 +1,22 @@
+/*==============================================================================
+    Beeper (PIC18F25K50) symbolic constants and function prototypes.
+==============================================================================*/
+
+// Plays notes on the piezo beeper in the background. beeperPlay() puts a note
+// in a small queue and returns straight away. The TMR3 interrupt toggles
+// BEEPER every half period, and the 1ms tick (Tick.c) times each note and
+// starts the next one, so the main loop and servo frames carry on while a
+// sound plays. TMR3 runs from FOSC/4 through a 1:8 prescaler (1.5MHz).
+
+#define BEEP_QUEUE_SIZE     8           // Notes that can wait, power of 2
+#define BEEP_TIMER_HZ       1500000     // TMR3 clock
+#define BEEP_MIN_HZ         24          // Lowest pitch that fits in TMR3
+
+#define BEEP_HIGH           4000        // Hz, mode select and countdown beeps
+#define BEEP_LOW            2000        // Hz, mode confirmed and calibration done
+#define BEEP_REST           0           // Silence, for gaps in a melody
+
+bool beeperPlay(unsigned int hz, unsigned int ms); // Queue a note, false if the queue is full.
+void beeperTick(void); // Called every ms from the low priority ISR.
+void beeperISR(void); // TMR3 interrupt handler.
+void initBeeper(void); // Set up TMR3 for the beeper.
@@ -0,0 +1,229 @@
+/*==============================================================================
+    Flight recorder. Event and statistics records in a ring in data EEPROM.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "CHRPMini.h"        // Include CHRPMini constant symbols and functions
+#include    "Servo.h"           // Include servo engine constants and functions
+#include    "Sensors.h"         // Include sensor acquisition constants and functions
+#include    "Tick.h"            // Include system tick constants and functions
+#include    "Governor.h"        // Include governor constants and functions
+#include    "Blackbox.h"        // Include flight recorder constants and functions
+
+#if SERVO_EEPROM_ADDR + SERVO_EEPROM_SIZE > BLACKBOX_EEPROM_START
+#error "The servo trims run into the flight recorder ring"
+#endif
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+unsigned char acBlackboxQueue[BLACKBOX_QUEUE][BLACKBOX_RECORD_SIZE];
+unsigned char cBlackboxIn, cBlackboxOut, cBlackboxCount;
+//cBlackboxIn is the next free queue entry, cBlackboxOut the record being written
+//cBlackboxCount is the number of records queued
+unsigned char cBlackboxSlot, cBlackboxByte, cBlackboxSeq;
+//cBlackboxSlot is the ring slot the next record goes in
+//cBlackboxByte is the byte of it written last, cBlackboxSeq the next sequence number
+unsigned int nBlackboxSeconds, nBlackboxSecondMs, nBlackboxStatsTime;
+//nBlackboxSeconds is the time since the reset, counted at nBlackboxSecondMs
+//nBlackboxStatsTime is when the statistics were last looked at
+unsigned char cBlackboxFrame, cBlackboxMissed;
+bool isBlackboxFramed;
+//cBlackboxFrame is the low byte of nServoFrames at the last servo task
+//cBlackboxMissed counts servo frames missed, isBlackboxFramed is set after the first task
+unsigned int nBlackboxMinMv;
+unsigned char cBlackboxRails, cBlackboxRailsLogged, cBlackboxSags;
+bool isBlackboxSagging;
+//nBlackboxMinMv is the lowest supply, cBlackboxRails the sensors that reached a rail
+//cBlackboxRailsLogged is the rails in the last record, so a stuck sensor is logged once
+//cBlackboxSags counts supply sags, isBlackboxSagging is set until the supply recovers
+unsigned int nBlackboxDropped;
+
+/*==============================================================================
+    BLACKBOX READ SLOT
+        Reads a ring slot into record and checks it. True if it holds a
+        whole record.
+==============================================================================*/
+static bool blackboxReadSlot(unsigned char slot, unsigned char *record) {
+    unsigned char cAddr = BLACKBOX_EEPROM_START + slot * BLACKBOX_RECORD_SIZE, cSum = 0;
+
+    for (unsigned char i = 0; i < BLACKBOX_RECORD_SIZE; i++) {
+        record[i] = eepromRead(cAddr + i);
+        cSum += record[i];
+    }
+    return cSum == 0 && record[1] >= BLACKBOX_BOOT && record[1] <= BLACKBOX_STATS;
+}
+
+/*==============================================================================
+    BLACKBOX EVENT
+        Queues a record stamped with the time since the reset. If the queue
+        is full the record is dropped and counted in nBlackboxDropped.
+==============================================================================*/
+void blackboxEvent(unsigned char type, unsigned char a, unsigned char b, unsigned char c) {
+    unsigned char *record = acBlackboxQueue[cBlackboxIn], cSum;
+
+    if (cBlackboxCount == BLACKBOX_QUEUE) {
+        nBlackboxDropped++;
+        return;
+    }
+    record[0] = cBlackboxSeq++;
+    record[1] = type;
+    record[2] = (unsigned char) nBlackboxSeconds;
+    record[3] = (unsigned char) (nBlackboxSeconds >> 8);
+    record[4] = a;
+    record[5] = b;
+    record[6] = c;
+    cSum = 0;
+    for (unsigned char i = 0; i < BLACKBOX_RECORD_SIZE - 1; i++) {
+        cSum += record[i];
+    }
+    record[7] = -cSum;
+    cBlackboxIn = (cBlackboxIn + 1 == BLACKBOX_QUEUE) ? 0 : cBlackboxIn + 1;
+    cBlackboxCount++;
+}
+
+/*==============================================================================
+    BLACKBOX FRAME
+        Counts the servo frames that started since the last servo task, less
+        the one the task was for, as missed (the same test as profFrame()).
+==============================================================================*/
+void blackboxFrame(void) {
+    unsigned char cFrame = (unsigned char) nServoFrames, cMissed;
+
+    if (isBlackboxFramed) {
+        cMissed = (unsigned char) (cFrame - cBlackboxFrame);
+        if (cMissed > 1) {
+            cMissed--;
+            cBlackboxMissed = (cBlackboxMissed > 255 - cMissed) ? 255 : cBlackboxMissed + cMissed;
+        }
+    }
+    cBlackboxFrame = cFrame;
+    isBlackboxFramed = true;
+}
+
+/*==============================================================================
+    BLACKBOX WATCH
+        Keeps the lowest supply, counts sags below GOV_SAG_MV (a sag ends
+        when the supply is back over GOV_OK_MV, as in the governor) and
+        notes the flex sensors whose raw samples are at a rail.
+==============================================================================*/
+void blackboxWatch(unsigned int supplyMv, const volatile unsigned char *raw) {
+    unsigned char cRaw;
+
+    if (supplyMv < nBlackboxMinMv) {
+        nBlackboxMinMv = supplyMv;
+    }
+    if (supplyMv < GOV_SAG_MV) {
+        if (!isBlackboxSagging && cBlackboxSags < BLACKBOX_SAG_MAX) {
+            cBlackboxSags++;
+        }
+        isBlackboxSagging = true;
+    } else if (supplyMv > GOV_OK_MV) {
+        isBlackboxSagging = false;
+    }
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        cRaw = raw[i];
+        if (cRaw <= BLACKBOX_RAIL_LO || cRaw >= BLACKBOX_RAIL_HI) {
+            cBlackboxRails |= 1 << i;
+        }
+    }
+}
+
+/*==============================================================================
+    BLACKBOX STATS
+        Queues a statistics record if a frame was missed, the supply sagged
+        or a sensor reached a rail it was not at in the last record, and
+        starts counting again.
+==============================================================================*/
+static void blackboxStats(void) {
+    if (cBlackboxMissed != 0 || cBlackboxSags != 0 || (cBlackboxRails & ~cBlackboxRailsLogged) != 0) {
+        blackboxEvent(BLACKBOX_STATS, cBlackboxMissed,
+                (nBlackboxMinMv >= 255 * 20) ? 255 : (unsigned char) (nBlackboxMinMv / 20),
+                cBlackboxRails | (cBlackboxSags << BLACKBOX_SAG_SHIFT));
+    }
+    cBlackboxRailsLogged = cBlackboxRails;
+    cBlackboxMissed = 0;
+    cBlackboxSags = 0;
+    cBlackboxRails = 0;
+    nBlackboxMinMv = 0xFFFF;
+}
+
+/*==============================================================================
+    BLACKBOX SERVICE
+        Keeps the time in seconds, looks at the statistics every
+        BLACKBOX_STATS_S, and writes the next byte of the oldest queued
+        record if the EEPROM is idle. Bytes 1 to 7 are written first and the
+        sequence byte last, then the record is done and the next slot is used.
+==============================================================================*/
+void blackboxService(void) {
+    unsigned int nNow = millis();
+    unsigned char *record;
+
+    while ((unsigned int) (nNow - nBlackboxSecondMs) >= 1000) {
+        nBlackboxSecondMs += 1000;
+        nBlackboxSeconds++;
+    }
+    if ((unsigned int) (nBlackboxSeconds - nBlackboxStatsTime) >= BLACKBOX_STATS_S) {
+        nBlackboxStatsTime = nBlackboxSeconds;
+        blackboxStats();
+    }
+    if (cBlackboxCount == 0 || eepromBusy()) {
+        return;
+    }
+    record = acBlackboxQueue[cBlackboxOut];
+    cBlackboxByte = (cBlackboxByte + 1) & (BLACKBOX_RECORD_SIZE - 1);
+    eepromWrite(BLACKBOX_EEPROM_START + cBlackboxSlot * BLACKBOX_RECORD_SIZE + cBlackboxByte,
+            record[cBlackboxByte]);
+    if (cBlackboxByte == 0) {
+        cBlackboxSlot = (cBlackboxSlot + 1 == BLACKBOX_SLOTS) ? 0 : cBlackboxSlot + 1;
+        cBlackboxOut = (cBlackboxOut + 1 == BLACKBOX_QUEUE) ? 0 : cBlackboxOut + 1;
+        cBlackboxCount--;
+    }
+}
+
+/*==============================================================================
+    INIT BLACKBOX
+        Finds the newest whole record in the ring: of two sequence numbers
+        the newer one is less than half the range ahead, which always holds
+        as the ring is far shorter than that. The next record goes in the
+        slot after it. Then logs the reset, with reset from resetCause().
+==============================================================================*/
+void initBlackbox(unsigned char reset) {
+    unsigned char acRecord[BLACKBOX_RECORD_SIZE], cFound = 0, cNewest = 0;
+
+    for (unsigned char slot = 0; slot < BLACKBOX_SLOTS; slot++) {
+        if (!blackboxReadSlot(slot, acRecord)) {
+            continue;
+        }
+        if (cFound == 0 || (unsigned char) (acRecord[0] - cBlackboxSeq) < 128) {
+            cBlackboxSeq = acRecord[0];
+            cNewest = slot;
+        }
+        cFound++;
+    }
+    if (cFound == 0) {
+        cBlackboxSlot = 0;
+        cBlackboxSeq = 0;
+    } else {
+        cBlackboxSlot = (cNewest + 1 == BLACKBOX_SLOTS) ? 0 : cNewest + 1;
+        cBlackboxSeq++;
+    }
+    cBlackboxIn = 0;
+    cBlackboxOut = 0;
+    cBlackboxCount = 0;
+    cBlackboxByte = 0;
+    nBlackboxSeconds = 0;
+    nBlackboxSecondMs = millis();
+    nBlackboxStatsTime = 0;
+    isBlackboxFramed = false;
+    cBlackboxMissed = 0;
+    cBlackboxRailsLogged = 0;
+    cBlackboxSags = 0;
+    cBlackboxRails = 0;
+    isBlackboxSagging = false;
+    nBlackboxMinMv = 0xFFFF;
+    nBlackboxDropped = 0;
+    blackboxEvent(BLACKBOX_BOOT, reset, cFound, 0);
+}
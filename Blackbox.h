@@ -0,0 +1,74 @@
+/*==============================================================================
+    Flight recorder (PIC18F25K50) constants and function prototypes.
+==============================================================================*/
+
+// Keeps a log of what the hand went through in the top of the data EEPROM,
+// so a hand that misbehaved at a demo can be looked at afterwards: why it
+// was last reset (brownouts show up here), the modes it was put in, servo
+// frames the main loop missed, supply sags and flex sensors stuck at a rail.
+// Read the EEPROM out with a PICkit (MPLAB IPE, or the debugger's EEPROM
+// window exported as a hex file) and decode it with tools/blackbox_decode.c.
+//
+// Events (resets and mode changes) are logged as they happen. Everything else
+// is counted and logged as one statistics record every BLACKBOX_STATS_S, but
+// only if something went wrong in it, so a hand that runs well writes almost
+// nothing.
+//
+// Record format, BLACKBOX_RECORD_SIZE bytes:
+//     0       sequence        +1 per record, wraps. The newest record is the
+//                             one the next slot does not follow on from.
+//     1       type            BLACKBOX_BOOT, BLACKBOX_MODE or BLACKBOX_STATS
+//     2-3     time            seconds since the reset, low byte first
+//     4-6     data            see below
+//     7       checksum        bytes 0 to 7 add up to 0
+//
+//     BLACKBOX_BOOT   cause (RESET_ bits, CHRPMini.h), whole records found
+//                     in the ring at the reset, 0
+//     BLACKBOX_MODE   new mode, old mode, 0
+//     BLACKBOX_STATS  servo frames missed (up to 255), lowest supply in 20mV
+//                     steps, flex sensors that reached a rail (bits 0-4,
+//                     thumb to pinkie) + supply sags below GOV_SAG_MV x 32
+//                     (up to 7)
+//
+// Wear levelling. The records go round a ring of BLACKBOX_SLOTS slots and
+// there is no head pointer in EEPROM: initBlackbox() finds the newest record
+// from the sequence numbers. So every byte is written once per lap and no
+// byte is written more often than the others. With a statistics record
+// every BLACKBOX_STATS_S, non-stop, each byte is written every 180s and the
+// 100,000 write endurance of the data EEPROM lasts 208 days of running.
+// Events come on top of that. Under the tools/blackbox_bench load, which
+// adds a mode change every 30s and a reset about every 5 minutes, each byte
+// is written 26 times an hour and the EEPROM lasts 3890 hours (162 days).
+// Take that as the worst case. A record cut short by a power loss fails its checksum (all but
+// about 1 in 500 in the bench) and is written over. The sequence byte goes
+// in last, so half a record never looks newer than the last whole one.
+//
+// Records are queued in RAM and blackboxService() writes one byte each time
+// it finds the EEPROM idle. A byte takes about 4ms to write and the processor
+// keeps running meanwhile, so nothing ever waits on the EEPROM. A record is
+// stored 32ms after it is queued, and up to 31 records a second can be
+// stored. tools/blackbox_bench.c runs this code on a simulated EEPROM with
+// power cuts and reports the wear and throughput.
+
+#define BLACKBOX_EEPROM_START 0x70      // After the servo trims, for up to 16 servos
+#define BLACKBOX_RECORD_SIZE 8
+#define BLACKBOX_SLOTS      ((0x100 - BLACKBOX_EEPROM_START) / BLACKBOX_RECORD_SIZE) // 18
+#define BLACKBOX_QUEUE      4           // Records waiting to be written
+
+#define BLACKBOX_BOOT       0x01
+#define BLACKBOX_MODE       0x02
+#define BLACKBOX_STATS      0x03
+
+#define BLACKBOX_STATS_S    10          // Seconds between statistics records
+#define BLACKBOX_RAIL_LO    2           // Raw sensor samples at or below this are at a rail
+#define BLACKBOX_RAIL_HI    253         // and at or above this
+#define BLACKBOX_SAG_SHIFT  5           // Sag count position in the statistics byte
+#define BLACKBOX_SAG_MAX    7
+
+extern unsigned int nBlackboxDropped; // Records dropped because the queue was full
+
+void initBlackbox(unsigned char reset); // Find the newest record and log the reset cause.
+void blackboxEvent(unsigned char type, unsigned char a, unsigned char b, unsigned char c); // Queue a record.
+void blackboxFrame(void); // Count missed servo frames, call once per servo task.
+void blackboxWatch(unsigned int supplyMv, const volatile unsigned char *raw); // Watch the supply and sensors.
+void blackboxService(void); // Log statistics and write queued bytes, call every few ms.
@@ -0,0 +1,122 @@
+/*==============================================================================
+    Button events. S1 debounced in the 1ms tick, events queued for the tasks.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "CHRPMini.h"        // Include CHRPMini constant symbols and functions
+#include    "Button.h"          // Include button event constants and functions
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+unsigned char acButtonQueue[BUTTON_QUEUE_SIZE];
+volatile unsigned char cButtonHead, cButtonTail;
+//cButtonHead is written only by buttonTick(), cButtonTail only by buttonEvent()
+volatile unsigned char cButtonLost;
+unsigned char cButtonSteady;
+//cButtonSteady counts ms that S1 has differed from isButtonDown
+bool isButtonDown, isButtonLong;
+//isButtonDown is the debounced state, isButtonLong is set once BUTTON_LONG was sent
+unsigned int nButtonHeld, nButtonSinceClick;
+//nButtonHeld is how long the button has been down, nButtonSinceClick how long
+//since the last click ended (stops counting at BUTTON_DOUBLE_MS)
+bool isButtonDouble;
+//isButtonDouble is set when this press started soon enough to be a double click
+
+/*==============================================================================
+    BUTTON POST
+        Adds an event to the queue. The event is stored before the head moves
+        on, so buttonEvent() never reads a slot that is still being written.
+==============================================================================*/
+static void buttonPost(unsigned char event) {
+    unsigned char cNext = (cButtonHead + 1) & (BUTTON_QUEUE_SIZE - 1);
+
+    if (cNext == cButtonTail) {
+        cButtonLost++;
+        return;
+    }
+    acButtonQueue[cButtonHead] = event;
+    cButtonHead = cNext;
+}
+
+/*==============================================================================
+    BUTTON TICK
+        Debounces S1 (low when pressed) and times presses. A change has to
+        last BUTTON_DEBOUNCE_MS before it is believed.
+==============================================================================*/
+void buttonTick(void) {
+    bool isDown = (S1 == 0);
+
+    if (nButtonSinceClick < BUTTON_DOUBLE_MS) {
+        nButtonSinceClick++;
+    }
+    if (isButtonDown && nButtonHeld < BUTTON_LONG_MS) {
+        nButtonHeld++;
+        if (nButtonHeld == BUTTON_LONG_MS) {
+            isButtonLong = true;
+            buttonPost(BUTTON_LONG);
+        }
+    }
+
+    if (isDown == isButtonDown) {
+        cButtonSteady = 0;
+        return;
+    }
+    cButtonSteady++;
+    if (cButtonSteady < BUTTON_DEBOUNCE_MS) {
+        return;
+    }
+    cButtonSteady = 0;
+    isButtonDown = isDown;
+
+    if (isDown) { // Pressed
+        nButtonHeld = 0;
+        isButtonLong = false;
+        isButtonDouble = (nButtonSinceClick < BUTTON_DOUBLE_MS);
+        return;
+    }
+    if (!isButtonLong) { // Released
+        buttonPost(BUTTON_CLICK);
+        if (isButtonDouble) {
+            buttonPost(BUTTON_DOUBLE);
+            nButtonSinceClick = BUTTON_DOUBLE_MS; // A third click starts over
+        } else {
+            nButtonSinceClick = 0;
+        }
+    } else {
+        nButtonSinceClick = BUTTON_DOUBLE_MS;
+    }
+    buttonPost(BUTTON_RELEASE);
+}
+
+/*==============================================================================
+    BUTTON EVENT
+        Returns the oldest waiting event, or BUTTON_NONE.
+==============================================================================*/
+unsigned char buttonEvent(void) {
+    unsigned char cEvent;
+
+    if (cButtonTail == cButtonHead) {
+        return BUTTON_NONE;
+    }
+    cEvent = acButtonQueue[cButtonTail];
+    cButtonTail = (cButtonTail + 1) & (BUTTON_QUEUE_SIZE - 1);
+    return cEvent;
+}
+
+/*==============================================================================
+    INIT BUTTON
+==============================================================================*/
+void initButton(void) {
+    cButtonHead = 0;
+    cButtonTail = 0;
+    cButtonLost = 0;
+    cButtonSteady = 0;
+    isButtonDown = false;
+    isButtonLong = false;
+    isButtonDouble = false;
+    nButtonHeld = 0;
+    nButtonSinceClick = BUTTON_DOUBLE_MS;
+}
@@ -0,0 +1,34 @@
+/*==============================================================================
+    Button events (PIC18F25K50) symbolic constants and function prototypes.
+==============================================================================*/
+
+// S1 is sampled every millisecond from the tick (Tick.c) and debounced there,
+// so no press is missed however long the main loop tasks take. Each change
+// is turned into events that wait in a small queue for buttonEvent():
+//
+//     BUTTON_CLICK    released before BUTTON_LONG_MS
+//     BUTTON_DOUBLE   a second click that started within BUTTON_DOUBLE_MS of
+//                     the end of the first one (it follows its own CLICK)
+//     BUTTON_LONG     held for BUTTON_LONG_MS, sent while still held
+//     BUTTON_RELEASE  released, after any CLICK or DOUBLE
+//
+// A click is sent as soon as the button is let go rather than after the
+// double click window, so single clicks respond within BUTTON_DEBOUNCE_MS.
+// The queue has one writer (the tick) and one reader, so it needs no locks.
+
+#define BUTTON_DEBOUNCE_MS  5           // S1 must be steady this long to count
+#define BUTTON_LONG_MS      3000        // Hold to enter or leave mode select
+#define BUTTON_DOUBLE_MS    300         // Longest gap between double clicks
+#define BUTTON_QUEUE_SIZE   8           // Events that can wait, power of 2
+
+#define BUTTON_NONE         0
+#define BUTTON_CLICK        1
+#define BUTTON_DOUBLE       2
+#define BUTTON_LONG         3
+#define BUTTON_RELEASE      4
+
+extern volatile unsigned char cButtonLost; // Events dropped because the queue was full
+
+void initButton(void); // Start with the button up and the queue empty.
+void buttonTick(void); // Called every ms from the low priority ISR.
+unsigned char buttonEvent(void); // Take the oldest event, BUTTON_NONE if none.
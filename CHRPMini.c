@@ -38,7 +38,7 @@ void initPorts(void)
 	TRISC = 0b10110000;			// Set receive and transmit lines for IR
 								// demodulator U5 and LED11, servo outputs
 
-	T0CON = 0b10000001;			// Enable TMR0 as 16-bit, internal clock, /2
+	T0CON = 0b10000001;			// Enable TMR0 as 16-bit, internal clock, /4
 // Set starting I/O conditions.
 
 	PORTA = 0;					// Turn off all PORTA outputs, turn on run LED
@@ -57,4 +57,132 @@ void initANA(void)
 	ADCON1 = 0b00000000;		// VDD positive reference, VSS negative reference
 	ADCON2 = 0b00001110;		// 2TAD acquisition time, FOSC/64 conversion clock
 	TRISA = 0b00101111;			// Set runLED, IR LEDs as outputs in PORTA
+}
+
+// Read one byte of data EEPROM. Waits for any write in progress to finish.
+
+unsigned char eepromRead(unsigned char addr)
+{
+	while(WR);					// Wait for the last write to finish
+	EEADR = addr;				// Set the EEPROM address
+	EECON1 = 0b00000000;		// Access data EEPROM
+	RD = 1;						// Read the byte into EEDATA
+	return EEDATA;
+}
+
+// Write one byte of data EEPROM. Starts the write and returns; the write
+// completes by itself in about 4ms and the next read or write waits for it.
+
+void eepromWrite(unsigned char addr, unsigned char data)
+{
+	bool gie;
+
+	while(WR);					// Wait for the last write to finish
+	EEADR = addr;				// Set the EEPROM address
+	EEDATA = data;				// and the data to write
+	EECON1 = 0b00000100;		// Access data EEPROM, enable writes
+	gie = GIE;					// Interrupts must be off for the unlock sequence
+	GIE = 0;
+	EECON2 = 0x55;				// Unlock sequence
+	EECON2 = 0xAA;
+	WR = 1;						// Start the write
+	GIE = gie;
+	WREN = 0;					// Disable writes
+}
+
+// True while a data EEPROM write is still in progress. Lets a caller start
+// the next write only when eepromWrite() will not have to wait.
+
+bool eepromBusy(void)
+{
+	return WR;
+}
+
+// Work out why the processor was reset from the RCON and STKPTR flags, then
+// set the flags up again so the next reset can be told apart. Call once,
+// early in main(). Returns RESET_ bits (CHRPMini.h).
+
+unsigned char resetCause(void)
+{
+	unsigned char cause = 0;
+
+	if (!RCONbits.nPOR) {
+		cause |= RESET_POWER;	// nBOR is also cleared by a power-on reset
+	} else if (!RCONbits.nBOR) {
+		cause |= RESET_BROWNOUT;
+	}
+	if (!RCONbits.nTO) {
+		cause |= RESET_WATCHDOG;
+	}
+	if (!RCONbits.nRI) {
+		cause |= RESET_INSTRUCTION;
+	}
+	if (STKPTRbits.STKFUL || STKPTRbits.STKUNF) {
+		cause |= RESET_STACK;
+	}
+	if (cause == 0) {
+		cause = RESET_MCLR;		// None of the flags, so the reset pin
+	}
+	RCONbits.nPOR = 1;			// Set by software, cleared by the next reset
+	RCONbits.nBOR = 1;
+	RCONbits.nRI = 1;
+	STKPTRbits.STKFUL = 0;
+	STKPTRbits.STKUNF = 0;
+	return cause;
+}
+
+// Read one byte of program flash.
+
+unsigned char flashRead(unsigned int addr)
+{
+	TBLPTRU = 0;				// Flash is below 64kB
+	TBLPTRH = (unsigned char) (addr >> 8);
+	TBLPTRL = (unsigned char) addr;
+	asm("TBLRD*");				// Read the byte into TABLAT
+	return TABLAT;
+}
+
+// Erase one 64 byte block of program flash to 0xFF. The processor stops for
+// about 2ms while the block is erased, and interrupts wait until it is done.
+
+void flashErase(unsigned int addr)
+{
+	bool gie;
+
+	TBLPTRU = 0;
+	TBLPTRH = (unsigned char) (addr >> 8);
+	TBLPTRL = (unsigned char) addr & 0b11000000;
+	EECON1 = 0b10010100;		// Access flash, erase, enable writes
+	gie = GIE;					// Interrupts must be off for the unlock sequence
+	GIE = 0;
+	EECON2 = 0x55;				// Unlock sequence
+	EECON2 = 0xAA;
+	WR = 1;						// Erase, the processor stops until it is done
+	GIE = gie;
+	WREN = 0;					// Disable writes
+}
+
+// Write one 64 byte block of program flash. The block must be erased first.
+// The processor stops for about 2ms while the block is written.
+
+void flashWrite(unsigned int addr, const unsigned char *data)
+{
+	bool gie;
+
+	TBLPTRU = 0;
+	TBLPTRH = (unsigned char) (addr >> 8);
+	TBLPTRL = (unsigned char) addr & 0b11000000;
+	for (unsigned char i = 0; i < FLASHBLOCK; i++) {
+		TABLAT = data[i];		// Load the holding registers
+		asm("TBLWT*+");
+	}
+	asm("TBLRD*-");				// Point back inside the block
+	EECON1 = 0b10000100;		// Access flash, enable writes
+	gie = GIE;					// Interrupts must be off for the unlock sequence
+	GIE = 0;
+	EECON2 = 0x55;				// Unlock sequence
+	EECON2 = 0xAA;
+	WR = 1;						// Write, the processor stops until it is done
+	GIE = gie;
+	WREN = 0;					// Disable writes
 }
\ No newline at end of file
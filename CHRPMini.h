@@ -2,6 +2,8 @@
     CHRP 3.1 (PIC18F25K50) symbolic constant definitions.
 ==============================================================================*/
 
+#include    "Variant.h"         // Include the hand variant build options
+
 // TODO - Add other user constant definitions for CHRP3 hardware here.
 
 // Inputs read the Port registers (eg. RC0). Outputs write to the port latches
@@ -40,6 +42,13 @@
 #define H13         PORTBbits.RB2       // External I/O header H13 input 
 #define SERVOPINKIE LATBbits.LATB2      // Servo 1 output (external header H13)
 
+#define SERVOTHUMBMASK  0b10000000      // LATB bit mask for the thumb servo
+#define SERVOINDEXMASK  0b01000000      // LATB bit mask for the index servo
+#define SERVOMIDDLEMASK 0b00100000      // LATB bit mask for the middle servo
+#define SERVORINGMASK   0b00010000      // LATB bit mask for the ring servo
+#define SERVOPINKIEMASK 0b00000100      // LATB bit mask for the pinkie servo
+#define SERVOALLMASK    0b11110100      // LATB bit mask for all servos
+
 
 // PORTC I/O device definitions
 
@@ -61,6 +70,53 @@
 
 #define	ADVM		0b00010000		// Motor voltage divider A-D input channel (Ch4)
 #define ADTD		0b01110000		// PICmicro on-die temperature diode
+#define ADFVR		0b01111100		// Fixed voltage reference (FVR BUF2), for measuring VDD
+#define ADVREFP		0b00001100		// VREF+ pin RA3 (Ch3), for measuring an external reference
+
+// A-D positive references (ADCON1 PVCFG), negative reference always VSS
+
+#define ADREFVDD	0b00000000		// VDD
+#define ADREFEXT	0b00000100		// External VREF+ on RA3
+#define ADREFFVR	0b00001000		// Fixed voltage reference (FVR BUF2)
+
+// Hardware access used by the hand modules. Servo.c and Sensors.c reach the
+// servo port, servo timer and A-D converter only through these macros, and
+// Hand.c reads S1 and drives BEEPER through the pin names above. Porting the
+// firmware to other hardware, or to a register model on a PC, only needs
+// this block and the pin names redefined. A host build sets CHRP_HOST to a
+// header with its own versions of the block (tools/hand_sim.h). A loop that
+// spins until an ISR changes a variable calls ISRWAIT(), so such a model can
+// move its clock on to the next interrupt.
+
+#ifdef CHRP_HOST
+#include CHRP_HOST
+#else
+#define SERVOPORT           LATB        // Port latch holding the servo outputs
+#define SERVOPORT2          LATC        // Second servo port latch (SERVO_PORTC in Servo.h)
+#define SERVOTIMERREAD(n)   ((n) = TMR0L, (n) |= (unsigned int) TMR0H << 8) // Low byte first, it latches the high byte
+#define SERVOTIMERWRITE(n)  (TMR0H = (unsigned char) ((n) >> 8), TMR0L = (unsigned char) (n)) // High byte goes in with the low
+#define SERVOTIMERIF        TMR0IF      // Servo timer overflow flag
+#define SERVOTIMERIE        TMR0IE      // Servo timer interrupt enable
+#define ADCRESULT           ADRESH      // A-D result, upper 8-bits
+#define ADCRESULT10()       (((unsigned int) ADRESH << 2) | (ADRESL >> 6)) // Whole 10-bit result
+#define ADCSELECT(chan)     (ADCON0 = (ADCON0 & 0b10000011) | (chan))
+#define ADCREFERENCE(ref)   (ADCON1 = (ref)) // Select the positive reference
+#define ADCSTART()          (GO = 1)    // Start a conversion
+#define ISRWAIT()                       // Body of a loop waiting on an ISR, nothing on the PIC
+#endif
+
+// Program flash is erased and written in blocks of FLASHBLOCK bytes.
+
+#define FLASHBLOCK          64          // Flash erase/write block size
+
+// Reset causes returned by resetCause(), from the RCON and STKPTR flags.
+
+#define RESET_POWER         0x01        // Power-on reset
+#define RESET_BROWNOUT      0x02        // Brown-out reset, VDD fell below BORV
+#define RESET_WATCHDOG      0x04        // Watchdog timer time-out
+#define RESET_INSTRUCTION   0x08        // RESET instruction
+#define RESET_STACK         0x10        // Stack full or underflow (STVREN)
+#define RESET_MCLR          0x20        // None of the above, the MCLR pin
 
 // Clock frequency for delay macros and simulation
 
@@ -70,4 +126,11 @@
 
 void initOsc(void); // Oscillator initialization function prototype.
 void initPorts(void); // Port initialization function prototype.
-void initANA(void); // Analogue PORTA initialization function.
\ No newline at end of file
+void initANA(void); // Analogue PORTA initialization function.
+unsigned char eepromRead(unsigned char addr); // Data EEPROM byte read function.
+void eepromWrite(unsigned char addr, unsigned char data); // Data EEPROM byte write function.
+bool eepromBusy(void); // Data EEPROM write in progress function.
+unsigned char resetCause(void); // Reset cause (RESET_ bits) function.
+unsigned char flashRead(unsigned int addr); // Program flash byte read function.
+void flashErase(unsigned int addr); // Program flash 64 byte block erase function.
+void flashWrite(unsigned int addr, const unsigned char *data); // Program flash 64 byte block write function.
\ No newline at end of file
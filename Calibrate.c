@@ -0,0 +1,165 @@
+/*==============================================================================
+    Flex sensor calibration. Per finger range, EEPROM storage and lookup tables.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "CHRPMini.h"        // Include CHRPMini constant symbols and functions
+#include    "Calibrate.h"       // Include calibration constants and functions
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+unsigned char acCalLut[5][256];
+unsigned char acCalMin[5], acCalMax[5];
+//acCalMin is the raw sample of a fully bent finger, acCalMax of a straight one
+
+/*==============================================================================
+    CAL RESET
+        Starts recording a new range. The range starts inside out so the
+        first sample of each sensor sets both ends.
+==============================================================================*/
+void calReset(void) {
+    for (unsigned char i = 0; i < 5; i++) {
+        acCalMin[i] = 255;
+        acCalMax[i] = 0;
+    }
+}
+
+/*==============================================================================
+    CAL RECORD
+        Widens the range of one finger to include a raw sample.
+==============================================================================*/
+void calRecord(unsigned char finger, unsigned char raw) {
+    if (raw < acCalMin[finger]) {
+        acCalMin[finger] = raw;
+    }
+    if (raw > acCalMax[finger]) {
+        acCalMax[finger] = raw;
+    }
+}
+
+/*==============================================================================
+    CAL CHECKSUM
+        Two's complement of the byte sum of the range, so that the sum of the
+        whole record plus checksum is zero.
+==============================================================================*/
+static unsigned char calChecksum(void) {
+    unsigned char cSum = CAL_MAGIC;
+
+    for (unsigned char i = 0; i < 5; i++) {
+        cSum += acCalMin[i] + acCalMax[i];
+    }
+    return (unsigned char) -cSum;
+}
+
+/*==============================================================================
+    CAL LOAD
+        Loads the stored range from EEPROM. Returns false, and leaves an
+        empty range (plain 255 - raw tables), if there is no record or its
+        checksum is wrong.
+==============================================================================*/
+bool calLoad(void) {
+    unsigned char cAddr = CAL_EEPROM_ADDR;
+
+    if (eepromRead(cAddr++) == CAL_MAGIC) {
+        for (unsigned char i = 0; i < 5; i++) {
+            acCalMin[i] = eepromRead(cAddr++);
+            acCalMax[i] = eepromRead(cAddr++);
+        }
+        if (eepromRead(cAddr) == calChecksum()) {
+            return true;
+        }
+    }
+    calReset();
+    return false;
+}
+
+/*==============================================================================
+    CAL STORE
+        Stores the range in EEPROM. Each byte takes about 4ms to write, so
+        this is only called once, at the end of calibration.
+==============================================================================*/
+void calStore(void) {
+    unsigned char cAddr = CAL_EEPROM_ADDR;
+
+    eepromWrite(cAddr++, CAL_MAGIC);
+    for (unsigned char i = 0; i < 5; i++) {
+        eepromWrite(cAddr++, acCalMin[i]);
+        eepromWrite(cAddr++, acCalMax[i]);
+    }
+    eepromWrite(cAddr, calChecksum());
+}
+
+/*==============================================================================
+    CAL CURVE
+        The flex sensor is the bottom half of a voltage divider, so the raw
+        sample is 255 * Rs / (Rs + R). Bending the foam raises its conductance
+        about linearly, but the divider squashes that into the low end of the
+        A-D range. (255 - raw) / raw is proportional to the conductance, so it
+        undoes the divider. Scaled by 64 to keep the result in 16 bits.
+==============================================================================*/
+static unsigned int calCurve(unsigned char raw) {
+    if (raw == 0) {
+        raw = 1;
+    }
+#if CAL_LINEARIZE
+    return (unsigned int) (((unsigned long) (255 - raw) * 64) / raw);
+#else
+    return 255 - raw;
+#endif
+}
+
+/*==============================================================================
+    CAL BUILD LUTS
+        Fills each finger's table so that the straight finger sample (max)
+        gives position 0 and the bent finger sample (min) gives 255, with the
+        curve correction in between. Samples outside the range are clamped.
+        A finger whose range is too small keeps a plain 255 - raw table.
+==============================================================================*/
+void calBuildLuts(void) {
+    unsigned int nLow, nHigh, nValue;
+    unsigned char *lut;
+
+    for (unsigned char i = 0; i < 5; i++) {
+        lut = acCalLut[i];
+        if (acCalMax[i] < acCalMin[i] || acCalMax[i] - acCalMin[i] < CAL_MIN_SPAN) {
+            for (unsigned int raw = 0; raw < 256; raw++) {
+                lut[raw] = 255 - (unsigned char) raw;
+            }
+            continue;
+        }
+        nLow = calCurve(acCalMax[i]);
+        nHigh = calCurve(acCalMin[i]);
+        for (unsigned int raw = 0; raw < 256; raw++) {
+            if (raw <= acCalMin[i]) {
+                lut[raw] = 255;
+            } else if (raw >= acCalMax[i]) {
+                lut[raw] = 0;
+            } else {
+                nValue = calCurve((unsigned char) raw) - nLow;
+                lut[raw] = (unsigned char) (((unsigned long) nValue * 255) / (nHigh - nLow));
+            }
+        }
+    }
+}
+
+/*==============================================================================
+    CAL POSITION
+        Looks up a 16-bit filtered sample (Sensors.h): the upper byte picks
+        the table entry and the lower byte goes that far toward the next one.
+==============================================================================*/
+unsigned char calPosition(unsigned char finger, unsigned int fine) {
+    unsigned char cIndex = (unsigned char) (fine >> 8), cFrac = (unsigned char) fine;
+    unsigned char cLo = acCalLut[finger][cIndex], cHi;
+
+    if (cIndex == 255) {
+        return cLo;
+    }
+    cHi = acCalLut[finger][cIndex + 1];
+    if (cHi >= cLo) {
+        return cLo + (unsigned char) (((unsigned int) (cHi - cLo) * cFrac) >> 8);
+    }
+    return cLo - (unsigned char) (((unsigned int) (cLo - cHi) * cFrac) >> 8);
+}
@@ -0,0 +1,32 @@
+/*==============================================================================
+    Flex sensor calibration (PIC18F25K50) symbolic constants and prototypes.
+==============================================================================*/
+
+// Calibration records the lowest and highest raw sample of each flex sensor.
+// The range is stored in data EEPROM and turned into one 256 entry lookup
+// table per finger, which maps a raw sample straight to a servo position.
+
+// Data EEPROM layout of the stored calibration.
+
+#define CAL_EEPROM_ADDR     0x00        // First byte of the calibration record
+#define CAL_MAGIC           0xCA        // Marks a calibration record
+#define CAL_EEPROM_SIZE     (2 + 2 * 5) // Magic, min[5], max[5], checksum
+
+#define CAL_MIN_SPAN        16          // Smallest usable raw range of a sensor
+
+// Set CAL_LINEARIZE to 0 to stretch the raw range linearly instead of
+// correcting for the voltage divider.
+
+#ifndef CAL_LINEARIZE
+#define CAL_LINEARIZE       1
+#endif
+
+extern unsigned char acCalLut[5][256]; // Raw sample to servo position, per finger
+extern unsigned char acCalMin[5], acCalMax[5]; // Raw range of each sensor
+
+void calReset(void); // Start recording a new range.
+void calRecord(unsigned char finger, unsigned char raw); // Widen the range with a sample.
+bool calLoad(void); // Load the stored range, true if it was valid.
+void calStore(void); // Store the range in EEPROM.
+void calBuildLuts(void); // Turn the range into lookup tables.
+unsigned char calPosition(unsigned char finger, unsigned int fine); // Servo position of a 16-bit sample.
@@ -0,0 +1,130 @@
+/*==============================================================================
+    Glove pose classifier. Nearest gesture centroid in 8-bit fixed point.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "Sensors.h"         // Include sensor acquisition constants and functions
+#include    "Gesture.h"         // Include gesture engine constants and functions
+#include    "Classify.h"        // Include classifier constants and functions
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+unsigned char acClassPose[GESTURE_COUNT][SENSORCOUNT];
+unsigned char acClassScaled[GESTURE_COUNT][SENSORCOUNT];
+//acClassPose holds the gesture poses, acClassScaled the same divided by 2^CLASS_SHIFT
+unsigned char cClassMatch, cClassDist;
+
+/*==============================================================================
+    CLASS DISTANCE
+        L1 distance between two scaled poses, in 8 bits. Stops adding once
+        the sum reaches limit, as the caller has a nearer gesture already.
+==============================================================================*/
+static unsigned char classDistance(const unsigned char *scaled, const unsigned char *centroid,
+        unsigned char limit) {
+    unsigned char cSum = 0;
+
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        if (scaled[i] > centroid[i]) {
+            cSum += scaled[i] - centroid[i];
+        } else {
+            cSum += centroid[i] - scaled[i];
+        }
+        if (cSum >= limit) {
+            break;
+        }
+    }
+    return cSum;
+}
+
+/*==============================================================================
+    CLASSIFY POSE
+        Finds the nearest gesture with hysteresis, then pulls pos toward it
+        (CLASS_BLEND) or onto it. Returns the matched gesture or CLASS_NONE,
+        in which case pos is left alone.
+==============================================================================*/
+unsigned char classifyPose(unsigned char *pos) {
+    unsigned char acScaled[SENSORCOUNT], cBest = CLASS_NONE, cBestDist = 255, cDist, cLimit;
+    const unsigned char *centroid;
+
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        acScaled[i] = pos[i] >> CLASS_SHIFT;
+    }
+    if (cClassMatch != CLASS_NONE) { // Start from the current match
+        cBestDist = classDistance(acScaled, acClassScaled[cClassMatch], 255);
+        if (cBestDist <= CLASS_FAR_DIST + CLASS_HYSTERESIS) {
+            cBest = cClassMatch;
+        }
+    }
+    for (unsigned char g = 0; g < GESTURE_COUNT; g++) {
+        if (g == cClassMatch) {
+            continue;
+        }
+        if (cBest == cClassMatch && cBest != CLASS_NONE) {
+            cLimit = (cBestDist > CLASS_HYSTERESIS) ? cBestDist - CLASS_HYSTERESIS : 0;
+        } else {
+            cLimit = (cBestDist < CLASS_FAR_DIST + 1) ? cBestDist : CLASS_FAR_DIST + 1;
+        }
+        cDist = classDistance(acScaled, acClassScaled[g], cLimit);
+        if (cDist < cLimit) { // Nearer by enough to take over
+            cBest = g;
+            cBestDist = cDist;
+        }
+    }
+    cClassMatch = cBest;
+    cClassDist = cBestDist;
+    if (cBest == CLASS_NONE) {
+        return CLASS_NONE;
+    }
+
+    centroid = acClassPose[cBest];
+#if CLASS_BLEND
+    if (cBestDist > CLASS_SNAP_DIST) {
+        unsigned char cWeight;
+
+        if (cBestDist >= CLASS_FAR_DIST) {
+            return cBest; // Held by hysteresis only, no pull
+        }
+        cWeight = (CLASS_FAR_DIST - cBestDist) << 3; // 32 steps of 8, up to 248
+        for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+            if (centroid[i] > pos[i]) {
+                pos[i] += (unsigned char) (((unsigned int) (centroid[i] - pos[i]) * cWeight) >> 8);
+            } else {
+                pos[i] -= (unsigned char) (((unsigned int) (pos[i] - centroid[i]) * cWeight) >> 8);
+            }
+        }
+        return cBest;
+    }
+#endif
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        pos[i] = centroid[i];
+    }
+    return cBest;
+}
+
+/*==============================================================================
+    CLASSIFY RESET
+==============================================================================*/
+void classifyReset(void) {
+    cClassMatch = CLASS_NONE;
+    cClassDist = 255;
+}
+
+/*==============================================================================
+    INIT CLASSIFY
+        Copies the gesture poses out of flash, so the search reads RAM only.
+==============================================================================*/
+void initClassify(void) {
+    const unsigned char *pose;
+
+    for (unsigned char g = 0; g < GESTURE_COUNT; g++) {
+        pose = gesturePose(g);
+        for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+            acClassPose[g][i] = pose[i];
+            acClassScaled[g][i] = pose[i] >> CLASS_SHIFT;
+        }
+    }
+    classifyReset();
+}
@@ -0,0 +1,41 @@
+/*==============================================================================
+    Glove pose classifier (PIC18F25K50) constants and function prototypes.
+==============================================================================*/
+
+// Finds the stored gesture nearest to the glove pose and pulls the hand onto
+// it. The centroids are the first GESTURE_COUNT poses of the gesture library
+// (Gesture.c), copied into RAM at start up.
+//
+// Distance is the sum of the absolute finger differences (L1), worked out on
+// positions divided by 2^CLASS_SHIFT, so every value, difference and sum fits
+// in one byte (5 x 31 = 155) and the kernel is 8-bit subtracts and adds only.
+// The search stops early on a gesture once its sum passes the best so far.
+// Worst case is ~40 instruction cycles per gesture plus ~60 for the blend,
+// about 420 cycles (35us) for 9 gestures, well inside a control task period.
+// Build with PROFILE_ENABLE=1 to measure it (PROF_CLASSIFY).
+//
+// Hysteresis: the current gesture is kept until another one is nearer by at
+// least CLASS_HYSTERESIS, and until the pose is more than CLASS_FAR_DIST +
+// CLASS_HYSTERESIS from it. A new gesture is only taken within CLASS_FAR_DIST.
+//
+// CLASS_BLEND 1 pulls the pose toward the gesture by how near it is: fully
+// within CLASS_SNAP_DIST, not at all at CLASS_FAR_DIST. CLASS_BLEND 0 snaps
+// straight to the gesture whenever one is matched. The two distances are
+// 32 apart so the weight needs no division.
+
+#define CLASS_SHIFT         3           // Positions are compared in steps of 8
+#define CLASS_SNAP_DIST     8           // Up to here the hand snaps to the gesture
+#define CLASS_FAR_DIST      40          // Past here the glove pose is used as it is
+#define CLASS_HYSTERESIS    6           // Margin before the match changes
+#define CLASS_NONE          0xFF        // No gesture matched
+
+#ifndef CLASS_BLEND
+#define CLASS_BLEND         1
+#endif
+
+extern unsigned char cClassMatch; // Gesture matched by the last classifyPose(), or CLASS_NONE
+extern unsigned char cClassDist; // Its distance
+
+void initClassify(void); // Load the gesture centroids.
+void classifyReset(void); // Forget the current match.
+unsigned char classifyPose(unsigned char *pos); // Classify pos and pull it onto the match.
@@ -0,0 +1,143 @@
+/*==============================================================================
+    Pose constraint engine. Table driven rules projected onto the target pose.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "Constrain.h"       // Include constraint engine constants and functions
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+const rule_t *pConstrainRules;
+unsigned char cConstrainCount;
+//pConstrainRules is the rule table, cConstrainCount its length
+const rule_t *apConstrainActive[CONSTRAIN_MAX_RULES];
+unsigned char cConstrainActive, cConstrainMode;
+//apConstrainActive lists the rules of mode mask cConstrainMode, in table order
+
+/*==============================================================================
+    CONSTRAIN LIST
+        Lists the rules that apply in a mode mask, so the rules of other
+        modes are not looked at every frame.
+==============================================================================*/
+static void constrainList(unsigned char mode) {
+    const rule_t *rule = pConstrainRules;
+
+    cConstrainActive = 0;
+    for (unsigned char i = 0; i < cConstrainCount; i++, rule++) {
+        if (rule->cModes & mode) {
+            apConstrainActive[cConstrainActive++] = rule;
+        }
+    }
+    cConstrainMode = mode;
+}
+
+/*==============================================================================
+    RULE GAP
+        Moves fingers a and b halfway toward each other until they are no
+        more than lo apart.
+==============================================================================*/
+static void ruleGap(unsigned char *pos, const rule_t *rule) {
+    unsigned char cA = pos[rule->cA], cB = pos[rule->cB], cOver;
+
+    if (cA > cB) {
+        if (cA - cB > rule->cLo) {
+            cOver = cA - cB - rule->cLo;
+            pos[rule->cA] = cA - (cOver - (cOver >> 1)); // Odd step goes to a
+            pos[rule->cB] = cB + (cOver >> 1);
+        }
+    } else if (cB - cA > rule->cLo) {
+        cOver = cB - cA - rule->cLo;
+        pos[rule->cB] = cB - (cOver - (cOver >> 1));
+        pos[rule->cA] = cA + (cOver >> 1);
+    }
+}
+
+/*==============================================================================
+    RULE ZONE
+        Keeps a and b out of the corner where a is past lo and b is past hi,
+        by moving back whichever finger is nearer its edge.
+==============================================================================*/
+static void ruleZone(unsigned char *pos, const rule_t *rule) {
+    unsigned char cA = pos[rule->cA], cB = pos[rule->cB];
+
+    if (cA > rule->cLo && cB > rule->cHi) {
+        if (cA - rule->cLo <= cB - rule->cHi) {
+            pos[rule->cA] = rule->cLo;
+        } else {
+            pos[rule->cB] = rule->cHi;
+        }
+    }
+}
+
+/*==============================================================================
+    RULE ALONE
+        If finger a is more open than every other finger, bends it to the
+        most open of the others. Always looks at all five fingers, so the
+        cost is the same every frame.
+==============================================================================*/
+static void ruleAlone(unsigned char *pos, const rule_t *rule) {
+    unsigned char cMin = 255, cA = pos[rule->cA];
+
+    for (unsigned char i = 0; i < 5; i++) {
+        if (i != rule->cA && pos[i] < cMin) {
+            cMin = pos[i];
+        }
+    }
+    if (cA < cMin) {
+        pos[rule->cA] = cMin;
+    }
+}
+
+/*==============================================================================
+    CONSTRAIN POSE
+        Applies the rules of mode mask mode to a pose, in place. The rules
+        are run CONSTRAIN_PASSES times, so the work is fixed by the number of
+        rules in use and never depends on the pose.
+==============================================================================*/
+void constrainPose(unsigned char *pos, unsigned char mode) {
+    const rule_t *rule;
+    unsigned char cFinger;
+
+    if (mode != cConstrainMode) {
+        constrainList(mode);
+    }
+    for (unsigned char n = 0; n < CONSTRAIN_PASSES; n++) {
+        for (unsigned char i = 0; i < cConstrainActive; i++) {
+            rule = apConstrainActive[i];
+            switch (rule->cType) {
+                case RULE_RANGE:
+                    cFinger = pos[rule->cA];
+                    if (cFinger < rule->cLo) {
+                        pos[rule->cA] = rule->cLo;
+                    } else if (cFinger > rule->cHi) {
+                        pos[rule->cA] = rule->cHi;
+                    }
+                    break;
+                case RULE_GAP:
+                    ruleGap(pos, rule);
+                    break;
+                case RULE_ZONE:
+                    ruleZone(pos, rule);
+                    break;
+                default:
+                    ruleAlone(pos, rule);
+                    break;
+            }
+        }
+    }
+}
+
+/*==============================================================================
+    INIT CONSTRAIN
+        Uses a rule table. Tables longer than CONSTRAIN_MAX_RULES are cut
+        short. No mode is listed until the first constrainPose().
+==============================================================================*/
+void initConstrain(const rule_t *rules, unsigned char count) {
+    pConstrainRules = rules;
+    cConstrainCount = (count > CONSTRAIN_MAX_RULES) ? CONSTRAIN_MAX_RULES : count;
+    cConstrainActive = 0;
+    cConstrainMode = 0;
+}
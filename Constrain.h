@@ -0,0 +1,78 @@
+/*==============================================================================
+    Pose constraint engine (PIC18F25K50) symbolic constants and prototypes.
+==============================================================================*/
+
+// Keeps the pose sent to the servos out of shapes the hand should not make.
+// Each rule is one row of a table, checked in order once per servo frame on
+// the target pose just before the trajectory engine (pulseServos()). A rule
+// that is broken moves the fingers it names the least distance that puts it
+// right (a projection), so a pose that keeps to all the rules is never changed.
+//
+// Rule types, with their fields:
+//     RULE_RANGE   a, lo, hi       finger a stays within lo to hi
+//     RULE_GAP     a, b, lo        fingers a and b are never more than lo
+//                                  apart, eg. neighbours whose threads cross
+//                                  when one is bent far past the other. Both
+//                                  fingers move halfway toward each other.
+//     RULE_ZONE    a, b, lo, hi    a may not be past lo while b is past hi,
+//                                  eg. thumb and index closing into each
+//                                  other. Whichever finger is nearer its edge
+//                                  is moved back to it.
+//     RULE_ALONE   a               finger a may not be the only open finger
+//                                  (the old censorFinger()). It is bent to
+//                                  the most open of the others.
+//
+// Each rule has a mask of the modes it applies in (CONSTRAIN_MODE(n), and
+// CONSTRAIN_SELECT for the poses shown in mode select). The rules of the
+// mode in use are listed once when the mode changes, so rules that are off
+// cost nothing per frame.
+//
+// Fixing one rule can break one checked before it, so the table is run
+// CONSTRAIN_PASSES times and rules later in the table win. Put the rules
+// that protect the hardware (ranges) last. The per frame cost is bounded by
+// the number of rules in use: worst case instruction cycles per rule,
+// estimated from the PIC18 instruction sequences (1 cycle = 1/12us):
+//     RULE_RANGE   ~30
+//     RULE_GAP     ~60
+//     RULE_ZONE    ~50
+//     RULE_ALONE   ~90
+// plus ~20 a rule for the loop and table read. CONSTRAIN_MAX_RULES rules of
+// the dearest type, run twice, stay under 16 x 110 x 2 = 3520 cycles (293us)
+// of a 20ms frame. tools/constrain_bench.c runs the engine over random poses
+// and tables and reports the cost as rules are added.
+
+#include    "Variant.h"         // Include the hand variant build options
+
+#define RULE_RANGE          0
+#define RULE_GAP            1
+#define RULE_ZONE           2
+#define RULE_ALONE          3
+
+#define CONSTRAIN_MAX_RULES 16          // Longest rule table
+#define CONSTRAIN_PASSES    2           // Times the rules are run per frame
+
+#define CONSTRAIN_MODE(n)   (1 << (n))  // Mode mask bit of mode n (0-5)
+#define CONSTRAIN_SELECT    0x80        // Mode mask bit of the mode select poses
+#define CONSTRAIN_OFF       0           // Mode mask of a rule that is never used
+
+typedef struct {
+    unsigned char cType;                // RULE_ type
+    unsigned char cA, cB;               // Fingers the rule is about
+    unsigned char cLo, cHi;             // Limits, see the rule types
+    unsigned char cModes;               // Modes the rule applies in
+} rule_t;
+
+// The rule table. A variant can replace it (Variant.h). The default has only
+// the censor, in mode 0 where it used to run, if HAND_CENSOR is set.
+
+#ifndef HAND_CENSOR
+#define HAND_CENSOR         0           // 1 censors the middle finger in mode 0
+#endif
+
+#ifndef CONSTRAIN_RULES
+#define CONSTRAIN_RULES { \
+    {RULE_ALONE, 2, 0, 0, 0, HAND_CENSOR ? CONSTRAIN_MODE(0) : CONSTRAIN_OFF}}
+#endif
+
+void initConstrain(const rule_t *rules, unsigned char count); // Use a rule table.
+void constrainPose(unsigned char *pos, unsigned char mode); // Apply the rules of a mode mask.
@@ -0,0 +1,177 @@
+/*==============================================================================
+    Keyframe gesture engine. Plays flash-stored gestures in wall-clock time.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "Sensors.h"         // Include sensor acquisition constants and functions
+#include    "Tick.h"            // Include system tick constants and functions
+#include    "Gesture.h"         // Include gesture engine constants and functions
+
+/*==============================================================================
+    GESTURE LIBRARY
+        Each pose is thumb, index, middle, ring, pinkie. 0 is open, 255 closed.
+==============================================================================*/
+const unsigned char gOpen[] = {GKEY(300, 0, 0, 0, 0, 0), GEND};
+const unsigned char gFist[] = {GKEY(300, 255, 255, 255, 255, 255), GEND};
+const unsigned char gSpiderman[] = {GKEY(300, 0, 0, 255, 255, 0), GEND};
+const unsigned char gHangLoose[] = {GKEY(300, 0, 255, 255, 255, 0), GEND};
+const unsigned char gPeace[] = {GKEY(300, 200, 0, 0, 255, 255), GEND};
+const unsigned char gAOK[] = {GKEY(300, 200, 200, 0, 0, 0), GEND};
+const unsigned char gThumbsUp[] = {GKEY(300, 0, 255, 255, 255, 255), GEND};
+const unsigned char gPoint[] = {GKEY(300, 255, 0, 255, 255, 255), GEND};
+const unsigned char gRockOn[] = {GKEY(300, 255, 0, 255, 255, 0), GEND};
+const unsigned char gComeHere[] = {GKEY(200, 255, 0, 255, 255, 255), GMARK,
+    GKEY(1000, 255, 255, 255, 255, 255), GKEY(1000, 255, 0, 255, 255, 255),
+    GREPEAT(0), GEND};
+const unsigned char gCountFive[] = {GKEY(400, 255, 255, 255, 255, 255),
+    GKEY(500, 255, 0, 255, 255, 255), GKEY(500, 255, 0, 0, 255, 255),
+    GKEY(500, 255, 0, 0, 0, 255), GKEY(500, 255, 0, 0, 0, 0),
+    GKEY(500, 0, 0, 0, 0, 0), GKEY(1500, 0, 0, 0, 0, 0), GEND};
+const unsigned char gWave[] = {GKEY(300, 0, 0, 0, 0, 0), GMARK,
+    GKEY(150, 0, 0, 0, 0, 255), GKEY(150, 0, 0, 0, 255, 0),
+    GKEY(150, 0, 0, 255, 0, 0), GKEY(150, 0, 255, 0, 0, 0),
+    GKEY(150, 255, 0, 0, 0, 0), GKEY(150, 0, 0, 0, 0, 0),
+    GREPEAT(2), GEND};
+
+const unsigned char * const apGesture[] = {gOpen, gFist, gSpiderman,
+    gHangLoose, gPeace, gAOK, gThumbsUp, gPoint, gRockOn, gComeHere,
+    gCountFive, gWave};
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+const unsigned char *pGesture;
+//pGesture is the gesture playing, or 0 when stopped
+unsigned char cGestureNext, cGestureMark, cGestureRepeat;
+//cGestureNext is the offset of the next byte to run, cGestureMark the offset of
+//the last GMARK and cGestureRepeat the repeats left (255 while not counting)
+unsigned char acKeyFrom[SENSORCOUNT], acKeyTo[SENSORCOUNT];
+//acKeyFrom is the pose the keyframe started from, acKeyTo the pose it ends on
+unsigned int nKeyStart, nKeyTime;
+//nKeyStart is when the keyframe started and nKeyTime how long it lasts, in ms
+bool isGestureFirst;
+//isGestureFirst is true until the first update has taken the starting pose
+
+/*==============================================================================
+    GESTURE NEXT KEY
+        Runs the gesture from cGestureNext up to and including the next
+        keyframe. Returns false when the gesture has ended.
+==============================================================================*/
+static bool gestureNextKey(void) {
+    unsigned char cOp;
+
+    while (1) {
+        cOp = pGesture[cGestureNext];
+        if (cOp == GESTURE_OP_END) {
+            return false;
+        } else if (cOp == GESTURE_OP_MARK) {
+            cGestureNext++;
+            cGestureMark = cGestureNext;
+            cGestureRepeat = 255;
+        } else if (cOp == GESTURE_OP_REPEAT) {
+            if (cGestureRepeat == 255) {
+                cGestureRepeat = pGesture[cGestureNext + 1]; // First pass, load count
+            }
+            if (pGesture[cGestureNext + 1] == 0) {
+                cGestureNext = cGestureMark; // Repeat forever
+            } else if (cGestureRepeat != 0) {
+                cGestureRepeat--;
+                cGestureNext = cGestureMark;
+            } else {
+                cGestureRepeat = 255;
+                cGestureNext += 2;
+            }
+        } else {
+            nKeyTime = (cOp == 0) ? 10 : (unsigned int) cOp * 10; // Never zero
+            for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+                acKeyFrom[i] = acKeyTo[i];
+                acKeyTo[i] = pGesture[cGestureNext + 1 + i];
+            }
+            cGestureNext += 1 + SENSORCOUNT;
+            return true;
+        }
+    }
+}
+
+/*==============================================================================
+    GESTURE PLAY
+        Starts a gesture. The first keyframe moves from wherever the hand is
+        when gestureUpdate() is next called.
+==============================================================================*/
+void gesturePlay(unsigned char gesture) {
+    pGesture = apGesture[gesture];
+    cGestureNext = 0;
+    cGestureMark = 0;
+    cGestureRepeat = 255;
+    isGestureFirst = true;
+}
+
+/*==============================================================================
+    GESTURE STOP / GESTURE IS PLAYING
+==============================================================================*/
+void gestureStop(void) {
+    pGesture = 0;
+}
+
+bool gestureIsPlaying(void) {
+    return pGesture != 0;
+}
+
+/*==============================================================================
+    GESTURE UPDATE
+        Writes the pose for the current time into pos. Within a keyframe the
+        pose is interpolated by the fraction of its time that has passed,
+        worked out once as 0..255 so each finger needs one 8x8 multiply.
+        Keyframes whose time has fully passed are skipped, so playback keeps
+        to the clock even if the main loop stalls.
+==============================================================================*/
+void gestureUpdate(unsigned char *pos) {
+    unsigned int nNow, nElapsed, nFrac;
+
+    if (pGesture == 0) {
+        return;
+    }
+    nNow = millis();
+    if (isGestureFirst) {
+        isGestureFirst = false;
+        for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+            acKeyTo[i] = pos[i];
+        }
+        if (!gestureNextKey()) {
+            pGesture = 0;
+            return;
+        }
+        nKeyStart = nNow;
+    }
+    nElapsed = nNow - nKeyStart;
+    while (nElapsed >= nKeyTime) {
+        nKeyStart += nKeyTime;
+        nElapsed -= nKeyTime;
+        if (!gestureNextKey()) {
+            for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+                pos[i] = acKeyTo[i]; // Hold the last pose
+            }
+            pGesture = 0;
+            return;
+        }
+    }
+    nFrac = (unsigned int) (((unsigned long) nElapsed << 8) / nKeyTime);
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        if (acKeyTo[i] >= acKeyFrom[i]) {
+            pos[i] = acKeyFrom[i] + (unsigned char) (((acKeyTo[i] - acKeyFrom[i]) * nFrac) >> 8);
+        } else {
+            pos[i] = acKeyFrom[i] - (unsigned char) (((acKeyFrom[i] - acKeyTo[i]) * nFrac) >> 8);
+        }
+    }
+}
+
+/*==============================================================================
+    GESTURE POSE
+        Returns the pose of the first keyframe of a gesture (5 bytes in
+        flash). For the one keyframe gestures this is the whole gesture.
+==============================================================================*/
+const unsigned char *gesturePose(unsigned char gesture) {
+    return apGesture[gesture] + 1; // Skip the keyframe time
+}
@@ -0,0 +1,49 @@
+/*==============================================================================
+    Keyframe gesture engine (PIC18F25K50) constants and function prototypes.
+==============================================================================*/
+
+// Gestures are byte strings stored as const tables in program flash. Each
+// keyframe moves the hand from where it is to a new pose over a time in
+// milliseconds. Playback follows the millisecond tick, not the main loop.
+//
+//     GKEY(ms, thumb, index, middle, ring, pinkie)     6 bytes
+//         Move to the pose over ms (10 to 2390, in steps of 10ms).
+//     GMARK                                           1 byte
+//         Remember this place for GREPEAT.
+//     GREPEAT(n)                                      2 bytes
+//         Go back to the last GMARK n more times. 0 repeats forever.
+//     GEND                                            1 byte
+//         Hold the last pose. Every gesture must end with GEND.
+
+#define GESTURE_OP_MARK     0xFD
+#define GESTURE_OP_REPEAT   0xFE
+#define GESTURE_OP_END      0xFF
+#define GESTURE_MAX_TIME    0xEF        // Longest keyframe time, in 10ms units
+
+#define GKEY(ms, a, b, c, d, e) ((ms) / 10), (a), (b), (c), (d), (e)
+#define GMARK               GESTURE_OP_MARK
+#define GREPEAT(n)          GESTURE_OP_REPEAT, (n)
+#define GEND                GESTURE_OP_END
+
+// Gestures in the library, in the order the button steps through them.
+
+#define GESTURE_OPEN        0
+#define GESTURE_FIST        1
+#define GESTURE_SPIDERMAN   2
+#define GESTURE_HANGLOOSE   3
+#define GESTURE_PEACE       4
+#define GESTURE_AOK         5
+#define GESTURE_THUMBSUP    6
+#define GESTURE_POINT       7
+#define GESTURE_ROCKON      8
+#define GESTURE_COUNT       9           // Gestures stepped through by the button
+#define GESTURE_COMEHERE    9           // "come here", played in mode 2
+#define GESTURE_COUNTFIVE   10          // Count from one to five, then wait
+#define GESTURE_WAVE        11          // Ripple the fingers from pinkie to thumb
+#define GESTURE_TOTAL       12          // All gestures, including the looping ones
+
+void gesturePlay(unsigned char gesture); // Start a gesture from the pose in pos.
+void gestureStop(void); // Stop playing, the pose is left where it is.
+bool gestureIsPlaying(void); // True until a gesture reaches GEND.
+void gestureUpdate(unsigned char *pos); // Write the current gesture pose into pos.
+const unsigned char *gesturePose(unsigned char gesture); // First keyframe pose of a gesture.
@@ -0,0 +1,113 @@
+/*==============================================================================
+    Supply load governor. Limits finger motion while VDD sags.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "CHRPMini.h"        // Include CHRPMini constant symbols and functions
+#include    "Sensors.h"         // Include sensor acquisition constants and functions
+#include    "Servo.h"           // Include servo engine constants and functions
+#include    "Motion.h"          // Include trajectory engine constants and functions
+#include    "Governor.h"        // Include governor constants and functions
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+govStats_t sGovStats;
+unsigned int nGovSupplyMv, nGovBudget;
+unsigned char cGovSupply;
+bool isGovSagging;
+//isGovSagging is set while the supply is below GOV_SAG_MV, to count each sag once
+
+/*==============================================================================
+    GOVERNOR STATS
+        Adds one supply and temperature reading to the statistics. The sum
+        and count are halved together before they overflow, so the mean
+        leans toward recent readings.
+==============================================================================*/
+static void governorStats(unsigned int mv, unsigned char temp) {
+    if (mv < sGovStats.nMinMv) {
+        sGovStats.nMinMv = mv;
+    }
+    if (mv > sGovStats.nMaxMv) {
+        sGovStats.nMaxMv = mv;
+    }
+    if (sGovStats.nCount == 0xFFFF) {
+        sGovStats.nCount >>= 1;
+        sGovStats.lSumMv >>= 1;
+    }
+    sGovStats.lSumMv += mv;
+    sGovStats.nCount++;
+    if (temp < sGovStats.cTempMin) {
+        sGovStats.cTempMin = temp;
+    }
+    if (temp > sGovStats.cTempMax) {
+        sGovStats.cTempMax = temp;
+    }
+}
+
+/*==============================================================================
+    GOVERNOR RUN
+        Takes the lowest supply since the last run and sets the speed budget.
+==============================================================================*/
+void governorRun(void) {
+    unsigned int nPeak;
+    unsigned char cTemp;
+
+    GIEL = 0; // Two byte values written by the A-D ISR
+    nPeak = nAdcSupplyPeak;
+    nAdcSupplyPeak = nAdcSupply;
+    cTemp = cAdcTemp;
+    GIEL = 1;
+    if (nPeak == 0) {
+        return; // No conversion yet
+    }
+    nGovSupplyMv = (unsigned int) ((unsigned long) GOV_FVR_MV * 1024 / nPeak);
+    cGovSupply = (nGovSupplyMv >= 255 * 20) ? 255 : (unsigned char) (nGovSupplyMv / 20);
+    governorStats(nGovSupplyMv, cTemp);
+
+    if (nGovSupplyMv < GOV_LOW_MV) {
+        nGovBudget = GOV_MIN_BUDGET;
+    } else if (nGovSupplyMv < GOV_SAG_MV) {
+        if (nGovBudget > MOTION_SPEED_BUDGET / 2) {
+            nGovBudget = MOTION_SPEED_BUDGET / 2;
+        }
+    } else if (nGovSupplyMv > GOV_OK_MV && nGovBudget < MOTION_SPEED_BUDGET) {
+        nGovBudget += GOV_RECOVER_STEP;
+        if (nGovBudget > MOTION_SPEED_BUDGET) {
+            nGovBudget = MOTION_SPEED_BUDGET;
+        }
+    }
+    if (nGovSupplyMv < GOV_SAG_MV) {
+        if (!isGovSagging) {
+            sGovStats.nSags++;
+        }
+        isGovSagging = true;
+    } else {
+        isGovSagging = false;
+    }
+    if (nGovBudget < MOTION_SPEED_BUDGET) {
+        sGovStats.nLimitedRuns++;
+    }
+    motionSetBudget(nGovBudget);
+}
+
+/*==============================================================================
+    INIT GOVERNOR
+==============================================================================*/
+void initGovernor(void) {
+    sGovStats.nMinMv = 0xFFFF;
+    sGovStats.nMaxMv = 0;
+    sGovStats.lSumMv = 0;
+    sGovStats.nCount = 0;
+    sGovStats.cTempMin = 255;
+    sGovStats.cTempMax = 0;
+    sGovStats.nSags = 0;
+    sGovStats.nLimitedRuns = 0;
+    nGovSupplyMv = 0;
+    cGovSupply = 0;
+    nGovBudget = MOTION_SPEED_BUDGET;
+    isGovSagging = false;
+    motionSetBudget(nGovBudget);
+}
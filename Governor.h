@@ -0,0 +1,44 @@
+/*==============================================================================
+    Supply load governor (PIC18F25K50) constants and function prototypes.
+==============================================================================*/
+
+// Five SG90s starting together can pull the 5V rail down far enough to reset
+// the board. The governor watches VDD (measured in the extra A-D slot, see
+// Sensors.h) and shrinks the trajectory engine's speed budget (Motion.h)
+// when it sags, so fingers take turns speeding up instead of all at once:
+//
+//     below GOV_SAG_MV    budget cut to half
+//     below GOV_LOW_MV    budget cut to one finger at full speed (staggered)
+//     above GOV_OK_MV     budget grows back by GOV_RECOVER_STEP per run
+//
+// The lowest VDD since the last run is used, so a sag between runs is
+// still seen. VDD = ADC_FVR_MV x 1024 / result, worked out with one division.
+//
+// Supply and temperature statistics are kept in sGovStats (debugger watch
+// window) and the supply and temperature go out in every telemetry frame.
+// The temperature diode is logged as the raw 8-bit sample; it is not
+// calibrated, so only changes in it mean anything.
+
+#define GOV_FVR_MV          ADC_FVR_MV  // Fixed reference voltage (Sensors.h)
+#define GOV_SAG_MV          4500        // Start limiting below this
+#define GOV_LOW_MV          4300        // One finger at a time below this
+#define GOV_OK_MV           4700        // Recover above this
+#define GOV_MIN_BUDGET      272         // One finger at MOTION_VMAX
+#define GOV_RECOVER_STEP    (MOTION_SPEED_BUDGET / 16)
+
+typedef struct {
+    unsigned int nMinMv, nMaxMv;        // Lowest and highest supply seen
+    unsigned long lSumMv;               // Total of supply readings
+    unsigned int nCount;                // Number of readings (mean = lSumMv / nCount)
+    unsigned char cTempMin, cTempMax;   // Range of the temperature diode samples
+    unsigned int nSags;                 // Times the supply fell below GOV_SAG_MV
+    unsigned int nLimitedRuns;          // Runs with the budget below full
+} govStats_t;
+
+extern govStats_t sGovStats; // Supply and temperature statistics
+extern unsigned int nGovSupplyMv; // Lowest supply in the last run, in mV
+extern unsigned char cGovSupply; // The same in 20mV steps, one byte for telemetry
+extern unsigned int nGovBudget; // Speed budget handed to the trajectory engine
+
+void initGovernor(void); // Start with the full budget and clear the statistics.
+void governorRun(void); // Check the supply and set the budget, call every few ms.
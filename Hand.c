@@ -9,8 +9,28 @@
 #include    "stdint.h"          // Include integer definitions
 #include    "stdbool.h"         // Include Boolean (true/false) definitions
 #include    "CHRPMini.h"        // Include CHRPMini constant symbols and functions
+#include    "Servo.h"           // Include servo engine constants and functions
+#include    "Sensors.h"         // Include sensor acquisition constants and functions
+#include    "Calibrate.h"       // Include calibration constants and functions
+#include    "Profile.h"         // Include frame timing instrumentation
+#include    "Motion.h"          // Include trajectory engine constants and functions
+#include    "Tick.h"            // Include system tick constants and functions
+#include    "Gesture.h"         // Include gesture engine constants and functions
+#include    "Record.h"          // Include recorder constants and functions
+#include    "Telemetry.h"       // Include telemetry constants and functions
+#include    "Remote.h"          // Include remote channel constants and functions
+#include    "Beeper.h"          // Include beeper constants and functions
+#include    "Sched.h"           // Include scheduler constants and functions
+#include    "Button.h"          // Include button event constants and functions
+#include    "Classify.h"        // Include classifier constants and functions
+#include    "Predict.h"         // Include predictor constants and functions
+#include    "Power.h"           // Include power management constants and functions
+#include    "Governor.h"        // Include governor constants and functions
+#include    "Constrain.h"       // Include constraint engine constants and functions
+#include    "Blackbox.h"        // Include flight recorder constants and functions
 
-// Have set linker ROM ranges to 'default,-0-1FFF,-2006-2007,-2016-2017' under "Memory model" pull-down.
+// Have set linker ROM ranges to 'default,-0-1FFF,-2006-2007,-2016-2017,-6000-6FFF' under "Memory model" pull-down.
+// (6000-6FFF is kept free for glove recordings, see Record.h)
 // Have set linker Code offset to '0x2000' under "Additional options" pull-down.
 
 /*==============================================================================
@@ -22,20 +42,43 @@
 #define RING            3
 #define PINKIE          4
 
+/*==============================================================================
+    Timing, all in milliseconds of the system tick (Tick.c)
+==============================================================================*/
+#define SERVO_TASK_MS       (SERVO_FRAME_US / 1000) // New pose once per servo frame
+#define RECORD_TASK_MS      1           // Look for a flash write gap
+#define GOVERNOR_TASK_MS    5           // Watch the supply and limit motion
+#define CONTROL_TASK_MS     5           // Sensors, gestures, recording and playback
+#define UI_TASK_MS          5           // Button events and remote commands
+#define BLACKBOX_TASK_MS    2           // Flight recorder, one EEPROM byte at a time
+#define CALIBRATION_MS      10000       // Length of sensor calibration
+#define CALIBRATION_BEEP_MS 1000        // Countdown beep period during calibration
+
+/*==============================================================================
+    Mode 0 mirroring, stepped through by double clicking
+==============================================================================*/
+#define MIRROR_PREDICT      0           // Follow the glove a horizon ahead
+#define MIRROR_SNAP         1           // Snap to the nearest gesture
+#define MIRROR_MEASURE      2           // Follow the glove and measure the delay
+
 /*==============================================================================
     VARIABLES
 ==============================================================================*/
-unsigned char arcPos[5], arcMaxBendPos[5] = {255, 255, 255, 255, 255}; //Position for each finger. 0 represents open. 255 means fully closed.
-unsigned char cMode, cDelay, cGesture, cCountFingerCycle, cCycleIncrement;
+unsigned char arcPos[5]; //Position for each finger. 0 represents open. 255 means fully closed.
+unsigned char arcServoPos[5]; //Position sent to the servos, moving toward arcPos at a limited speed
+unsigned char arcGlovePos[5]; //Calibrated glove pose, as convertSensors() found it, for telemetry
+unsigned char cMode, cGesture;
 //cMode is the mode the hand is in. i.e, decides what the hand will do
-//cDelay is for counting duration when mode select button is held 
 //cGesture is for the command number
-//cCountFingerCycle and cCycleIncrement are used in creating the "come here" gesture
-bool modeSelect, isPressedForMode, isPressedForGesture, buttonWasLetGo, calibMode;
-// the above variables are needed to properly navigate mode selection, calibration, and gesture cycling
-int nDelay, nCalibrationCounter;
-//nDelay is for keeping track of the proper delay to pulse servos every 20ms
-//nCalibrationCounter is for having the calibration mode on for only 10 seconds/beeps.
+bool modeSelect, calibMode;
+// the above variables are needed to properly navigate mode selection and calibration
+unsigned char cMirror;
+//cMirror is how mode 0 follows the glove, one of the MIRROR_ values
+const rule_t asRules[] = CONSTRAIN_RULES;
+//asRules is the pose rule table, the censor unless the variant has its own
+unsigned int nCalibrationStart, nCalibrationBeep;
+//nCalibrationStart is when calibration started, for having it on for only 10 seconds/beeps.
+//nCalibrationBeep is the time of the next countdown beep, counted from nCalibrationStart
 
 /*==============================================================================
     SET POS
@@ -53,18 +96,6 @@ void setPos(unsigned char a, unsigned char b, unsigned char c, unsigned char d,
     arcPos[PINKIE] = e;
 }
 
-/*==============================================================================
-    BEEP
-        A generic beep function. Used in other parts of the code so that 
-        we can tell what mode it is in.
-==============================================================================*/
-void beep(unsigned int pitch, unsigned int duration) {
-    for (duration; duration != 0; duration--) {
-        BEEPER = !BEEPER;
-        for (unsigned int j = pitch; j != 0; j--);
-    }
-}
-
 /*==============================================================================
     INIT VARIABLES
         A function to set starting values for each variable.
@@ -74,217 +105,185 @@ void beep(unsigned int pitch, unsigned int duration) {
 void initVariables() {
     setPos(0, 0, 0, 0, 0); // starting position of servos is an open hand.
     modeSelect = false;
-    isPressedForMode = false;
-    isPressedForGesture = false;
-    buttonWasLetGo = true;
     calibMode = false;
+    cMirror = MIRROR_PREDICT;
     cMode = 0;
-    cDelay = 0;
-    cCountFingerCycle = 5;
-    cCycleIncrement = 5;
-    nCalibrationCounter = 0;
+    nCalibrationStart = 0;
+    nCalibrationBeep = 0;
 }
 
 /*==============================================================================
-    AD CONVERT
-        A/D conversion function. Pass the channel to be converted using one of the
-        definitions in CHRP3.h. Returns the most significant 8-bits of the result.
+    START CALIBRATION
+        Starts recording a new range for every sensor. calibrate() ends it
+        CALIBRATION_MS later.
 ==============================================================================*/
-unsigned char adConvert(unsigned char chan) {
-    ADON = 1; // Turn A-D converter on
-    ADCON0 = (ADCON0 & 0b11000011); // Change the conversion channel by wiping
-    ADCON0 = (ADCON0 | chan); // CHS bits and ORing with selected channel
-
-    NOP(); // Wait to allow the input to stabilize
-    NOP(); // NOPE
-    NOP();
-    NOP();
+void startCalibration() {
+    calibMode = true;
+    calReset(); // Record a new range
+    nCalibrationStart = millis();
+    nCalibrationBeep = CALIBRATION_BEEP_MS;
+}
 
-    GO = 1; // Start the conversion
+/*==============================================================================
+    ENTER MODE
+        Gets a mode ready to run, after it has been picked in mode select or
+        sent by the remote peer.
+==============================================================================*/
+void enterMode(unsigned char mode) {
+    blackboxEvent(BLACKBOX_MODE, mode, cMode, 0); // cMode is still the old mode
+    if (mode == 0) {
+        startCalibration();
+    } else {
+        calibMode = false;
+    }
+    gestureStop();
+    recordStop();
+    if (mode == 3) {
+        recordStart();
+    } else if (mode == 4) {
+        playStart();
+    }
+    setPos(0, 0, 0, 0, 0); //Straighten all fingers
+}
 
-    while (GO); // Wait for the conversion to finish
+/*==============================================================================
+    NEXT GESTURE
+        Called on each click in mode 1.
+        We are able to still change the gesture using the same button
+        because entering mode select requires the user to hold the button 
+        for BUTTON_LONG_MS, and a long press is never also a click.
+==============================================================================*/
+void nextGesture() {
+    cGesture++;
+    if (cGesture == GESTURE_COUNT)cGesture = 0;
+    gesturePlay(cGesture);
+}
 
-    ADON = 0; // Turn A-D converter off
-    return (ADRESH); // Return the upper 8-bits of the result
+/*==============================================================================
+    SHOW MODE
+        Bend the finger that is equal to the mode; Straighten all the others.
+==============================================================================*/
+void showMode(unsigned char mode) {
+    for (unsigned char i = 0; i < 5; i++) {
+        arcPos[i] = (mode == i) ? 255 : 0;
+    }
 }
 
 /*==============================================================================
     CHECK MODE 
-        Function to check if the mode needs to change
-        If S1 is held, go into mode select. Each time S1 is pressed, switch mode.
+        Function to check if the mode needs to change, from the button
+        events of Button.c.
+        If S1 is held, go into mode select. Each time S1 is clicked, switch mode.
         Confirm mode, and leave mode select by holding S1 again.
+        Outside mode select a click changes the gesture in mode 1, a double
+        click steps mode 0 through prediction, gesture snapping and delay
+        measurement, and starts the recording or the playback again in
+        modes 3 and 4.
 ==============================================================================*/
 unsigned char checkMode() {
-    unsigned char cTempMode = cMode;
-    if (S1 == 0) {
-        isPressedForMode = true;
-        if (!modeSelect && buttonWasLetGo) { // user is holding button to enter mode selection
-            cDelay++;
-            if (cDelay == 20) {
-                cDelay = 0;
-                modeSelect = true;
-                buttonWasLetGo = false;
-                isPressedForMode = false;
-                beep(200, 500);
-                for (unsigned char i = 0; i < 5; i++) {
-                    arcPos[i] = (cTempMode == i) ? 255 : 0; // Bend the finger that is equal to the mode; Straighten all the others.
-                }
-            }
-        } else if (buttonWasLetGo) {
-            cDelay++;
-            if (cDelay == 20) { // user is holding to leave mode select
-                cDelay = 0;
-                modeSelect = false;
-                buttonWasLetGo = false;
-                isPressedForMode = false;
-                beep(400, 500);
-                //cTempMode--; // to compensate for the cTempMode++ some lines below
-                if (cTempMode == 0) {
-                    calibMode = true;
-                } else {
-                    calibMode = false;
-                }
-                setPos(0, 0, 0, 0, 0); //Straighten all fingers
-            }// else { // user has pressed the button to change the mode
-
-            //}
-        }
-    }
+    unsigned char cTempMode = cMode, cEvent;
 
-    if (S1 == 1) { // mode is changed after the button is let go. This is done so that the user is able to leave mode select.
-        if (buttonWasLetGo && isPressedForMode && modeSelect) {
+    while ((cEvent = buttonEvent()) != BUTTON_NONE) {
+        if (cEvent == BUTTON_LONG && !modeSelect) { // user has held the button to enter mode selection
+            modeSelect = true;
+            recordStop(); // Finish any recording in progress
+            beeperPlay(BEEP_HIGH, 60);
+            PROF_REPORT(); // Blink the overrun count when profiling
+            showMode(cTempMode);
+        } else if (cEvent == BUTTON_LONG) { // user has held the button to leave mode select
+            modeSelect = false;
+            beeperPlay(BEEP_LOW, 120);
+            enterMode(cTempMode);
+        } else if (cEvent == BUTTON_CLICK && modeSelect) { // mode changes on each click
             cTempMode++;
-            if (cTempMode == 5) {
+            if (cTempMode >= 5) { // MODE_REMOTE is only entered from the remote peer
                 cTempMode = 0;
             }
-            for (unsigned char i = 0; i < 5; i++) {
-                arcPos[i] = (cTempMode == i) ? 255 : 0; // Bend the finger that is equal to the mode; Straighten all the others.
+            showMode(cTempMode);
+        } else if (cEvent == BUTTON_CLICK && cTempMode == 1) {
+            nextGesture();
+        } else if (cEvent == BUTTON_DOUBLE && !modeSelect && cTempMode == 0 && !calibMode) {
+            cMirror = (cMirror == MIRROR_MEASURE) ? MIRROR_PREDICT : cMirror + 1;
+            classifyReset();
+            predictReset(arcPos);
+            predictMeasureStart();
+            beeperPlay(cMirror == MIRROR_PREDICT ? BEEP_LOW : BEEP_HIGH, 60);
+            if (cMirror == MIRROR_MEASURE) {
+                beeperPlay(BEEP_REST, 60);
+                beeperPlay(BEEP_HIGH, 60); // Two beeps: move the glove fingers open and closed
             }
+        } else if (cEvent == BUTTON_DOUBLE && !modeSelect && (cTempMode == 3 || cTempMode == 4)) {
+            enterMode(cTempMode);
         }
-        buttonWasLetGo = true;
-        cDelay = 0;
-        isPressedForMode = false;
     }
     return cTempMode;
 }
 
 /*==============================================================================
     PULSE SERVOS 
-        Servo function to pulse all 5 servos one after the other.
+        Moves the fingers one frame toward arcPos (Motion.c), so gestures do
+        not slam all 5 servos from 0 to 255 at once, and hands the result to
+        the servo engine (Servo.c).
+        The engine pulses all 5 servos together from the TMR0 interrupt and
+        holds an exact 20ms frame, so the main loop no longer has to pad each frame
+        out with delays. The new positions are used from the next frame on.
+        The target is first held to the pose rules of the mode (Constrain.c),
+        which replace censorFinger(), so no mode can ask for a pose the rules
+        forbid. The rules are applied to a copy, as arcPos is also the last
+        pose that playback (Record.c) adds its deltas to.
 ==============================================================================*/
 void pulseServos() {
-    /*  Servo specifications
-     * The servo turns 180 degrees. Below values were found by trail and error
-     * as the datasheet was an approximation
-     * 0.54ms to 2.07ms on time, and a 20ms period.
-     */
-
-    //Thumb
-    SERVOTHUMB = 1; //Turn it on
-    __delay_us(540); //540 works well to give a -90 degree pulse.
-    for (unsigned char i = 255 - arcPos[THUMB]; i != 0; i--) {
-        /*
-         * The 255- arcPos[x] is needed so that the servo turns in the opposite 
-         * direction i.e., starts at max position
-         * This stops the threads in the hand from crossing over each other.
-         */
-        __delay_us(6); //For the SG90 servo, a 6us delay for each position
-        // allows a max pulse of 2.07ms for +90 degrees.
-    }
-    SERVOTHUMB = 0; //Turn it off
+    unsigned char *pTarget = arcPos;
+    unsigned char acTarget[SERVOCOUNT];
 
-    //Index Finger
-    SERVOINDEX = 1;
-    __delay_us(540);
-    for (unsigned char i = 255 - arcPos[INDEX]; i != 0; i--) {
-        __delay_us(6);
+    if (cMode == MODE_REMOTE && !modeSelect) {
+        pTarget = remotePose(); // Read where the packet left it
     }
-    SERVOINDEX = 0;
-
-    //Middle Finger
-    SERVOMIDDLE = 1;
-    __delay_us(540);
-    for (unsigned char i = 255 - arcPos[MIDDLE]; i != 0; i--) {
-        __delay_us(6);
+    for (unsigned char i = 0; i < SERVOCOUNT; i++) {
+        acTarget[i] = pTarget[i];
     }
-    SERVOMIDDLE = 0;
-
-    //Ring Finger
-    SERVORING = 1;
-    __delay_us(540);
-    for (unsigned char i = 255 - arcPos[RING]; i != 0; i--) {
-        __delay_us(6);
-    }
-    SERVORING = 0;
-
-    //Pinkie Finger
-    SERVOPINKIE = 1;
-    __delay_us(540);
-    for (unsigned char i = 255 - arcPos[PINKIE]; i != 0; i--) {
-        __delay_us(6);
-    }
-    SERVOPINKIE = 0;
-}
-
-/*==============================================================================
-    DELAY
-        Delay function to delay by the correct amount of time such that pulses between
-        each servo is always 20ms.
-        Takes the goal of a 20ms pulse, subtracts guaranteed servo pulses of 0.54ms
-        and then also subtracts any extra pulses for each position. (-2500) was 
-        added as an approximated adjustment factor to account for clock cycles/delays in 
-        other parts of the code.
-==============================================================================*/
-void delay() {
-    nDelay = (int) ((20000 - 2500 - 540 * 5 - arcPos[THUMB] - arcPos[INDEX] - arcPos[MIDDLE] - arcPos[RING] - arcPos[PINKIE]) / 6);
-    for (int i = nDelay; i != 0; i--) {
-        __delay_us(6);
+    PROF_BEGIN(PROF_CONSTRAIN);
+    constrainPose(acTarget, modeSelect ? CONSTRAIN_SELECT : CONSTRAIN_MODE(cMode));
+    PROF_END(PROF_CONSTRAIN);
+    motionStep(acTarget, arcServoPos);
+    servoSetPoseFine(anMotionPos); // 1/16 steps, through the servo trims
+    if (pTarget != arcPos) {
+        remotePosed(); // Echo its stamp in telemetry
     }
 }
 
 /*==============================================================================
     CONVERT SENSORS
-        Function to convert all analog flex sensors to 8bit value by 
-        calling the A/D conversion function.
+        Function to read all analog flex sensors as 8bit values. The
+        conversions run in the background (Sensors.c), so this only copies
+        the filtered sample of each finger and never waits on the A-D converter.
         
         The position must equal 255 minus the value that the A/D conversion returns.
         This is because the conductivity of the foam increases as it is bent, 
         meaning less resistance, and therefore a lower value. Without this, the
         hand would start as a fist, and then unbend as the user bends the glove.
+        The calibration tables (Calibrate.c) do this inversion, and also
+        stretch each sensor's measured range over the whole servo range.
+        The 16-bit filtered samples are looked up between table entries, so
+        the steps finer than 8 bits still move the finger.
 ==============================================================================*/
 void convertSensors() {
-    arcPos[THUMB] = 255 - adConvert(SENSORTHUMB);
-    arcPos[INDEX] = 255 - adConvert(SENSORINDEX);
-    arcPos[MIDDLE] = 255 - adConvert(SENSORMIDDLE);
-    arcPos[RING] = 255 - adConvert(SENSORRING);
-    arcPos[PINKIE] = 255 - adConvert(SENSORPINKIE);
-}
-
-/*==============================================================================
-    CENSOR FINGER
-        Function to censor out the middle finger. i.e., can't give someone
-        the finger.
-==============================================================================*/
-void censorFinger() {
-    if (!calibMode) {
-        unsigned char cMin = 255;
-        if (arcPos[MIDDLE] < arcPos[THUMB] && arcPos[MIDDLE] < arcPos[INDEX] && arcPos[MIDDLE] < arcPos[RING] && arcPos[MIDDLE] < arcPos[PINKIE]) {
-            // to find the size of array in C, you need to use sizeof(). Instead of
-            //that, we just hard-coded in 5 in the line below
-            for (unsigned char i = 0; i < 5; i++) {
-                if (cMin > arcPos[i] && i != MIDDLE) {
-                    cMin = arcPos[i];
-                }
-            }
-            arcPos[MIDDLE] = cMin;
-        }
+    sensorFilterAll(); // Each finger's filter is picked at build time
+    arcGlovePos[THUMB] = calPosition(THUMB, anSensorFine[THUMB]);
+    arcGlovePos[INDEX] = calPosition(INDEX, anSensorFine[INDEX]);
+    arcGlovePos[MIDDLE] = calPosition(MIDDLE, anSensorFine[MIDDLE]);
+    arcGlovePos[RING] = calPosition(RING, anSensorFine[RING]);
+    arcGlovePos[PINKIE] = calPosition(PINKIE, anSensorFine[PINKIE]);
+    for (unsigned char i = 0; i < 5; i++) {
+        arcPos[i] = arcGlovePos[i]; // Prediction or the classifier take it from here
     }
 }
 
 /*==============================================================================
     CALIBRATION
         Function to calibrate all analog flex sensors in a period of 10 seconds
-        after entering sensor mode (0)
+        after entering sensor mode (0). Called every CONTROL_TASK_MS, and
+        timed by the system tick so the rate it is called at does not matter.
 ==============================================================================*/
 
 /*
@@ -294,78 +293,41 @@ void censorFinger() {
  * We need to create either a look up table (array of 256) or a conversion factor to map the minimum of 
  * 35 to 0 on the servo, and then spread the other sensor values across the servos
  * http://www.ohmslawcalculator.com/voltage-divider-calculator
+ *
+ * Calibrate.c records the range of each sensor and builds one look up table per
+ * finger. The range is saved in EEPROM, so it only has to be done once.
  */
 void calibrate() {
+    unsigned int nElapsed = millis() - nCalibrationStart;
+
     modeSelect = false; // just to make sure it's not in mode select
     for (unsigned char i = 0; i < 5; i++) {
-        if (arcPos[i] < arcMaxBendPos[i] && arcPos[i] > 0) {
-            arcMaxBendPos[i] = arcPos[i];
+        if (anAdcSamples[i] >= ADC_RING_SIZE) { // The filter has a whole ring, not the zeros it starts with
+            calRecord(i, acSensorFiltered[i]); // Filtered by convertSensors() this frame
         }
     }
-    nCalibrationCounter++;
-    __delay_ms(1);
-    if (nCalibrationCounter % 1000 == 0 && nCalibrationCounter != 10000) {
-        beep(200, 500);
+    if (nElapsed >= nCalibrationBeep && nCalibrationBeep < CALIBRATION_MS) {
+        nCalibrationBeep += CALIBRATION_BEEP_MS;
+        beeperPlay(BEEP_HIGH, 60); // Countdown
     }
-    if (nCalibrationCounter == 10000) {
-        nCalibrationCounter = 0;
+    if (nElapsed >= CALIBRATION_MS) {
         calibMode = false;
-        beep(400, 2000);
-        // write some code here
-
+        calStore(); // Save the range so calibration is skipped next time
+        calBuildLuts();
+        convertSensors();
+        predictReset(arcPos); // Start predicting from the calibrated pose
+        beeperPlay(BEEP_LOW, 450);
     }
 }
 
 /*==============================================================================
     COMMANDS
         Function to switch between preprogrammed finger positions
-        using the button.
+        using the button. The gestures are keyframe tables in Gesture.c,
+        played back in milliseconds so they do not depend on the loop speed.
 ==============================================================================*/
 void commands() {
-    /*
-     * We are able to still change the gesture using the same button
-     * because entering mode select requires the user to hold the button 
-     * for approximately 3 seconds.
-     */
-    if (S1 == 0 && !modeSelect) {
-        isPressedForGesture = true;
-    }
-    if (S1 == 1 && isPressedForGesture && !modeSelect) { // gesture changes when button is let go
-        isPressedForGesture = false;
-        cGesture++;
-        if (cGesture == 9)cGesture = 0;
-        switch (cGesture) {
-            case 0:
-                setPos(0, 0, 0, 0, 0); // Open hand
-                break;
-            case 1:
-                setPos(255, 255, 255, 255, 255); // Fist
-                break;
-            case 2:
-                setPos(0, 0, 255, 255, 0); // Spider-man
-                break;
-            case 3:
-                setPos(0, 255, 255, 255, 0); // Hang Loose
-                break;
-            case 4:
-                setPos(200, 0, 0, 255, 255); // Peace sign
-                break;
-            case 5:
-                setPos(200, 200, 0, 0, 0); // A-OK
-                break;
-            case 6:
-                setPos(0, 255, 255, 255, 255); // Thumbs Up
-                break;
-            case 7:
-                setPos(255, 0, 255, 255, 255); // Index pointing
-                break;
-            case 8:
-                setPos(255, 0, 255, 255, 0); // Rock On
-                break;
-            default:
-                break;
-        }
-    }
+    gestureUpdate(arcPos);
 }
 
 /*==============================================================================
@@ -375,13 +337,205 @@ void commands() {
  
         Update: This function actually cycles the index finger back and forth.
         This creates the "come here" gesture with your finger. Maybe the kid
-        really will get candy.
+        really will get candy. It is now a looping gesture in Gesture.c.
 ==============================================================================*/
 void heyKidWantSomeCandy() {
-    setPos(255, cCountFingerCycle, 255, 255, 255);
-    cCountFingerCycle += cCycleIncrement;
-    if (cCountFingerCycle == 255 || cCountFingerCycle == 0) {
-        cCycleIncrement *= -1;
+    if (!gestureIsPlaying()) {
+        gesturePlay(GESTURE_COMEHERE);
+    }
+    gestureUpdate(arcPos);
+}
+
+/*==============================================================================
+    REMOTE CONTROL
+        Acts on a command from the remote peer (Remote.c). A pose packet
+        switches to MODE_REMOTE, where pulseServos() follows the received
+        poses. A trim packet changes one servo's endpoints (Servo.c) and can
+        store them. A channel packet moves a servo after the fingers, eg. the
+        wrist. Commands are ignored while the user is in mode select.
+==============================================================================*/
+void remoteControl() {
+    unsigned char cType, cValue;
+    unsigned int nMinUs, nMaxUs;
+    bool isReversed;
+
+    if (!remoteCommand(&cType, &cValue) || modeSelect) {
+        return;
+    }
+    if (cType == REMOTE_POSE) {
+        if (cMode != MODE_REMOTE) {
+            enterMode(MODE_REMOTE);
+            cMode = MODE_REMOTE;
+        }
+    } else if (cType == REMOTE_MODE && cValue <= MODE_REMOTE) {
+        enterMode(cValue);
+        cMode = cValue;
+    } else if (cType == REMOTE_GESTURE && cValue < GESTURE_TOTAL) {
+        if (cMode != 1) {
+            enterMode(1);
+            cMode = 1;
+        }
+        cGesture = cValue < GESTURE_COUNT ? cValue : 0; // The button carries on from here
+        gesturePlay(cValue);
+    } else if (cType == REMOTE_TRIM) {
+        remoteTrim(&nMinUs, &nMaxUs, &isReversed);
+        servoSetTrim(cValue & ~REMOTE_TRIM_STORE, nMinUs, nMaxUs, isReversed);
+        if (cValue & REMOTE_TRIM_STORE) {
+            servoStoreTrims(); // Blocks for about 110ms, the servos hold their pulse
+        }
+    } else if (cType == REMOTE_CHANNEL) {
+        servoSetChannel(cValue, (int) remoteChannel() << SERVO_FINE_FRAC); // Finger channels are ignored
+    }
+}
+
+/*==============================================================================
+    TASKS
+        The main loop work, split by rate and run by the scheduler (Sched.c).
+        Each task does one short pass and returns.
+
+        SERVO TASK moves the fingers one step and hands the pose to the servo
+        engine, once per servo frame. Servos are not pulsed during calibration,
+        and fingers that have been still for a while are pulsed less (Power.c).
+        RECORD TASK writes recorded blocks to flash when the servo frame has
+        a long enough gap after the pulses.
+        GOVERNOR TASK slows finger motion down while the supply sags.
+        CONTROL TASK works out where the fingers should be in the current mode.
+        UI TASK reads the button and remote commands, and blinks the profile
+        report.
+        BLACKBOX TASK writes the flight recorder (Blackbox.c), but not while
+        the recorder has flash work pending, which must not wait on it.
+==============================================================================*/
+void servoTask() {
+    PROF_FRAME_MARK();
+    blackboxFrame(); // Log missed frames
+    if (!calibMode || modeSelect) {
+        PROF_BEGIN(PROF_PULSE);
+        pulseServos();
+        PROF_END(PROF_PULSE);
+        servoEnableMask(powerServoMask(arcServoPos)); // Rest steady fingers
+        if (cMode == 0 && cMirror == MIRROR_MEASURE && !modeSelect && predictMeasureOut(arcServoPos)) {
+            cMirror = MIRROR_PREDICT; // The measured delay is the new horizon
+            predictReset(arcPos);
+            beeperPlay(BEEP_LOW, 450);
+        }
+    } else {
+        servoEnable(false); // Servos are not pulsed during calibration
+    }
+}
+
+void recordTask() {
+    PROF_BEGIN(PROF_RECORD);
+    recordService();
+    PROF_END(PROF_RECORD);
+}
+
+void governorTask() {
+    governorRun();
+    adcAutoRange();
+    blackboxWatch(nGovSupplyMv, acAdcLatest);
+}
+
+void controlTask() {
+    if (modeSelect) {
+        return;
+    }
+    switch (cMode) {
+        case 0: // matching glove movements
+            PROF_BEGIN(PROF_SENSORS);
+            convertSensors();
+            PROF_END(PROF_SENSORS);
+            if (calibMode) {
+                // Nothing to follow yet
+            } else if (cMirror == MIRROR_PREDICT) {
+                predictPose(arcPos); // Command where the glove is going
+            } else if (cMirror == MIRROR_SNAP) {
+                PROF_BEGIN(PROF_CLASSIFY);
+                classifyPose(arcPos); // Snap to the nearest gesture
+                PROF_END(PROF_CLASSIFY);
+            } else {
+                predictMeasureIn(arcPos);
+            }
+            PROF_BEGIN(PROF_CALIBRATE);
+            if (calibMode) calibrate();
+            PROF_END(PROF_CALIBRATE);
+            break;
+        case 1: // pre-programmed gestures
+            PROF_BEGIN(PROF_COMMANDS);
+            commands();
+            PROF_END(PROF_COMMANDS);
+            break;
+        case 2:
+            PROF_BEGIN(PROF_COMMANDS);
+            heyKidWantSomeCandy(); // "come here" gesture
+            PROF_END(PROF_COMMANDS);
+            break;
+        case 3: // matching glove movements and recording them
+            convertSensors();
+            recordFrame(arcPos);
+            break;
+        case 4: // playing the recording back, over and over
+            if (!playFrame(arcPos)) {
+                playStart();
+            }
+            break;
+        case MODE_REMOTE: // following poses from the remote peer, see pulseServos()
+            break;
+        default:
+            break;
+    }
+}
+
+void uiTask() {
+    PROF_BEGIN(PROF_CHECKMODE);
+    cMode = checkMode();
+    remoteControl();
+    PROF_END(PROF_CHECKMODE);
+    PROF_SERVICE(); // Overrun count blinks
+}
+
+void blackboxTask() {
+    if (!recordIsBusy()) {
+        blackboxService();
+    }
+}
+
+task_t asTasks[] = {// Highest priority first
+    {servoTask, SERVO_TASK_MS, 0},
+    {recordTask, RECORD_TASK_MS, 0},
+    {governorTask, GOVERNOR_TASK_MS, 0},
+    {controlTask, CONTROL_TASK_MS, 0},
+    {uiTask, UI_TASK_MS, 0},
+    {blackboxTask, BLACKBOX_TASK_MS, 0}
+};
+
+/*==============================================================================
+    INTERRUPT SERVICE ROUTINES
+        Pass each interrupt on to the module that owns it. Servo edges are the
+        only high priority interrupt so nothing else can delay a pulse.
+==============================================================================*/
+void interrupt isr(void) {
+    if (SERVOTIMERIE && SERVOTIMERIF) {
+        servoISR();
+    }
+}
+
+void interrupt low_priority isrLow(void) {
+    if (TMR2IE && TMR2IF) {
+        adcISR();
+        if (tickISR()) { // Once every millisecond
+            telemetryTick();
+            beeperTick();
+            buttonTick();
+        }
+    }
+    if (TMR3IE && TMR3IF) {
+        beeperISR();
+    }
+    if (RC1IE && RC1IF) {
+        remoteRxISR();
+    }
+    if (TX1IE && TX1IF) {
+        telemetryTxISR();
     }
 }
 
@@ -393,28 +547,40 @@ int main(void) {
     initPorts(); // Initialize CHRPMini I/O and peripherals
     initANA(); // Initialize Port A analog inputs (for Flex sensors)
     initVariables(); // Initialize all variables 
+    initBlackbox(resetCause()); // Log why the hand was reset
+    initBeeper(); // Mode and calibration sounds play in the background
+    initButton(); // S1 is debounced in the tick
+    if (!calLoad()) { // Calibrate at power up only if nothing is stored
+        startCalibration();
+        beeperPlay(BEEP_LOW, 100); // Three short beeps: no calibration stored
+        beeperPlay(BEEP_REST, 100);
+        beeperPlay(BEEP_LOW, 100);
+        beeperPlay(BEEP_REST, 100);
+        beeperPlay(BEEP_LOW, 100);
+    }
+    calBuildLuts();
+    initMotion(arcPos); // Fingers start at rest, open
+    initGovernor(); // Full speed until the supply sags
+    initClassify(); // Gesture poses for snapping in mode 0
+    initPredict(CONTROL_TASK_MS); // Mode 0 runs the predictor every control task
+    initConstrain(asRules, sizeof (asRules) / sizeof (asRules[0]));
+    initServos(); // Start the servo engine with an open hand
+    servoSetMode(SERVO_OUTPUT, SERVO_FRAME_US); // Parallel unless the variant says otherwise
+    initSensors(); // Start background flex sensor conversions
+    initTelemetry(acAdcLatest, acSensorFiltered, arcServoPos, arcGlovePos); // Stream to a PC
+    initRemote(); // Take commands from a PC
+    IPEN = 1; // Enable interrupt priorities
+    GIEH = 1; // Enable high priority interrupts
+    GIEL = 1; // Enable low priority interrupts
+    INIT_PROFILE(); // Start frame timing (PROFILE_ENABLE builds only)
+    servoWaitFrame(); // Line the servo task up with the start of a servo frame
+    initSched(asTasks, sizeof (asTasks) / sizeof (asTasks[0]));
+    initPower(); // Idle the CPU and rest the servos when there is nothing to do
     while (1) {
-        if (!modeSelect) {
-            switch (cMode) {
-                case 0: // matching glove movements
-                    convertSensors();
-                    //censorFinger();
-                    //if (calibMode) calibrate();
-                    break;
-                case 1: // pre-programmed gestures
-                    commands();
-                    break;
-                case 2:
-                    heyKidWantSomeCandy(); // "come here" gesture
-                    break;
-                default:
-                    break;
-            }
-        }
-        if (!calibMode || modeSelect) {
-            pulseServos();
-            delay();
+        if (!schedRun()) { // Run whichever task is due
+            PROF_BEGIN(PROF_IDLE);
+            powerIdle(); // Nothing due, wait for the next interrupt
+            PROF_END(PROF_IDLE);
         }
-        cMode = checkMode();
     }
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+#
+#  Host builds. The programs in tools/ build with the PC's C compiler and run
+#  parts of the firmware, or all of it, without the hardware (see the top of
+#  each for what it does). Output goes to build/host/.
+#
+#     make host                    build every host tool
+#     make sim                     build the hand simulation for every variant
+#                                  and play each trace in tools/traces/ on it
+#     make sim-standard            the same for one variant
+#     make host-clean              remove the host builds
+#
+#  Set HOST_CC to the compiler if gcc is not the one wanted, eg.
+#     make sim HOST_CC=clang
+#
+#  servo_bench is built for 16 channels; see its top for the other sizes.
+#  The hand simulation builds every firmware module but CHRPMini.c and the
+#  configuration bits, with CHRP_HOST set to tools/hand_sim.h so that they
+#  run against its model of the PIC. A trace that fails stops the build.
+#
+
+HOST_CC ?= gcc
+HOST_FLAGS = -O2 -Wall -Wextra -Itools
+HOST_DIR = build/host
+MKDIR ?= mkdir
+VARIANTS ?= standard wrist mg90
+
+HOST_TOOLS = adc_bench blackbox_bench blackbox_decode classify_bench constrain_bench \
+	remote_peer servo_bench telemetry_decode telemetry_test hand_sim
+SIM_SOURCES = $(filter-out CHRPMini.c PIC18F25K50config.c,$(wildcard *.c))
+SIM_FLAGS = -DCHRP_HOST='"hand_sim.h"'
+SIM_TRACES = $(wildcard tools/traces/*.trace)
+
+HOST_WITH_adc_bench = -lm
+HOST_WITH_classify_bench = Classify.c Gesture.c Tick.c
+HOST_WITH_constrain_bench = Constrain.c
+HOST_WITH_servo_bench = -DSERVO_CHANNELS=16 -DSERVO_PORTC=1
+HOST_WITH_hand_sim = $(SIM_FLAGS) $(SIM_SOURCES)
+
+.PHONY: host sim host-clean
+.PRECIOUS: $(HOST_DIR)/hand_sim.%
+
+host: $(addprefix $(HOST_DIR)/,$(HOST_TOOLS))
+
+$(HOST_DIR)/%: tools/%.c tools/*.h *.c *.h variants/*.h
+	@$(MKDIR) -p $(HOST_DIR)
+	$(HOST_CC) $(HOST_FLAGS) -o $@ $< $(HOST_WITH_$*)
+
+sim: $(addprefix sim-,$(VARIANTS))
+
+sim-%: $(HOST_DIR)/hand_sim.%
+	@echo "=== $* ==="
+	@for t in $(SIM_TRACES); do $< $$t || exit 1; done
+
+$(HOST_DIR)/hand_sim.%: tools/hand_sim.c tools/hand_sim.h $(SIM_SOURCES) *.h variants/*.h
+	@$(MKDIR) -p $(HOST_DIR)
+	$(HOST_CC) $(HOST_FLAGS) $(SIM_FLAGS) -DVARIANT_$(shell echo $* | tr a-z A-Z) \
+		-o $@ tools/hand_sim.c $(SIM_SOURCES)
+
+host-clean:
+	rm -rf $(HOST_DIR)
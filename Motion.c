@@ -0,0 +1,117 @@
+/*==============================================================================
+    Trajectory engine. Speed, acceleration and current limited finger motion.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "Servo.h"           // Include servo engine constants and functions
+#include    "Motion.h"          // Include trajectory engine constants and functions
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+const int anMotionVmax[SERVOCOUNT] = MOTION_VMAX;
+const int anMotionAccel[SERVOCOUNT] = MOTION_ACCEL;
+
+int anMotionPos[SERVOCOUNT], anMotionVel[SERVOCOUNT];
+//anMotionPos is each finger's position and anMotionVel its speed, in 1/16 steps
+unsigned char cMotionFirst;
+//cMotionFirst is the finger that gets the current budget first, rotated every
+//frame so that no finger is always left waiting
+unsigned int nMotionBudget;
+//nMotionBudget is the speed budget in use, MOTION_SPEED_BUDGET unless the supply is low
+
+/*==============================================================================
+    MOTION STEP
+        Moves every finger one frame toward its target and writes the new
+        pose to out. The work per finger is fixed, so the cost per frame is
+        bounded (about 5 x 150 instruction cycles).
+
+        Pass 1 finds how much of the current budget the fingers use at their
+        present speed, with braking fingers at their lower speed. Pass 2 then
+        lets fingers speed up, in rotating order, while budget is left.
+==============================================================================*/
+void motionStep(const unsigned char *target, unsigned char *out) {
+    int anErr[SERVOCOUNT], nSpeed, nAccel;
+    unsigned int nDist, nUsed = 0;
+    bool abBrake[SERVOCOUNT];
+    unsigned char i, n;
+
+    for (i = 0; i < SERVOCOUNT; i++) {
+        anErr[i] = ((int) target[i] << MOTION_FRAC) - anMotionPos[i];
+        nSpeed = anMotionVel[i];
+        if (anErr[i] < 0) {
+            nSpeed = -nSpeed; // Speed toward the target
+        }
+        nDist = (anErr[i] < 0) ? -anErr[i] : anErr[i];
+        nAccel = anMotionAccel[i];
+        // Brake when the stopping distance v^2 / 2a has reached the target
+        abBrake[i] = nSpeed > 0 && (unsigned long) nSpeed * nSpeed >= (unsigned long) 2 * nAccel * nDist;
+        if (abBrake[i]) {
+            nSpeed -= nAccel;
+        } else if (nSpeed < 0) {
+            nSpeed += nAccel; // Moving away, turn around (lowers the current too)
+            abBrake[i] = true;
+        }
+        anMotionVel[i] = (anErr[i] < 0) ? -nSpeed : nSpeed;
+        nUsed += (nSpeed < 0) ? -nSpeed : nSpeed;
+    }
+
+    n = cMotionFirst;
+    for (i = 0; i < SERVOCOUNT; i++) {
+        nSpeed = (anErr[n] < 0) ? -anMotionVel[n] : anMotionVel[n];
+        if (!abBrake[n] && anErr[n] != 0 && nSpeed < anMotionVmax[n]) {
+            nAccel = anMotionAccel[n];
+            if (nSpeed + nAccel > anMotionVmax[n]) {
+                nAccel = anMotionVmax[n] - nSpeed;
+            }
+            if (nUsed + nAccel > nMotionBudget) {
+                nAccel = (nUsed < nMotionBudget) ? nMotionBudget - nUsed : 0;
+            }
+            nSpeed += nAccel;
+            nUsed += nAccel;
+            anMotionVel[n] = (anErr[n] < 0) ? -nSpeed : nSpeed;
+        }
+        n++;
+        if (n == SERVOCOUNT) {
+            n = 0;
+        }
+    }
+    cMotionFirst = (cMotionFirst == SERVOCOUNT - 1) ? 0 : cMotionFirst + 1;
+
+    for (i = 0; i < SERVOCOUNT; i++) {
+        nSpeed = (anErr[i] < 0) ? -anMotionVel[i] : anMotionVel[i];
+        nDist = (anErr[i] < 0) ? -anErr[i] : anErr[i];
+        if (nSpeed >= 0 && (unsigned int) nSpeed >= nDist) {
+            anMotionPos[i] = (int) target[i] << MOTION_FRAC; // Arrived this frame
+            anMotionVel[i] = 0;
+        } else {
+            anMotionPos[i] += anMotionVel[i];
+        }
+        out[i] = (unsigned char) (anMotionPos[i] >> MOTION_FRAC);
+    }
+}
+
+/*==============================================================================
+    INIT MOTION
+        Starts every finger at rest at the given pose.
+==============================================================================*/
+void initMotion(const unsigned char *pos) {
+    for (unsigned char i = 0; i < SERVOCOUNT; i++) {
+        anMotionPos[i] = (int) pos[i] << MOTION_FRAC;
+        anMotionVel[i] = 0;
+    }
+    cMotionFirst = 0;
+    nMotionBudget = MOTION_SPEED_BUDGET;
+}
+
+/*==============================================================================
+    MOTION SET BUDGET
+        Changes the speed budget. Fingers already moving faster than a lower
+        budget allows are not slowed, they just cannot speed up until the
+        total has dropped below it, so a cut never jerks the hand.
+==============================================================================*/
+void motionSetBudget(unsigned int budget) {
+    nMotionBudget = budget;
+}
@@ -0,0 +1,37 @@
+/*==============================================================================
+    Trajectory engine (PIC18F25K50) symbolic constants and prototypes.
+==============================================================================*/
+
+// The trajectory engine sits between the pose the hand is asked for (arcPos)
+// and the pose sent to the servos. Once per servo frame each finger moves
+// toward its target along a trapezoidal velocity profile: it speeds up by its
+// acceleration limit, cruises at its speed limit and brakes so it stops on
+// the target instead of overshooting and whipping the fishing line.
+//
+// Positions are kept in 1/16 steps (12 bits), so slow speeds and small
+// accelerations are not lost to rounding. Speeds are 1/16 steps per frame and
+// accelerations are 1/16 steps per frame per frame.
+
+#define MOTION_FRAC         4           // Fraction bits of positions and speeds
+
+// Per finger limits, in finger order. An SG90 turns 60 degrees in 0.1s with
+// no load, which is about 17 steps per 20ms frame (272 in 1/16 steps).
+
+#define MOTION_VMAX         {272, 272, 272, 272, 272}   // Speed limits
+#define MOTION_ACCEL        {48, 48, 48, 48, 48}        // Acceleration limits
+
+// Supply current budget. A moving SG90 draws about MOTION_MA_AT_VMAX at full
+// speed and roughly in proportion to its speed below that. Fingers may only
+// speed up while the total stays under MOTION_PEAK_MA; braking is always
+// allowed as it lowers the current. The budget is worked out in speed units
+// at compile time so the per frame cost is additions only.
+
+#define MOTION_MA_AT_VMAX   250         // Current of one servo at full speed
+#define MOTION_PEAK_MA      700         // Peak current allowed for all servos
+#define MOTION_SPEED_BUDGET ((unsigned int) ((unsigned long) MOTION_PEAK_MA * 272 / MOTION_MA_AT_VMAX))
+
+extern int anMotionPos[SERVOCOUNT]; // Finger positions in 1/16 steps (servoSetPoseFine)
+
+void initMotion(const unsigned char *pos); // Start at a pose, at rest.
+void motionSetBudget(unsigned int budget); // Change the speed budget (Governor.c).
+void motionStep(const unsigned char *target, unsigned char *out); // Move one frame toward target.
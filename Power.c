@@ -0,0 +1,91 @@
+/*==============================================================================
+    Power management. CPU idle between tasks, servo hold when the pose is steady.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "CHRPMini.h"        // Include CHRPMini constant symbols and functions
+#include    "Servo.h"           // Include servo engine constants and functions
+#include    "Tick.h"            // Include system tick constants and functions
+#include    "Power.h"           // Include power management constants and functions
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+unsigned char acPowerLast[SERVOCOUNT];
+unsigned int anPowerSince[SERVOCOUNT];
+//acPowerLast is the last command of each servo and anPowerSince when it last changed
+unsigned char cPowerDivide;
+//cPowerDivide counts frames for the slow refresh of bent fingers
+unsigned int anPowerPulsed[SERVOCOUNT], nPowerFrames;
+
+/*==============================================================================
+    POWER SERVO MASK
+        Works out which channels to pulse in the next frame, as a mask for
+        servoEnableMask(). Call once per servo frame with the pose that was
+        just sent to the servo engine.
+==============================================================================*/
+unsigned int powerServoMask(const unsigned char *pos) {
+    unsigned int nMask = SERVO_EXTRA_CHANNELS, nBit = 1; // Channels after the fingers always pulse
+    unsigned int nNow = millis();
+
+    cPowerDivide++;
+    if (cPowerDivide >= POWER_HOLD_DIVIDE) {
+        cPowerDivide = 0;
+    }
+    if (nPowerFrames == 0xFFFF) { // Keep the ratios, lose the oldest counts
+        nPowerFrames >>= 1;
+        for (unsigned char i = 0; i < SERVOCOUNT; i++) {
+            anPowerPulsed[i] >>= 1;
+        }
+    }
+    nPowerFrames++;
+
+    for (unsigned char i = 0; i < SERVOCOUNT; i++, nBit <<= 1) {
+        if (pos[i] != acPowerLast[i]) {
+            acPowerLast[i] = pos[i];
+            anPowerSince[i] = nNow;
+        }
+#if POWER_ENABLE
+        if (nNow - anPowerSince[i] < POWER_HOLD_MS) {
+            // Moving or only just stopped
+        } else if (pos[i] > POWER_REST_POS && cPowerDivide == 0) {
+            // Bent and steady, refresh now and then
+        } else {
+            continue; // Open and steady, no pulse needed
+        }
+#endif
+        nMask |= nBit;
+        anPowerPulsed[i]++;
+    }
+    return nMask;
+}
+
+/*==============================================================================
+    POWER IDLE
+        Stops the CPU until the next interrupt. With IDLEN set SLEEP enters
+        Idle mode, so the timers, A-D converter and EUSART keep running.
+==============================================================================*/
+void powerIdle(void) {
+#if POWER_ENABLE
+    SLEEP();
+    NOP(); // The instruction after SLEEP runs before the ISR on wake up
+#endif
+}
+
+/*==============================================================================
+    INIT POWER
+==============================================================================*/
+void initPower(void) {
+    unsigned int nNow = millis();
+
+    for (unsigned char i = 0; i < SERVOCOUNT; i++) {
+        acPowerLast[i] = 0;
+        anPowerSince[i] = nNow;
+        anPowerPulsed[i] = 0;
+    }
+    nPowerFrames = 0;
+    cPowerDivide = 0;
+    IDLEN = 1; // SLEEP enters Idle mode, not Sleep
+}
@@ -0,0 +1,53 @@
+/*==============================================================================
+    Power management (PIC18F25K50) symbolic constants and function prototypes.
+==============================================================================*/
+
+// Two savings, both on by default:
+//
+// Idle: when no task is due the main loop puts the processor in Idle mode
+// (IDLEN set, then SLEEP). The CPU clock stops but the peripherals keep
+// running, and the next interrupt (the 200us TMR2 slot at the latest, or a
+// servo edge) wakes it up. Nothing is slowed down: every interrupt source
+// still works, and tasks start on the interrupt that makes them due.
+//
+// Servo hold: a finger whose servo command has not changed for
+// POWER_HOLD_MS stops being pulsed every frame. An SG90 only drives its
+// motor for a few ms after each pulse, so:
+//     - a finger at rest (open, position <= POWER_REST_POS) has no line
+//       tension to hold and is not pulsed at all
+//     - a bent finger is pulsed once every POWER_HOLD_DIVIDE frames, enough
+//       to pull it back if the elastic creeps, at a fraction of the current
+// Any change of the command pulses the finger again from the next frame.
+//
+// Estimated average current, from the PIC18F25K50 and SG90 data sheets
+// (not measured on a board; measure with a meter in the 5V supply):
+//     PIC at 48MHz running ~12mA, in Idle ~5mA. The tasks keep the CPU
+//     busy for 5-10% of the time, so the PIC averages ~6mA instead of 12mA.
+//     SG90 pulsed at 50Hz, no load ~8mA, holding a bent finger 40-150mA
+//     depending on the elastic. Not pulsed ~4mA (electronics only).
+// Per mode, with all five servos (pulse duty = frames pulsed / frames):
+//     Mode 0, mirroring a moving glove   100%, no saving while moving
+//     Mode 0, glove still                open fingers 0%, bent 1/3
+//     Mode 1, gesture held               open fingers 0%, bent 1/3
+//     Mode 2, "come here" (always moving) index 100%, others 1/3
+//     Mode 3 and 4, record and play      as mode 0, following the glove
+//     Mode select, one finger bent       1 finger 1/3, 4 fingers 0%
+// For example a held fist (5 bent) drops from ~5 x 100mA to ~5 x 35mA, and
+// an open hand from ~40mA to ~20mA. anPowerPulsed / nPowerFrames gives the
+// measured duty of each servo, and PROF_IDLE (PROFILE_ENABLE=1) the time the
+// CPU spends in Idle.
+
+#ifndef POWER_ENABLE
+#define POWER_ENABLE        1
+#endif
+
+#define POWER_HOLD_MS       2000        // Steady this long before pulses are cut
+#define POWER_REST_POS      8           // At or below this a finger is unloaded
+#define POWER_HOLD_DIVIDE   3           // Bent steady fingers pulse 1 frame in 3
+
+extern unsigned int anPowerPulsed[SERVOCOUNT]; // Frames each servo was pulsed
+extern unsigned int nPowerFrames; // Frames counted, all counts halve at 65535
+
+void initPower(void); // Start with every finger pulsed and turn on Idle mode.
+unsigned int powerServoMask(const unsigned char *pos); // Channels to pulse for this pose.
+void powerIdle(void); // Idle the CPU until the next interrupt.
@@ -0,0 +1,194 @@
+/*==============================================================================
+    Glove motion predictor. Alpha-beta filter per finger with a lead clamp.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "CHRPMini.h"        // Include CHRPMini constant symbols and functions
+#include    "Sensors.h"         // Include sensor acquisition constants and functions
+#include    "Tick.h"            // Include system tick constants and functions
+#include    "Predict.h"         // Include predictor constants and functions
+
+#define PREDICT_FRAC        4           // Fraction bits of positions and speeds
+#define PREDICT_NONE        0           // Crossing directions
+#define PREDICT_UP          1
+#define PREDICT_DOWN        2
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+int anPredictX[SENSORCOUNT], anPredictV[SENSORCOUNT];
+//anPredictX is the filtered position and anPredictV the speed of each finger
+unsigned char cPredictHorizon, cPredictPeriod, cPredictSteps;
+//cPredictSteps is the horizon in updates of cPredictPeriod ms
+unsigned char acSideIn[SENSORCOUNT], acSideOut[SENSORCOUNT], acCrossIn[SENSORCOUNT];
+//acSideIn and acSideOut are the side of the middle the glove and the servo
+//command are on, acCrossIn is the direction of a glove crossing still waiting
+unsigned int anCrossTime[SENSORCOUNT];
+//anCrossTime is when the waiting glove crossing happened
+unsigned int nMeasureSum;
+unsigned char cMeasureCount;
+//nMeasureSum adds up cMeasureCount delays
+
+/*==============================================================================
+    PREDICT SHIFT
+        Divides a signed value by 2^shift, rounding toward 0 the same way
+        for both signs (>> of a negative number is not portable C).
+==============================================================================*/
+static int predictShift(int nValue, unsigned char shift) {
+    if (nValue < 0) {
+        return -(int) ((unsigned int) -nValue >> shift);
+    }
+    return (int) ((unsigned int) nValue >> shift);
+}
+
+/*==============================================================================
+    PREDICT POSE
+        One alpha-beta update per finger, then pos is replaced by the filtered
+        position plus speed x horizon, clamped to PREDICT_MAX_LEAD and to the
+        servo range.
+==============================================================================*/
+void predictPose(unsigned char *pos) {
+    int nPredicted, nResidual, nLead;
+
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        nPredicted = anPredictX[i] + anPredictV[i];
+        nResidual = ((int) pos[i] << PREDICT_FRAC) - nPredicted;
+        anPredictX[i] = nPredicted + predictShift(nResidual, PREDICT_ALPHA_SHIFT);
+        anPredictV[i] += predictShift(nResidual, PREDICT_BETA_SHIFT);
+
+        nLead = anPredictV[i]; // Clamp before the multiply so it cannot overflow
+        if (nLead > PREDICT_MAX_LEAD << PREDICT_FRAC) {
+            nLead = PREDICT_MAX_LEAD << PREDICT_FRAC;
+        } else if (nLead < -(PREDICT_MAX_LEAD << PREDICT_FRAC)) {
+            nLead = -(PREDICT_MAX_LEAD << PREDICT_FRAC);
+        }
+        nLead *= cPredictSteps;
+        if (nLead > PREDICT_MAX_LEAD << PREDICT_FRAC) {
+            nLead = PREDICT_MAX_LEAD << PREDICT_FRAC;
+        } else if (nLead < -(PREDICT_MAX_LEAD << PREDICT_FRAC)) {
+            nLead = -(PREDICT_MAX_LEAD << PREDICT_FRAC);
+        }
+
+        nPredicted = predictShift(anPredictX[i] + nLead + (1 << (PREDICT_FRAC - 1)), PREDICT_FRAC);
+        if (nPredicted < 0) {
+            nPredicted = 0;
+        } else if (nPredicted > 255) {
+            nPredicted = 255;
+        }
+        pos[i] = (unsigned char) nPredicted;
+    }
+}
+
+/*==============================================================================
+    PREDICT RESET
+==============================================================================*/
+void predictReset(const unsigned char *pos) {
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        anPredictX[i] = (int) pos[i] << PREDICT_FRAC;
+        anPredictV[i] = 0;
+    }
+}
+
+/*==============================================================================
+    PREDICT SET HORIZON
+==============================================================================*/
+void predictSetHorizon(unsigned char ms) {
+    if (ms > PREDICT_MAX_HORIZON) {
+        ms = PREDICT_MAX_HORIZON;
+    }
+    cPredictHorizon = ms;
+    cPredictSteps = (ms + cPredictPeriod / 2) / cPredictPeriod;
+}
+
+/*==============================================================================
+    PREDICT SIDE
+        Which side of the middle band a position is on. Inside the band the
+        side does not change, so noise around the middle is not a crossing.
+==============================================================================*/
+static unsigned char predictSide(unsigned char pos, unsigned char side) {
+    if (pos < PREDICT_MID_LOW) {
+        return PREDICT_DOWN;
+    }
+    if (pos > PREDICT_MID_HIGH) {
+        return PREDICT_UP;
+    }
+    return side;
+}
+
+/*==============================================================================
+    PREDICT MEASURE START / IN / OUT
+        A glove crossing is remembered until the servo command crosses the
+        same way, and the time between them is one delay sample. When enough
+        samples are in, their mean plus PREDICT_SERVO_MS becomes the horizon.
+==============================================================================*/
+void predictMeasureStart(void) {
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        acSideIn[i] = PREDICT_NONE;
+        acSideOut[i] = PREDICT_NONE;
+        acCrossIn[i] = PREDICT_NONE;
+    }
+    nMeasureSum = 0;
+    cMeasureCount = 0;
+}
+
+void predictMeasureIn(const unsigned char *pos) {
+    unsigned char cSide;
+
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        cSide = predictSide(pos[i], acSideIn[i]);
+        if (cSide != acSideIn[i] && acSideIn[i] != PREDICT_NONE) {
+            acCrossIn[i] = cSide;
+            anCrossTime[i] = millis();
+        }
+        acSideIn[i] = cSide;
+    }
+}
+
+bool predictMeasureOut(const unsigned char *pos) {
+    unsigned char cSide;
+    unsigned int nDelay;
+
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        cSide = predictSide(pos[i], acSideOut[i]);
+        if (cSide != acSideOut[i] && cSide == acCrossIn[i]) {
+            nDelay = millis() - anCrossTime[i];
+            acCrossIn[i] = PREDICT_NONE;
+            if (nDelay < 1000 // Longer means the glove went back and forth
+                    && cMeasureCount < PREDICT_MEASURE_COUNT) { // Fingers crossing together may pass the count
+                nMeasureSum += nDelay;
+                cMeasureCount++;
+            }
+        }
+        acSideOut[i] = cSide;
+    }
+    if (cMeasureCount < PREDICT_MEASURE_COUNT) {
+        return false;
+    }
+    nDelay = nMeasureSum / PREDICT_MEASURE_COUNT + PREDICT_SERVO_MS;
+    predictSetHorizon(nDelay > PREDICT_MAX_HORIZON ? PREDICT_MAX_HORIZON : (unsigned char) nDelay);
+    eepromWrite(PREDICT_EEPROM_ADDR, PREDICT_MAGIC);
+    eepromWrite(PREDICT_EEPROM_ADDR + 1, cPredictHorizon);
+    predictMeasureStart();
+    return true;
+}
+
+/*==============================================================================
+    INIT PREDICT
+        Loads the measured horizon if one was stored. periodMs is how often
+        predictPose() will be called.
+==============================================================================*/
+void initPredict(unsigned char periodMs) {
+    cPredictPeriod = periodMs;
+    if (eepromRead(PREDICT_EEPROM_ADDR) == PREDICT_MAGIC) {
+        predictSetHorizon(eepromRead(PREDICT_EEPROM_ADDR + 1));
+    } else {
+        predictSetHorizon(PREDICT_HORIZON_MS);
+    }
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        anPredictX[i] = 0;
+        anPredictV[i] = 0;
+    }
+    predictMeasureStart();
+}
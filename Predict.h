@@ -0,0 +1,45 @@
+/*==============================================================================
+    Glove motion predictor (PIC18F25K50) constants and function prototypes.
+==============================================================================*/
+
+// Mirroring lags the glove: the sensor filter, the control and servo task
+// periods, the speed limits of the trajectory engine and the servo itself all
+// add delay. The predictor runs an alpha-beta filter on each finger of the
+// calibrated glove pose (position and speed) and commands the position the
+// finger will have one horizon later, so the hand arrives closer to on time.
+//
+// Positions are kept in 1/16 steps and speeds in 1/16 steps per update.
+// The lead (speed x horizon) is limited to PREDICT_MAX_LEAD steps so that a
+// quick flick or a noisy sample cannot throw the finger far past the glove.
+//
+// Delay measurement: predictMeasureIn() and predictMeasureOut() time how long
+// a finger takes to get from the glove (calibrated pose) to the servo command
+// (after the trajectory engine), by the time between the two crossing the
+// middle of the range in the same direction. The servos have no position
+// feedback, so their own response is added as the constant PREDICT_SERVO_MS.
+// After PREDICT_MEASURE_COUNT crossings the mean becomes the new horizon and
+// is stored in data EEPROM.
+
+#define PREDICT_ALPHA_SHIFT 1           // Position gain alpha = 1/2
+#define PREDICT_BETA_SHIFT  3           // Speed gain beta = 1/8
+#define PREDICT_HORIZON_MS  30          // Horizon until one has been measured
+#define PREDICT_MAX_HORIZON 100         // Longest horizon in ms
+#define PREDICT_MAX_LEAD    48          // Furthest ahead of the glove, in steps
+
+#define PREDICT_SERVO_MS    10          // SG90 response, not measurable here
+#define PREDICT_MID_LOW     112         // Crossing band around the middle
+#define PREDICT_MID_HIGH    144
+#define PREDICT_MEASURE_COUNT 8         // Crossings averaged, power of 2
+
+#define PREDICT_EEPROM_ADDR 0x0C        // After the calibration record
+#define PREDICT_MAGIC       0xB7        // Marks a stored horizon
+
+extern unsigned char cPredictHorizon; // Horizon in ms
+
+void initPredict(unsigned char periodMs); // Load the horizon, for updates every periodMs.
+void predictReset(const unsigned char *pos); // Start from a pose, at rest.
+void predictSetHorizon(unsigned char ms); // Change the horizon.
+void predictPose(unsigned char *pos); // Update with the glove pose and replace it with the prediction.
+void predictMeasureStart(void); // Start measuring the delay.
+void predictMeasureIn(const unsigned char *pos); // Glove pose, while measuring.
+bool predictMeasureOut(const unsigned char *pos); // Servo pose, true when measuring is done.
@@ -0,0 +1,169 @@
+/*==============================================================================
+    Frame timing instrumentation. Per stage timing statistics on TMR1.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "CHRPMini.h"        // Include CHRPMini constant symbols and functions
+#include    "Servo.h"           // Include servo engine constants and functions
+#include    "Tick.h"            // Include system tick constants and functions
+#include    "Profile.h"         // Include instrumentation constants and functions
+
+#if PROFILE_ENABLE
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+profStage_t asProf[PROF_COUNT];
+unsigned int nProfOverruns;
+unsigned int anProfStart[PROF_COUNT];
+//anProfStart is the TMR1 time each stage last started
+unsigned char cProfFrame;
+//cProfFrame is the servo frame count at the last servo task
+bool isProfFrameStarted;
+//isProfFrameStarted is false until the first servo task has been marked
+unsigned char cProfBlinks;
+unsigned int nProfDue;
+bool isProfReporting;
+//cProfBlinks is the blinks of the report left to show, nProfDue the
+//millis() time the run LED next changes while isProfReporting
+
+/*==============================================================================
+    PROF NOW
+        Reads TMR1. Reading TMR1L latches TMR1H (16-bit read mode).
+==============================================================================*/
+static unsigned int profNow(void) {
+    unsigned int nTime;
+
+    nTime = TMR1L;
+    nTime |= (unsigned int) TMR1H << 8;
+    return nTime;
+}
+
+/*==============================================================================
+    PROF RECORD
+        Adds one time to a stage's statistics and histogram.
+==============================================================================*/
+static void profRecord(unsigned char stage, unsigned int nTime) {
+    profStage_t *prof = &asProf[stage];
+    unsigned char cBin = 0;
+    unsigned int nBits = nTime;
+
+    if (nTime < prof->nMin) {
+        prof->nMin = nTime;
+    }
+    if (nTime > prof->nMax) {
+        prof->nMax = nTime;
+    }
+    prof->lSum += nTime;
+    prof->nCount++;
+
+    while (nBits > 1) { // cBin = floor(log2(nTime))
+        nBits >>= 1;
+        cBin++;
+    }
+    if (prof->acHist[cBin] == 255) {
+        for (unsigned char i = 0; i < PROF_BINS; i++) {
+            prof->acHist[i] >>= 1;
+        }
+    }
+    prof->acHist[cBin]++;
+}
+
+/*==============================================================================
+    PROF BEGIN / PROF END
+        Time one stage. The TMR1 subtraction wraps correctly for any stage
+        shorter than 43.7ms.
+==============================================================================*/
+void profBegin(unsigned char stage) {
+    anProfStart[stage] = profNow();
+}
+
+void profEnd(unsigned char stage) {
+    profRecord(stage, profNow() - anProfStart[stage]);
+}
+
+/*==============================================================================
+    PROF FRAME
+        Times from one servo task to the next and counts overruns. The servo
+        task should run once per servo frame, so if more than one frame has
+        started since the last call the task has missed a frame. The run LED
+        is lit on the first overrun and stays lit until profReport(), unless
+        a report is being blinked.
+==============================================================================*/
+void profFrame(void) {
+    unsigned char cFrame = (unsigned char) nServoFrames;
+
+    if (isProfFrameStarted) {
+        profEnd(PROF_FRAME);
+        if ((unsigned char) (cFrame - cProfFrame) > 1) {
+            nProfOverruns++;
+            if (!isProfReporting) {
+                RUNLED = 1;
+            }
+        }
+    }
+    cProfFrame = cFrame;
+    isProfFrameStarted = true;
+    profBegin(PROF_FRAME);
+}
+
+/*==============================================================================
+    PROF REPORT
+        Starts blinking the overrun count (up to 15) on the run LED, and
+        clears the overrun count. profService() blinks it in the background,
+        after a 500ms pause with the LED off.
+==============================================================================*/
+void profReport(void) {
+    cProfBlinks = (nProfOverruns > 15) ? 15 : (unsigned char) nProfOverruns;
+    nProfOverruns = 0;
+    RUNLED = 0;
+    nProfDue = millis() + PROF_PAUSE_MS;
+    isProfReporting = true;
+}
+
+/*==============================================================================
+    PROF SERVICE
+        Steps the report blinks off the system tick. Call from a task, it
+        never waits.
+==============================================================================*/
+void profService(void) {
+    if (!isProfReporting || (int) (millis() - nProfDue) < 0) {
+        return;
+    }
+    if (RUNLED) {
+        RUNLED = 0;
+        nProfDue += PROF_OFF_MS;
+    } else if (cProfBlinks != 0) {
+        cProfBlinks--;
+        RUNLED = 1;
+        nProfDue += PROF_ON_MS;
+    } else {
+        isProfReporting = false;
+        RUNLED = nProfOverruns != 0; // Overruns while it was blinking
+    }
+}
+
+/*==============================================================================
+    INIT PROFILE
+        Starts TMR1 free running and clears all statistics.
+==============================================================================*/
+void initProfile(void) {
+    for (unsigned char i = 0; i < PROF_COUNT; i++) {
+        asProf[i].nMin = 0xFFFF;
+        asProf[i].nMax = 0;
+        asProf[i].lSum = 0;
+        asProf[i].nCount = 0;
+        for (unsigned char j = 0; j < PROF_BINS; j++) {
+            asProf[i].acHist[j] = 0;
+        }
+        anProfStart[i] = 0;
+    }
+    nProfOverruns = 0;
+    isProfFrameStarted = false;
+    isProfReporting = false;
+    T1CON = 0b00110011; // FOSC/4, 1:8 prescaler, 16-bit reads, TMR1 on
+}
+
+#endif
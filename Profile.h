@@ -0,0 +1,77 @@
+/*==============================================================================
+    Frame timing instrumentation (PIC18F25K50) constants and prototypes.
+==============================================================================*/
+
+// Build with PROFILE_ENABLE=1 to time each stage of the main loop tasks. When it is
+// 0 (the default) every PROF_ macro is empty and no code or RAM is used.
+//
+// TMR0 is reloaded by the servo engine at every pulse edge, so it cannot be
+// used as a clock. Stages are timed with TMR1 instead, running free from
+// FOSC/4 with a 1:8 prescaler: 1 tick = 2/3us, wrapping every 43.7ms.
+//
+// Each stage keeps its min, max, total and count (mean = lSum / nCount) and a
+// log2 histogram: bin n counts times from 2^n to 2^(n+1)-1 ticks. Bins are
+// bytes; when one fills, all bins of that stage are halved so the shape is
+// kept. Read asProf[] in the debugger watch window, or call profReport() to
+// blink the number of overrun frames on the run LED. The blinks are timed off
+// the system tick by profService(), so the tasks keep running meanwhile.
+
+#ifndef PROFILE_ENABLE
+#define PROFILE_ENABLE      0
+#endif
+
+#define PROF_SENSORS        0           // convertSensors()
+#define PROF_CONSTRAIN      1           // constrainPose()
+#define PROF_COMMANDS       2           // commands() and heyKidWantSomeCandy()
+#define PROF_CHECKMODE      3           // checkMode()
+#define PROF_PULSE          4           // pulseServos()
+#define PROF_RECORD         5           // recordService()
+#define PROF_CALIBRATE      6           // calibrate()
+#define PROF_FRAME          7           // Servo task to servo task
+#define PROF_CLASSIFY       8           // classifyPose()
+#define PROF_IDLE           9           // powerIdle(), CPU in Idle mode
+#define PROF_COUNT          10
+#define PROF_BINS           16
+
+// Run LED timing of profReport(), in milliseconds of the system tick.
+
+#define PROF_PAUSE_MS       500         // LED off before the first blink
+#define PROF_ON_MS          150         // Each blink
+#define PROF_OFF_MS         250         // Between blinks
+
+#if PROFILE_ENABLE
+
+typedef struct {
+    unsigned int nMin, nMax;            // Shortest and longest time in ticks
+    unsigned long lSum;                 // Total time in ticks
+    unsigned int nCount;                // Number of times measured
+    unsigned char acHist[PROF_BINS];    // log2 histogram of times
+} profStage_t;
+
+extern profStage_t asProf[PROF_COUNT]; // Statistics of each stage
+extern unsigned int nProfOverruns; // Main loops that took more than one servo frame
+
+void initProfile(void); // Start TMR1 and clear all statistics.
+void profBegin(unsigned char stage); // Mark the start of a stage.
+void profEnd(unsigned char stage); // Mark the end of a stage and record its time.
+void profFrame(void); // Call once at the top of each servo task.
+void profReport(void); // Start blinking the overrun count on the run LED.
+void profService(void); // Blink the report, call from a task.
+
+#define INIT_PROFILE()      initProfile()
+#define PROF_BEGIN(stage)   profBegin(stage)
+#define PROF_END(stage)     profEnd(stage)
+#define PROF_FRAME_MARK()   profFrame()
+#define PROF_REPORT()       profReport()
+#define PROF_SERVICE()      profService()
+
+#else
+
+#define INIT_PROFILE()
+#define PROF_BEGIN(stage)
+#define PROF_END(stage)
+#define PROF_FRAME_MARK()
+#define PROF_REPORT()
+#define PROF_SERVICE()
+
+#endif
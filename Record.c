@@ -0,0 +1,251 @@
+/*==============================================================================
+    Glove motion recorder. Delta and run-length coded poses in program flash.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "CHRPMini.h"        // Include CHRPMini constant symbols and functions
+#include    "Servo.h"           // Include servo engine constants and functions
+#include    "Sensors.h"         // Include sensor acquisition constants and functions
+#include    "Tick.h"            // Include system tick constants and functions
+#include    "Record.h"          // Include recorder constants and functions
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+unsigned char acRecBuf[2][FLASHBLOCK];
+//acRecBuf holds two flash blocks. The encoder fills one while the other waits
+//for a gap in the servo frame to be written.
+unsigned char cRecFill, cRecBuf, cRecRun;
+//cRecFill is the next byte of the block being filled, cRecBuf is that block
+//cRecRun is the length of the run being counted, 0 if none
+unsigned int nRecAddr, nRecWriteAddr;
+//nRecAddr is the flash address of the block being filled
+//nRecWriteAddr is the address of the full block waiting to be written, 0 if none
+unsigned int nRecEraseAddr;
+//nRecEraseAddr is a block waiting to be erased, 0 if none
+unsigned char acRecLast[SERVOCOUNT];
+//acRecLast is the pose the player will have rebuilt so far
+unsigned int nRecTime;
+//nRecTime is when the next frame is due, for both recording and playback
+bool isRecording, isRecFirst, isRecFlush;
+//isRecFlush is set when the partly filled block must be written at the end
+
+unsigned int nPlayAddr;
+//nPlayAddr is the flash address of the next record to play
+unsigned char cPlayRun, cPlayInterval;
+//cPlayRun is the frames left in the run being played
+//cPlayInterval is the recorded frame interval in ms
+
+/*==============================================================================
+    REC PUT
+        Adds one byte to the block being filled. A full block is handed over
+        to recordService() to be written. A block takes at least 10 frames
+        to fill and 2 to write, so the writer never falls a block behind.
+==============================================================================*/
+static void recPut(unsigned char cByte) {
+    acRecBuf[cRecBuf][cRecFill++] = cByte;
+    if (cRecFill == FLASHBLOCK) {
+        nRecWriteAddr = nRecAddr;
+        nRecAddr += FLASHBLOCK;
+        cRecBuf ^= 1;
+        cRecFill = 0;
+    }
+}
+
+/*==============================================================================
+    REC FLUSH RUN
+        Writes out the run being counted, if any.
+==============================================================================*/
+static void recFlushRun(void) {
+    if (cRecRun != 0) {
+        recPut(REC_TAG_RUN | (cRecRun - 1));
+        cRecRun = 0;
+    }
+}
+
+/*==============================================================================
+    RECORD START
+==============================================================================*/
+void recordStart(void) {
+    nRecAddr = REC_FLASH_START;
+    nRecWriteAddr = 0;
+    nRecEraseAddr = REC_FLASH_START; // Cleared before the first block is written
+    cRecBuf = 0;
+    cRecFill = 0;
+    cRecRun = 0;
+    isRecFirst = true;
+    isRecFlush = false;
+    isRecording = true;
+    recPut(REC_INTERVAL_MS);
+    nRecTime = millis();
+}
+
+/*==============================================================================
+    RECORD FRAME
+        Codes one frame every REC_INTERVAL_MS. The cost is a fixed handful of
+        compares per finger, so it fits beside sensor conversion in any frame.
+==============================================================================*/
+void recordFrame(const unsigned char *pos) {
+    signed char acDelta[SERVOCOUNT];
+    bool isSame = true, isSmall = true;
+
+    if (!isRecording || (int) (millis() - nRecTime) < 0) {
+        return;
+    }
+    nRecTime += REC_INTERVAL_MS;
+    if (nRecAddr + FLASHBLOCK >= REC_FLASH_END && cRecFill > FLASHBLOCK - 8) {
+        recordStop(); // Region full, the next records might not fit
+        return;
+    }
+
+    for (unsigned char i = 0; i < SERVOCOUNT; i++) {
+        int nDelta = (int) pos[i] - acRecLast[i];
+        if (nDelta > REC_DEADBAND || nDelta < -REC_DEADBAND) {
+            isSame = false;
+        }
+        if (nDelta > 7 || nDelta < -8) {
+            isSmall = false;
+        }
+        acDelta[i] = (signed char) nDelta;
+    }
+
+    if (isSame && !isRecFirst) {
+        cRecRun++;
+        if (cRecRun == REC_RUN_MAX) {
+            recFlushRun();
+        }
+        return;
+    }
+    recFlushRun();
+    if (isSmall && !isRecFirst) {
+        recPut(REC_TAG_DELTA | ((acDelta[0] & 0x0F) << 2));
+        recPut(((acDelta[1] & 0x0F) << 4) | (acDelta[2] & 0x0F));
+        recPut(((acDelta[3] & 0x0F) << 4) | (acDelta[4] & 0x0F));
+        for (unsigned char i = 0; i < SERVOCOUNT; i++) {
+            acRecLast[i] += acDelta[i];
+        }
+    } else {
+        recPut(REC_TAG_FULL);
+        for (unsigned char i = 0; i < SERVOCOUNT; i++) {
+            recPut(pos[i]);
+            acRecLast[i] = pos[i];
+        }
+    }
+    isRecFirst = false;
+}
+
+/*==============================================================================
+    RECORD STOP
+        Ends the recording and marks the partly filled block to be written.
+        The rest of the block is left as 0xFF, which reads as the end.
+==============================================================================*/
+void recordStop(void) {
+    if (!isRecording) {
+        return;
+    }
+    recFlushRun();
+    isRecording = false;
+    for (unsigned char i = cRecFill; i < FLASHBLOCK; i++) {
+        acRecBuf[cRecBuf][i] = REC_END;
+    }
+    isRecFlush = true;
+}
+
+/*==============================================================================
+    RECORD SERVICE
+        Does at most one flash erase or write, and only when the servo frame
+        has enough pulse-free time left to hide the 2ms processor stall.
+        Call it every millisecond; it returns straight away while the
+        pulses of a frame are running or the gap is too short.
+        After each block is written the next block is erased, so there is
+        always an end marker after the recorded data.
+==============================================================================*/
+void recordService(void) {
+    if (nRecEraseAddr == 0 && nRecWriteAddr == 0 && !isRecFlush) {
+        return;
+    }
+    if (servoGapTicks() < REC_MIN_GAP_TICKS) { // 0 while pulses are running
+        return;
+    }
+    if (eepromBusy()) { // A flash write must not start over a data EEPROM write
+        return;
+    }
+    if (nRecEraseAddr != 0) {
+        flashErase(nRecEraseAddr);
+        nRecEraseAddr = 0;
+    } else if (nRecWriteAddr != 0) {
+        flashWrite(nRecWriteAddr, acRecBuf[cRecBuf ^ 1]);
+        if (nRecWriteAddr + FLASHBLOCK < REC_FLASH_END) {
+            nRecEraseAddr = nRecWriteAddr + FLASHBLOCK;
+        }
+        nRecWriteAddr = 0;
+    } else if (isRecFlush) {
+        flashWrite(nRecAddr, acRecBuf[cRecBuf]);
+        isRecFlush = false;
+    }
+    tickLost(REC_STALL_SLOTS); // Every path above stopped the processor
+}
+
+bool recordIsBusy(void) {
+    return nRecEraseAddr != 0 || nRecWriteAddr != 0 || isRecFlush;
+}
+
+/*==============================================================================
+    PLAY START
+==============================================================================*/
+void playStart(void) {
+    nPlayAddr = REC_FLASH_START;
+    cPlayInterval = flashRead(nPlayAddr++);
+    cPlayRun = 0;
+    nRecTime = millis();
+}
+
+/*==============================================================================
+    PLAY FRAME
+        Decodes the next frame when it is due and writes the pose into pos.
+        Between frames pos is left alone. Returns false once the recording
+        has ended (or if nothing was ever recorded).
+==============================================================================*/
+bool playFrame(unsigned char *pos) {
+    unsigned char cTag, cByte;
+
+    if (cPlayInterval == REC_END || nPlayAddr >= REC_FLASH_END) {
+        return false;
+    }
+    if ((int) (millis() - nRecTime) < 0) {
+        return true;
+    }
+    nRecTime += cPlayInterval;
+
+    if (cPlayRun != 0) {
+        cPlayRun--; // Pose unchanged
+        return true;
+    }
+    cTag = flashRead(nPlayAddr++);
+    switch (cTag & REC_TAG_MASK) {
+        case REC_TAG_RUN:
+            if (cTag == REC_END) {
+                nPlayAddr--;
+                return false;
+            }
+            cPlayRun = cTag & 0b00111111; // This frame is the first of the run
+            break;
+        case REC_TAG_DELTA:
+            pos[0] += (signed char) ((cTag << 2) & 0xF0) >> 4;
+            cByte = flashRead(nPlayAddr++);
+            pos[1] += (signed char) (cByte & 0xF0) >> 4;
+            pos[2] += (signed char) (cByte << 4) >> 4;
+            cByte = flashRead(nPlayAddr++);
+            pos[3] += (signed char) (cByte & 0xF0) >> 4;
+            pos[4] += (signed char) (cByte << 4) >> 4;
+            break;
+        default:
+            for (unsigned char i = 0; i < SERVOCOUNT; i++) {
+                pos[i] = flashRead(nPlayAddr++);
+            }
+            break;
+    }
+    return true;
+}
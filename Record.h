@@ -0,0 +1,63 @@
+/*==============================================================================
+    Glove motion recorder (PIC18F25K50) constants and function prototypes.
+==============================================================================*/
+
+// Records the glove pose every REC_INTERVAL_MS into a reserved region of
+// program flash and plays it back at the same rate. The region must be kept
+// out of the linker's ROM ranges (see the note at the top of Hand.c).
+//
+// Recording format. The first byte is the frame interval in ms. Each record
+// after that starts with a tag byte:
+//     01------ a b c d e      Full frame, 6 bytes.
+//     10aaaa-- bbbbcccc ddddeeee
+//                             Every finger moved by -8..+7, 3 bytes.
+//     11nnnnnn                The pose did not change for n + 1 frames
+//                             (n is 0 to 62), 1 byte.
+//     11111111                End of recording (erased flash).
+// Changes of up to REC_DEADBAND count as no change, which keeps sensor
+// noise from breaking up runs. The encoder compares against the pose the
+// player will rebuild, so this error never adds up.
+//
+// A frame is 5 bytes raw. A still hand costs 1 byte per 63 frames, slow
+// motion 3 bytes and fast motion 6 bytes per frame. Glove traces with pauses
+// between gestures typically compress 3 to 5 times. The 4kB region holds
+// 27s of non-stop fast motion at 25 frames/s, about 54s of slow motion,
+// and some minutes of typical use.
+//
+// Flash blocks are erased and written only in the pulse-free gap at the end
+// of a servo frame, one 2ms stall per frame, so servo pulses are never
+// stretched. The block after the last one written is always erased, so a
+// recording cut short by a power loss still ends cleanly.
+//
+// The low priority interrupts wait out the stall as well. Of the TMR2
+// interrupts it covers only the last is taken, so REC_STALL_SLOTS are lost;
+// they are added back to the tick (tickLost()) so that millis() keeps time,
+// to within a slot as the stall is not exact. The ISR's millisecond work
+// (telemetry, beeper, button) runs once for the 2ms, and about 1.5 rounds
+// of A-D samples are not taken. The EUSART receiver holds only 2 bytes, so
+// remote bytes that arrive during a stall overrun it (about 100 at
+// TELEM_BAUD): the packet is lost and the receiver waits for the next sync.
+// A peer should not count on commands sent while the hand records.
+
+#define REC_FLASH_START     0x6000      // First byte of the recording region
+#define REC_FLASH_END       0x7000      // First byte after the region
+#define REC_INTERVAL_MS     40          // Time between recorded frames
+#define REC_DEADBAND        1           // Largest change treated as none
+#define REC_MIN_GAP_TICKS   (3000 * SERVO_TICKS_PER_US) // Gap needed for a flash stall
+#define REC_STALL_US        2000        // Processor stall of a flash erase or write
+#define REC_STALL_SLOTS     (REC_STALL_US / ADC_SLOT_US - 1) // TMR2 interrupts it loses
+
+#define REC_TAG_MASK        0b11000000
+#define REC_TAG_FULL        0b01000000
+#define REC_TAG_DELTA       0b10000000
+#define REC_TAG_RUN         0b11000000
+#define REC_RUN_MAX         63          // Frames in the longest run
+#define REC_END             0xFF
+
+void recordStart(void); // Erase the start of the region and begin recording.
+void recordFrame(const unsigned char *pos); // Record the pose, call often.
+void recordStop(void); // Finish the recording.
+void recordService(void); // Do pending flash work, call every ms.
+bool recordIsBusy(void); // True while flash work is still pending.
+void playStart(void); // Start playing the recording from the beginning.
+bool playFrame(unsigned char *pos); // Write the pose for now into pos, false at the end.
@@ -0,0 +1,219 @@
+/*==============================================================================
+    Remote pose command channel. Binary packets received on the EUSART.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "CHRPMini.h"        // Include CHRPMini constant symbols and functions
+#include    "Sensors.h"         // Include sensor acquisition constants and functions
+#include    "Remote.h"          // Include remote channel constants and functions
+
+#define RX_SYNC1            0           // Receiver states
+#define RX_SYNC2            1
+#define RX_TYPE             2
+#define RX_PAYLOAD          3
+#define RX_CHECKSUM         4
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+unsigned char acRemotePose[3][SENSORCOUNT];
+unsigned int anRemoteStamp[3];
+//acRemotePose and anRemoteStamp are three pose buffers and their stamps
+volatile unsigned char cRemoteNewest, cRemoteInUse;
+//cRemoteNewest is the newest whole pose, cRemoteInUse the one the main loop has
+unsigned char cRxState, cRxType, cRxCount, cRxLength, cRxSum, cRxBuf;
+//cRxBuf is the pose buffer the receiver is writing
+unsigned char acRxPayload[REMOTE_MAX_PAYLOAD];
+//acRxPayload holds the payload of other packet types
+unsigned char acRemoteArgs[6], acRemoteTaken[6];
+//acRemoteArgs is the payload of the last good REMOTE_TRIM or REMOTE_CHANNEL
+//packet, acRemoteTaken the copy remoteCommand() took with its command
+volatile unsigned char cRemoteCmdType, cRemoteCmdValue;
+//cRemoteCmdType is a mode, gesture, trim or channel command waiting for the main loop, 0 if none
+volatile bool isRemotePoseNew;
+//isRemotePoseNew is set by each pose, which has its own flag so a stream of
+//poses cannot overwrite a command before the main loop has taken it
+volatile unsigned int nRemoteEcho, nRemoteBad;
+
+/*==============================================================================
+    REMOTE RX ISR
+        Runs the packet receiver one byte at a time. Pose bytes are stored
+        directly in a free pose buffer, which becomes the newest pose only
+        when the checksum is right.
+==============================================================================*/
+void remoteRxISR(void) {
+    unsigned char cByte;
+
+    if (RCSTA1 & 0b00000010) { // Overrun, the receiver stops until reset
+        RCSTA1 &= 0b11101111;
+        RCSTA1 |= 0b00010000;
+        cRxState = RX_SYNC1;
+    }
+    cByte = RCREG1;
+
+    switch (cRxState) {
+        case RX_SYNC1:
+            if (cByte == REMOTE_SYNC1) {
+                cRxState = RX_SYNC2;
+            }
+            return;
+        case RX_SYNC2:
+            cRxState = (cByte == REMOTE_SYNC2) ? RX_TYPE : (cByte == REMOTE_SYNC1) ? RX_SYNC2 : RX_SYNC1;
+            return;
+        case RX_TYPE:
+            cRxType = cByte;
+            cRxSum = cByte;
+            cRxCount = 0;
+            if (cByte == REMOTE_POSE) {
+                cRxLength = SENSORCOUNT + 2;
+                cRxBuf = 0; // Pick a buffer that is neither newest nor in use
+                while (cRxBuf == cRemoteNewest || cRxBuf == cRemoteInUse) {
+                    cRxBuf++;
+                }
+            } else if (cByte == REMOTE_MODE || cByte == REMOTE_GESTURE) {
+                cRxLength = 1;
+            } else if (cByte == REMOTE_TRIM) {
+                cRxLength = 6;
+            } else if (cByte == REMOTE_CHANNEL) {
+                cRxLength = 2;
+            } else {
+                nRemoteBad++;
+                cRxState = RX_SYNC1;
+                return;
+            }
+            cRxState = RX_PAYLOAD;
+            return;
+        case RX_PAYLOAD:
+            cRxSum += cByte;
+            if (cRxType == REMOTE_POSE && cRxCount < SENSORCOUNT) {
+                acRemotePose[cRxBuf][cRxCount] = cByte; // Straight into the pose buffer
+            } else {
+                acRxPayload[cRxCount] = cByte;
+            }
+            cRxCount++;
+            if (cRxCount == cRxLength) {
+                cRxState = RX_CHECKSUM;
+            }
+            return;
+        default:
+            cRxState = RX_SYNC1;
+            if ((unsigned char) (cRxSum + cByte) != 0) {
+                nRemoteBad++;
+                return;
+            }
+            if (cRxType == REMOTE_POSE) {
+                anRemoteStamp[cRxBuf] = acRxPayload[SENSORCOUNT] | ((unsigned int) acRxPayload[SENSORCOUNT + 1] << 8);
+                cRemoteNewest = cRxBuf; // Publish the pose
+                isRemotePoseNew = true;
+            } else {
+                if (cRxType == REMOTE_MODE || cRxType == REMOTE_GESTURE) {
+                    isRemotePoseNew = false; // A later mode or gesture wins
+                }
+                if (cRxType == REMOTE_TRIM || cRxType == REMOTE_CHANNEL) {
+                    for (unsigned char i = 0; i < 6; i++) {
+                        acRemoteArgs[i] = acRxPayload[i];
+                    }
+                }
+                cRemoteCmdType = cRxType;
+                cRemoteCmdValue = acRxPayload[0];
+            }
+            return;
+    }
+}
+
+/*==============================================================================
+    REMOTE POSE
+        Claims the newest remote pose and returns a pointer to it. The ISR
+        will not write this buffer until the next claim.
+==============================================================================*/
+unsigned char *remotePose(void) {
+    GIEL = 0; // The ISR picks its buffer from these two
+    cRemoteInUse = cRemoteNewest;
+    GIEL = 1;
+    return acRemotePose[cRemoteInUse];
+}
+
+/*==============================================================================
+    REMOTE POSED
+        Echoes the stamp of the claimed pose in telemetry.
+==============================================================================*/
+void remotePosed(void) {
+    unsigned int nStamp = anRemoteStamp[cRemoteInUse];
+
+    GIEL = 0; // Two byte value also read by the telemetry ISR
+    nRemoteEcho = nStamp;
+    GIEL = 1;
+}
+
+/*==============================================================================
+    REMOTE COMMAND
+        Takes the command waiting from the peer, if any. Returns true and
+        sets type (REMOTE_POSE, REMOTE_MODE, REMOTE_GESTURE, REMOTE_TRIM or
+        REMOTE_CHANNEL) and value. The value of REMOTE_TRIM is the servo
+        byte and that of REMOTE_CHANNEL the channel; the rest of their
+        payload is taken with them, for remoteTrim() and remoteChannel(). A
+        waiting command is returned before a new pose, which is then
+        returned by the next call.
+==============================================================================*/
+bool remoteCommand(unsigned char *type, unsigned char *value) {
+    GIEL = 0;
+    *type = cRemoteCmdType;
+    *value = cRemoteCmdValue;
+    cRemoteCmdType = 0;
+    if (*type == REMOTE_TRIM || *type == REMOTE_CHANNEL) {
+        for (unsigned char i = 0; i < 6; i++) {
+            acRemoteTaken[i] = acRemoteArgs[i]; // Taken with the type, so a newer packet cannot mix in
+        }
+    }
+    if (*type == 0 && isRemotePoseNew) {
+        *type = REMOTE_POSE;
+        isRemotePoseNew = false;
+    }
+    GIEL = 1;
+    return *type != 0;
+}
+
+/*==============================================================================
+    REMOTE TRIM
+        Reads the trims of the REMOTE_TRIM command remoteCommand() has just
+        returned, from the payload it took with it.
+==============================================================================*/
+void remoteTrim(unsigned int *minUs, unsigned int *maxUs, bool *reverse) {
+    *minUs = acRemoteTaken[1] | ((unsigned int) acRemoteTaken[2] << 8);
+    *maxUs = acRemoteTaken[3] | ((unsigned int) acRemoteTaken[4] << 8);
+    *reverse = acRemoteTaken[5] != 0;
+}
+
+/*==============================================================================
+    REMOTE CHANNEL
+        Reads the position of the REMOTE_CHANNEL command remoteCommand() has
+        just returned, from the payload it took with it.
+==============================================================================*/
+unsigned char remoteChannel(void) {
+    return acRemoteTaken[1];
+}
+
+/*==============================================================================
+    INIT REMOTE
+        Turns on the receiver. Call after initTelemetry, which sets the baud
+        rate and turns the serial port on.
+==============================================================================*/
+void initRemote(void) {
+    cRemoteNewest = 0;
+    cRemoteInUse = 0;
+    cRxState = RX_SYNC1;
+    cRemoteCmdType = 0;
+    isRemotePoseNew = false;
+    nRemoteEcho = 0;
+    nRemoteBad = 0;
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        acRemotePose[0][i] = 0;
+    }
+    anRemoteStamp[0] = 0;
+    RCSTA1 |= 0b00010000; // CREN, continuous receive
+    RC1IP = 0; // Low priority
+    RC1IF = 0;
+    RC1IE = 1;
+}
@@ -0,0 +1,60 @@
+/*==============================================================================
+    Remote pose command channel (PIC18F25K50) constants and prototypes.
+==============================================================================*/
+
+// Lets a PC or a second glove drive the hand over the EUSART receive pin
+// (RC7, TELEM_BAUD 8N1). RC7 is shared with the IR demodulator U5, which
+// has to be removed (or its output left idle) while a serial cable is used.
+// tools/remote_peer.c is a stand-in peer that also measures latency.
+//
+// Packet format:
+//     0-1     0xA5 0xC3       sync
+//     2       type            REMOTE_POSE, REMOTE_MODE, REMOTE_GESTURE, REMOTE_TRIM
+//                             or REMOTE_CHANNEL
+//     3-      payload         see below
+//     last    checksum        bytes 2 to last add up to 0
+//
+//     REMOTE_POSE     thumb index middle ring pinkie stampL stampH (7 bytes)
+//         Sets all five finger targets and switches to MODE_REMOTE.
+//         The stamp is echoed in every telemetry frame once the pose has
+//         been sent to the servos, so the peer can time the round trip.
+//     REMOTE_MODE     mode (1 byte)
+//     REMOTE_GESTURE  gesture (1 byte), plays it in mode 1
+//     REMOTE_TRIM     servo minL minH maxL maxH reverse (6 bytes)
+//         Sets one servo's endpoint trims in microseconds (Servo.h). Bit 7
+//         of the servo byte (REMOTE_TRIM_STORE) also stores all the trims in
+//         EEPROM, so trims can be tried out live and kept once they are right.
+//     REMOTE_CHANNEL  channel position (2 bytes)
+//         Moves one of the servo channels after the fingers (Servo.h), eg.
+//         the wrist of the wrist variant. It holds there until the next
+//         REMOTE_CHANNEL, whatever mode the hand is in. Finger channels
+//         are ignored.
+//
+// Pose bytes go straight from the receive register into one of three pose
+// buffers. A finished pose is published by switching an index, and the main
+// loop reads it where it is, so the ISR never copies a pose.
+// With three buffers the ISR always has one that is neither the newest nor
+// the one the main loop is reading.
+
+#define REMOTE_SYNC1        0xA5
+#define REMOTE_SYNC2        0xC3
+#define REMOTE_POSE         0x01
+#define REMOTE_MODE         0x02
+#define REMOTE_GESTURE      0x03
+#define REMOTE_TRIM         0x04
+#define REMOTE_CHANNEL      0x05
+#define REMOTE_TRIM_STORE   0x80        // Servo byte flag, store the trims
+#define REMOTE_MAX_PAYLOAD  7
+
+#define MODE_REMOTE         5           // Mode that follows REMOTE_POSE packets
+
+extern volatile unsigned int nRemoteEcho; // Stamp of the last pose sent to the servos
+extern volatile unsigned int nRemoteBad; // Packets dropped for a bad checksum or type
+
+void initRemote(void); // Turn on the EUSART receiver.
+void remoteRxISR(void); // EUSART RX interrupt handler.
+unsigned char *remotePose(void); // Claim the newest remote pose.
+void remotePosed(void); // Call when the claimed pose has been sent to the servos.
+bool remoteCommand(unsigned char *type, unsigned char *value); // Take a mode, gesture, trim or channel command.
+void remoteTrim(unsigned int *minUs, unsigned int *maxUs, bool *reverse); // Read the trims of the REMOTE_TRIM just taken.
+unsigned char remoteChannel(void); // Read the position of the REMOTE_CHANNEL just taken.
@@ -0,0 +1,53 @@
+/*==============================================================================
+    Cooperative task scheduler. Fixed priority, driven by the 1ms tick.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "Tick.h"            // Include system tick constants and functions
+#include    "Sched.h"           // Include scheduler constants and functions
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+task_t *pSchedTasks;
+unsigned char cSchedCount;
+//pSchedTasks is the task table in priority order, cSchedCount its length
+
+/*==============================================================================
+    SCHED RUN
+        Runs the first due task in the table and schedules its next run.
+        Times are compared by subtraction so the millis() wrap is harmless.
+==============================================================================*/
+bool schedRun(void) {
+    unsigned int nNow = millis();
+    task_t *task = pSchedTasks;
+
+    for (unsigned char i = 0; i < cSchedCount; i++, task++) {
+        if ((int) (nNow - task->nDue) >= 0) {
+            task->nDue += task->nPeriod;
+            if ((int) (nNow - task->nDue) >= 0) {
+                task->nDue = nNow + task->nPeriod; // A period or more behind, skip ahead
+            }
+            task->pRun();
+            return true;
+        }
+    }
+    return false;
+}
+
+/*==============================================================================
+    INIT SCHED
+        Starts a task table. Every task is due straight away, so the first
+        pass runs them all once in priority order.
+==============================================================================*/
+void initSched(task_t *tasks, unsigned char count) {
+    unsigned int nNow = millis();
+
+    pSchedTasks = tasks;
+    cSchedCount = count;
+    for (unsigned char i = 0; i < count; i++) {
+        tasks[i].nDue = nNow;
+    }
+}
@@ -0,0 +1,22 @@
+/*==============================================================================
+    Cooperative task scheduler (PIC18F25K50) constants and prototypes.
+==============================================================================*/
+
+// Runs the main loop work as tasks, each at its own period in milliseconds
+// of the system tick (Tick.c). Tasks are kept in a table in priority order:
+// schedRun() runs the first task in the table that is due, so when several
+// are due together the higher one goes first. Tasks are never interrupted by
+// each other, so they must return quickly and never wait.
+//
+// A task that runs late keeps its rate (the next run is one period after
+// the time it was due), but if it falls more than a whole period behind the
+// missed runs are dropped instead of being run back to back.
+
+typedef struct {
+    void (*pRun)(void);                 // Task function
+    unsigned int nPeriod;               // Milliseconds between runs
+    unsigned int nDue;                  // millis() when the task next runs
+} task_t;
+
+void initSched(task_t *tasks, unsigned char count); // Use a task table, all tasks due now.
+bool schedRun(void); // Run the most urgent due task, false if none was due.
@@ -0,0 +1,441 @@
+/*==============================================================================
+    Flex sensor acquisition. Background round-robin A-D conversion on TMR2.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "CHRPMini.h"        // Include CHRPMini constant symbols and functions
+#include    "Servo.h"           // Include servo engine constants and functions
+#include    "Sensors.h"         // Include sensor acquisition constants and functions
+#include    "Tick.h"            // Include system tick constants and functions
+
+#if ADC_FVR_MV == 1024
+#define ADC_FVR_BITS    0b01            // VREFCON0 FVRS, 1.024V
+#elif ADC_FVR_MV == 2048
+#define ADC_FVR_BITS    0b10            // 2.048V
+#elif ADC_FVR_MV == 4096
+#define ADC_FVR_BITS    0b11            // 4.096V
+#else
+#error "ADC_FVR_MV must be 1024, 2048 or 4096"
+#endif
+
+#define ADC_AUX_SUPPLY  0               // Extra slot conversions, in turn
+#define ADC_AUX_TEMP    1
+#define ADC_AUX_EXT     2
+#define ADC_AUX_COUNT   (ADC_EXT_REF ? 3 : 2)
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+volatile unsigned char acAdcLatest[SENSORCOUNT];
+volatile unsigned int anAdcRing[SENSORCOUNT][ADC_RING_SIZE];
+volatile unsigned char acAdcHead[SENSORCOUNT];
+volatile unsigned int anAdcSamples[SENSORCOUNT];
+unsigned char cAdcSlot, cAdcAux;
+//cAdcSlot is the finger whose conversion is running, or SENSORCOUNT for the
+//extra slot, which converts the supply, the temperature or VREF+ as cAdcAux says
+volatile unsigned int nAdcSupply, nAdcSupplyPeak;
+volatile unsigned char cAdcTemp;
+volatile unsigned char acAdcRange[SENSORCOUNT], acAdcRangeNext[SENSORCOUNT];
+unsigned char cAdcConvRange;
+//acAdcRangeNext is the reference each channel is converted against from its next
+//slot, cAdcConvRange the one the running conversion uses
+volatile unsigned int anAdcScale[ADC_RANGES];
+const unsigned char acAdcRef[ADC_RANGES] = {ADREFVDD, ADREFFVR
+#if ADC_EXT_REF
+    , ADREFEXT
+#endif
+};
+//acAdcRef is the ADCON1 setting of each reference
+volatile unsigned int anAdcHigh[SENSORCOUNT], anAdcLow[SENSORCOUNT];
+//anAdcHigh and anAdcLow are the range of each channel's samples since the last look
+unsigned char acAdcBits[SENSORCOUNT], acAdcHold[SENSORCOUNT];
+unsigned int nAdcLookTime;
+volatile bool isAdcUnsteady;
+//acAdcHold counts the looks a lower reference has fitted, nAdcLookTime is the last look
+//isAdcUnsteady is set by the ISR when the supply moved since the last look
+unsigned int nAdcCopyScale;
+//nAdcCopyScale is the scale of the ring last copied by adcCopy()
+const unsigned char acAdcLog2Frac[16] = {0, 1, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 15};
+//acAdcLog2Frac is 16 x log2(1 + n/16)
+const unsigned char acFilter[SENSORCOUNT] = {FILTERTHUMB, FILTERINDEX,
+    FILTERMIDDLE, FILTERRING, FILTERPINKIE};
+//acFilter is the filter used for each finger, picked at build time
+unsigned int anSensorFine[SENSORCOUNT];
+unsigned char acSensorFiltered[SENSORCOUNT];
+unsigned int anIirState[SENSORCOUNT];
+//anIirState is the IIR output of each finger, a 16-bit fraction of VDD
+
+/*==============================================================================
+    ADC ISR
+        Stores the finished conversion and starts the next channel. Called
+        every ADC_SLOT_US, which is far longer than one conversion (~17us),
+        so the result is always ready. A flex sensor sample is kept whole in
+        the ring of its channel. The first sample on a new reference fills
+        the whole ring. A sample that clips on a reference below VDD moves
+        the channel back to VDD from its next slot.
+==============================================================================*/
+void adcISR(void) {
+    unsigned int nSample, nScale;
+    unsigned char cSlot = cAdcSlot, cSample, cHead;
+
+    TMR2IF = 0;
+    nSample = ADCRESULT10();
+    if (cSlot == SENSORCOUNT) { // Supply, temperature or external reference
+        if (cAdcAux == ADC_AUX_SUPPLY) {
+            nAdcSupply = nSample;
+            if (nSample > nAdcSupplyPeak) {
+                nAdcSupplyPeak = nSample; // Lower VDD gives a higher result
+            }
+            nScale = anAdcScale[ADC_RANGE_FVR]; // Smoothed over 4 readings, 10.4 fixed point
+            if ((nSample << 4) > nScale + (nScale >> ADC_STEADY_SHIFT)
+                    || (nSample << 4) < nScale - (nScale >> ADC_STEADY_SHIFT)) {
+                isAdcUnsteady = true; // Supply moved, back to VDD until it settles
+                for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+                    acAdcRangeNext[i] = ADC_RANGE_VDD;
+                }
+            }
+            anAdcScale[ADC_RANGE_FVR] = nScale - (nScale >> 2) + (nSample << 2);
+        } else if (cAdcAux == ADC_AUX_TEMP) {
+            cAdcTemp = (unsigned char) (nSample >> 2);
+        }
+#if ADC_EXT_REF
+        else {
+            nScale = anAdcScale[ADC_RANGE_EXT];
+            anAdcScale[ADC_RANGE_EXT] = nScale - (nScale >> 2) + (nSample << 2);
+        }
+#endif
+        cAdcAux = (cAdcAux + 1 == ADC_AUX_COUNT) ? 0 : cAdcAux + 1;
+        cSlot = 0;
+    } else {
+        cHead = acAdcHead[cSlot];
+        if (cAdcConvRange != acAdcRange[cSlot]) { // First sample on a new reference
+            acAdcRange[cSlot] = cAdcConvRange;
+            for (unsigned char i = 0; i < ADC_RING_SIZE; i++) {
+                anAdcRing[cSlot][i] = nSample;
+            }
+            anAdcHigh[cSlot] = 0;
+            anAdcLow[cSlot] = 0xFFFF;
+        }
+        anAdcRing[cSlot][cHead] = nSample;
+        acAdcHead[cSlot] = (cHead + 1) & (ADC_RING_SIZE - 1);
+        if (nSample > anAdcHigh[cSlot]) {
+            anAdcHigh[cSlot] = nSample;
+        }
+        if (nSample < anAdcLow[cSlot]) {
+            anAdcLow[cSlot] = nSample;
+        }
+        if (cAdcConvRange == ADC_RANGE_VDD) {
+            cSample = (unsigned char) (nSample >> 2); // Upper 8-bits of the result
+        } else {
+            if (nSample >= ADC_CLIP) {
+                acAdcRangeNext[cSlot] = ADC_RANGE_VDD; // Too high for this reference
+            }
+            cSample = (unsigned char) (((unsigned int) (unsigned char) (nSample >> 2)
+                    * (unsigned char) (anAdcScale[cAdcConvRange] >> 6)) >> 8); // 8x8 multiply, to 8 bits of VDD
+        }
+#if SENSOR_INVERT
+        cSample = (unsigned char) ~cSample; // Inverted for a high side sensor
+#endif
+        acAdcLatest[cSlot] = cSample;
+        anAdcSamples[cSlot]++;
+        cSlot++;
+    }
+
+    if (cSlot == SENSORCOUNT) { // Select the next channel
+        ADCREFERENCE(ADREFVDD); // Measured against VDD
+        if (cAdcAux == ADC_AUX_SUPPLY) {
+            ADCSELECT(ADFVR);
+        } else if (cAdcAux == ADC_AUX_TEMP) {
+            ADCSELECT(ADTD);
+        } else {
+            ADCSELECT(ADVREFP);
+        }
+    } else {
+        cAdcConvRange = acAdcRangeNext[cSlot];
+        ADCREFERENCE(acAdcRef[cAdcConvRange]);
+        ADCSELECT(asServoChannel[cSlot].cSensor); // From the servo channel table
+    }
+    cAdcSlot = cSlot;
+    ADCSTART(); // Conversion starts after the acquisition time
+}
+
+/*==============================================================================
+    ADC COPY
+        Copies the ring of one finger into ring, oldest sample first, with
+        the A-D interrupt held off (~60 cycles) so no sample is torn and the
+        samples and their reference always go together. Leaves the scale of
+        that reference in nAdcCopyScale and returns the reference.
+==============================================================================*/
+static unsigned char adcCopy(unsigned char finger, unsigned int *ring) {
+    unsigned char cIndex, cRange;
+
+    GIEL = 0;
+    cIndex = acAdcHead[finger];
+    for (unsigned char i = 0; i < ADC_RING_SIZE; i++) {
+        ring[i] = anAdcRing[finger][cIndex];
+        cIndex = (cIndex + 1) & (ADC_RING_SIZE - 1);
+    }
+    cRange = acAdcRange[finger];
+    nAdcCopyScale = anAdcScale[cRange];
+    GIEL = 1;
+    return cRange;
+}
+
+/*==============================================================================
+    ADC FINE
+        Turns a sum of ADC_RING_SIZE samples (13 bits) on a reference into a
+        16-bit fraction of VDD. On VDD that is only a shift.
+==============================================================================*/
+static unsigned int adcFine(unsigned int sum, unsigned char range, unsigned int scale) {
+    unsigned int nFine;
+
+    if (range == ADC_RANGE_VDD) {
+        nFine = sum << 3;
+    } else {
+        nFine = (unsigned int) (((unsigned long) sum * scale) >> 11); // 13 bits x 10.4 to 16 bits
+    }
+#if SENSOR_INVERT
+    nFine = ~nFine; // Inverted for a high side sensor
+#endif
+    return nFine;
+}
+
+/*==============================================================================
+    FILTER NONE
+        The newest sample on its own.
+==============================================================================*/
+static unsigned int filterNone(unsigned char finger) {
+    unsigned int anRing[ADC_RING_SIZE];
+    unsigned char cRange = adcCopy(finger, anRing);
+
+    return adcFine(anRing[ADC_RING_SIZE - 1] * ADC_RING_SIZE, cRange, nAdcCopyScale);
+}
+
+/*==============================================================================
+    FILTER AVERAGE
+        Oversample and decimate. Sums the whole ring, which averages out the
+        foam sensor noise. The 13-bit sum is kept whole, so the average of
+        samples that dither between two steps lands between them.
+==============================================================================*/
+static unsigned int filterAverage(unsigned char finger) {
+    unsigned int anRing[ADC_RING_SIZE], nSum = 0;
+    unsigned char cRange = adcCopy(finger, anRing);
+
+    for (unsigned char i = 0; i < ADC_RING_SIZE; i++) {
+        nSum += anRing[i];
+    }
+    return adcFine(nSum, cRange, nAdcCopyScale);
+}
+
+/*==============================================================================
+    FILTER MEDIAN
+        Median of the newest FILTER_MEDIAN_N samples, insertion sorted.
+        Unlike an average, a single spike never reaches the output.
+==============================================================================*/
+static unsigned int filterMedian(unsigned char finger) {
+    unsigned int anRing[ADC_RING_SIZE], anSort[FILTER_MEDIAN_N], nSample;
+    unsigned char cRange = adcCopy(finger, anRing), j;
+
+    for (unsigned char i = 0; i < FILTER_MEDIAN_N; i++) {
+        nSample = anRing[ADC_RING_SIZE - 1 - i]; // Newest samples are last
+        for (j = i; j != 0 && anSort[j - 1] > nSample; j--) {
+            anSort[j] = anSort[j - 1];
+        }
+        anSort[j] = nSample;
+    }
+    return adcFine(anSort[FILTER_MEDIAN_N / 2] * ADC_RING_SIZE, cRange, nAdcCopyScale);
+}
+
+/*==============================================================================
+    FILTER IIR
+        First-order low pass, y += (x - y) / 2^FILTER_IIR_SHIFT, run on the
+        16-bit fraction of VDD so a change of reference is seamless.
+==============================================================================*/
+static unsigned int filterIir(unsigned char finger) {
+    unsigned int nState = anIirState[finger];
+
+    nState -= nState >> FILTER_IIR_SHIFT;
+    nState += filterNone(finger) >> FILTER_IIR_SHIFT;
+    anIirState[finger] = nState;
+    return nState;
+}
+
+/*==============================================================================
+    SENSOR FILTERED
+        Returns the sample of one finger after the filter picked for it,
+        and keeps it in anSensorFine and its upper 8 bits in
+        acSensorFiltered. Call once per frame for each finger.
+==============================================================================*/
+unsigned char sensorFiltered(unsigned char finger) {
+    unsigned int nFine;
+
+    switch (acFilter[finger]) {
+        case FILTER_AVERAGE:
+            nFine = filterAverage(finger);
+            break;
+        case FILTER_MEDIAN:
+            nFine = filterMedian(finger);
+            break;
+        case FILTER_IIR:
+            nFine = filterIir(finger);
+            break;
+        default:
+            nFine = filterNone(finger);
+            break;
+    }
+    anSensorFine[finger] = nFine;
+    acSensorFiltered[finger] = (unsigned char) (nFine >> 8);
+    return acSensorFiltered[finger];
+}
+
+/*==============================================================================
+    SENSOR FILTER ALL
+        Filters every finger into anSensorFine and acSensorFiltered,
+        unrolled. FILTER_CALL expands a finger's FILTERxxx setting to its
+        number before pasting it onto FILTER_CALL_, so each finger calls its
+        own filter directly with a constant index and there is no switch to
+        run. Call once per frame instead of sensorFiltered() for each finger.
+==============================================================================*/
+#define FILTER_CALL(filter, finger)     FILTER_PASTE(filter, finger)
+#define FILTER_PASTE(filter, finger)    FILTER_CALL_##filter(finger)
+#define FILTER_CALL_0(finger)           filterNone(finger)
+#define FILTER_CALL_1(finger)           filterAverage(finger)
+#define FILTER_CALL_2(finger)           filterMedian(finger)
+#define FILTER_CALL_3(finger)           filterIir(finger)
+
+void sensorFilterAll(void) {
+    anSensorFine[0] = FILTER_CALL(FILTERTHUMB, 0);
+    anSensorFine[1] = FILTER_CALL(FILTERINDEX, 1);
+    anSensorFine[2] = FILTER_CALL(FILTERMIDDLE, 2);
+    anSensorFine[3] = FILTER_CALL(FILTERRING, 3);
+    anSensorFine[4] = FILTER_CALL(FILTERPINKIE, 4);
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        acSensorFiltered[i] = (unsigned char) (anSensorFine[i] >> 8);
+    }
+}
+
+/*==============================================================================
+    ADC LOG2
+        16 x log2(n) for n from 1 to 1024, to within 1/16 of a bit.
+==============================================================================*/
+static unsigned char adcLog2(unsigned int n) {
+    unsigned char cExp = 4;
+
+    while (n < 16) {
+        n <<= 1;
+        cExp--;
+    }
+    while (n >= 32) {
+        n >>= 1;
+        cExp++;
+    }
+    return (unsigned char) ((cExp << 4) + acAdcLog2Frac[n - 16]);
+}
+
+/*==============================================================================
+    ADC AUTO RANGE
+        Every ADC_RANGE_MS, takes the highest and lowest sample of each
+        channel since the last look. Their spread gives acAdcBits. The
+        highest sample, in VDD steps, picks the lowest reference it stays
+        under ADC_HEADROOM of. After ADC_RANGE_HOLD looks in a row on that
+        reference the channel is moved to it, if the supply held steady
+        through them. Channels only move up to VDD from the ISR, when they
+        clip or the supply moves.
+==============================================================================*/
+void adcAutoRange(void) {
+    unsigned int nHigh, nLow;
+#if ADC_AUTORANGE
+    unsigned int anScale[ADC_RANGES], nTop;
+    unsigned char cRange, cFit;
+    bool isUnsteady;
+#endif
+
+    if ((unsigned int) (millis() - nAdcLookTime) < ADC_RANGE_MS) {
+        return;
+    }
+    nAdcLookTime = millis();
+#if ADC_AUTORANGE
+    GIEL = 0;
+    isUnsteady = isAdcUnsteady;
+    isAdcUnsteady = false;
+    GIEL = 1;
+#endif
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        GIEL = 0; // Two byte values written by the A-D ISR
+        nHigh = anAdcHigh[i];
+        nLow = anAdcLow[i];
+        anAdcHigh[i] = 0;
+        anAdcLow[i] = 0xFFFF;
+#if ADC_AUTORANGE
+        for (unsigned char r = 0; r < ADC_RANGES; r++) {
+            anScale[r] = anAdcScale[r];
+        }
+        cRange = acAdcRange[i];
+#endif
+        GIEL = 1;
+        if (nHigh < nLow) {
+            continue; // No samples since the last look
+        }
+        acAdcBits[i] = adcLog2(nHigh - nLow + 1);
+#if ADC_AUTORANGE
+        nTop = (unsigned int) (((unsigned long) nHigh * anScale[cRange]) >> 10); // VDD steps, 10.4
+        cFit = ADC_RANGE_VDD;
+        for (unsigned char r = 1; r < ADC_RANGES; r++) {
+            if (anScale[r] != 0 && nTop < ADC_HEADROOM(anScale[r])
+                    && anScale[r] < anScale[cFit]) {
+                cFit = r;
+            }
+        }
+        if (isUnsteady || cFit == cRange || anScale[cFit] > anScale[cRange]) {
+            acAdcHold[i] = 0; // Supply moving, where it should be, or only the ISR moves it up
+        } else if (++acAdcHold[i] >= ADC_RANGE_HOLD) {
+            acAdcHold[i] = 0;
+            GIEL = 0;
+            if (acAdcRangeNext[i] == cRange) { // Not clipped since the look
+                acAdcRangeNext[i] = cFit;
+            }
+            GIEL = 1;
+        }
+#endif
+    }
+}
+
+/*==============================================================================
+    INIT SENSORS
+        Starts background conversions. Call initSensors after initANA, then
+        enable interrupts. TMR2 runs from FOSC/4 (12MHz) with a 1:4 prescaler
+        and a 1:4 postscaler, so PR2 = 149 gives one interrupt every 200us.
+==============================================================================*/
+void initSensors(void) {
+    ADCON2 = 0b00010110; // Left justified, 4TAD automatic acquisition, FOSC/64 clock
+    VREFCON0 = 0b10000000 | (ADC_FVR_BITS << 4); // Fixed reference on, ADC_FVR_MV
+    ADCREFERENCE(ADREFVDD);
+    cAdcSlot = 0;
+    cAdcAux = 0;
+    nAdcSupply = 0;
+    nAdcSupplyPeak = 0;
+    anAdcScale[ADC_RANGE_VDD] = ADC_FULL << 4;
+    anAdcScale[ADC_RANGE_FVR] = (unsigned int) ((unsigned long) ADC_FVR_MV * (ADC_FULL << 4) / 5000); // Until measured
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        acAdcRange[i] = ADC_RANGE_VDD;
+        acAdcRangeNext[i] = ADC_RANGE_VDD;
+        anAdcHigh[i] = 0;
+        anAdcLow[i] = 0xFFFF;
+        acAdcHold[i] = 0;
+    }
+    cAdcConvRange = ADC_RANGE_VDD;
+    isAdcUnsteady = false;
+    nAdcLookTime = millis();
+    ADCSELECT(asServoChannel[0].cSensor);
+    ADON = 1; // A-D converter stays on
+    ADCSTART(); // Start the first conversion
+
+    PR2 = 149; // 150 counts of 1/3us = 50us
+    TMR2 = 0;
+    T2CON = 0b00011101; // 1:4 postscaler, TMR2 on, 1:4 prescaler
+    TMR2IP = 0; // Low priority, servo edges come first
+    TMR2IF = 0;
+    TMR2IE = 1; // Enable TMR2 interrupts
+}
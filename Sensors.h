@@ -0,0 +1,152 @@
+/*==============================================================================
+    Flex sensor acquisition (PIC18F25K50) symbolic constants and prototypes.
+==============================================================================*/
+
+// The A-D converter is left on and cycles through the flex sensor channels
+// in the background. TMR2 interrupts every ADC_SLOT_US. Each interrupt stores
+// the result of the conversion started by the one before, selects the next
+// channel and starts it. ADCON2 holds off the conversion for the automatic
+// acquisition time after GO is set, so the ISR never waits on the converter.
+//
+// After the flex sensors each round has one more slot, which measures the
+// supply and the die temperature on alternate rounds (for Governor.c), or
+// in turn with the external reference if there is one. The supply is
+// found from a 10-bit conversion of the ADC_FVR_MV fixed reference against
+// VDD. The motor voltage divider (ADVM) cannot be used as it is the same
+// input as the pinkie sensor.
+//
+// Ranging. Every sample keeps all 10 bits, and each flex sensor is converted
+// against the lowest reference its voltage fits under:
+//     ADC_RANGE_VDD   VDD, about 5V
+//     ADC_RANGE_FVR   the fixed reference, ADC_FVR_MV
+//     ADC_RANGE_EXT   VREF+ on RA3, only with ADC_EXT_REF (RA3 is the ring
+//                     sensor input on this board, so it has to move first)
+// The sensors are dividers across VDD and only use part of it (see
+// calibrate() in Hand.c), so a lower reference spreads the same finger
+// motion over more steps: a sensor that stays under 1.8V gets 2.4 times the
+// steps on the 2.048V reference, on top of the 4 times that the 10 bits give
+// over the old 8-bit samples.
+//
+// A sample is turned back into a fraction of VDD using its reference
+// measured against VDD (the supply slot measures the fixed reference). That
+// measurement is smoothed and only made every other round, so it cannot
+// follow a sag, and a divider across VDD moves with the supply on a fixed
+// reference where on VDD the sag cancels out. So a supply reading more than
+// 1/2^ADC_STEADY_SHIFT away from the smoothed one moves every channel back
+// to VDD, and no channel moves down again until the supply has held steady
+// for ADC_RANGE_HOLD looks. A hand whose servos keep sagging the supply
+// stays on VDD, which is the better reference for it.
+//
+// Filtered samples are 16 bits, 0 to 65535 for 0 to VDD (anSensorFine), and
+// the calibration tables are interpolated between entries with the low byte
+// (calPosition()), so small finger motions are no longer lost to the 8-bit
+// table index. acSensorFiltered and acAdcLatest stay 8-bit fractions of VDD.
+//
+// adcAutoRange() looks at each channel every ADC_RANGE_MS. A channel that
+// stayed under ADC_HEADROOM of a lower reference for ADC_RANGE_HOLD looks is
+// moved down to it. A channel that reaches ADC_CLIP on a lower reference is
+// moved back to VDD by the ISR at once. The ring of a channel that changed
+// reference is filled with its first new sample, so the filters never mix
+// references. Build with ADC_AUTORANGE 0 to keep every channel on VDD.
+//
+// Effective bits. For each look acAdcBits gives log2 of the number of steps
+// each channel's samples spanned, in 1/16 bits, counted in the steps of the
+// reference in use. Move a finger through its whole travel to read the
+// resolution its motion gets. tools/adc_bench.c simulates the sensors and
+// compares the old 8-bit samples with the ranged 10-bit ones.
+
+#include    "Variant.h"         // Include the hand variant build options
+
+#define SENSORCOUNT     5               // Number of flex sensor channels, the first channels of
+                                        // the servo channel table (Servo.h) give their A-D inputs
+#define ADC_SLOT_US     200             // Time between conversions
+#define ADC_SLOTS       (SENSORCOUNT + 1) // Slots per round, the last one for supply or temperature
+#define ADC_RATE_HZ     (1000000 / (ADC_SLOT_US * ADC_SLOTS)) // Samples per second per finger
+#define ADC_RING_SIZE   8               // Samples kept per channel, power of 2
+
+#ifndef ADC_AUTORANGE
+#define ADC_AUTORANGE   1
+#endif
+#ifndef ADC_FVR_MV
+#define ADC_FVR_MV      2048            // Fixed reference, 1024, 2048 or 4096
+#endif
+#ifndef ADC_EXT_REF
+#define ADC_EXT_REF     0               // 1 if RA3 carries VREF+ instead of a sensor
+#endif
+
+#define ADC_RANGE_VDD   0
+#define ADC_RANGE_FVR   1
+#define ADC_RANGE_EXT   2
+#define ADC_RANGES      (ADC_EXT_REF ? 3 : 2)
+
+#define ADC_FULL        1024            // Steps in a reference
+#define ADC_CLIP        1015            // Samples at or above this are clipped
+#define ADC_HEADROOM(scale) ((scale) - ((scale) >> 3)) // 7/8 of a reference
+#define ADC_RANGE_MS    500             // Time between looks at the ranges
+#define ADC_RANGE_HOLD  4               // Looks a lower reference must fit before it is used
+#define ADC_STEADY_SHIFT 6              // Supply moves of 1/64 (~80mV) send channels back to VDD
+
+// Sensor wiring. Flex sensors are the bottom half of a voltage divider, so
+// bending a finger lowers its sample. Set SENSOR_INVERT for sensors wired as
+// the top half, and samples are inverted once they are fractions of VDD (the
+// ranging still works on the pin voltage).
+
+#ifndef SENSOR_INVERT
+#define SENSOR_INVERT   0
+#endif
+
+// Flex sensor filters. Pick one filter for each finger at build time by
+// defining FILTERTHUMB..FILTERPINKIE (eg. -DFILTERINDEX=FILTER_MEDIAN).
+// All filters use integer arithmetic only. Worst case instruction cycles per
+// finger, counted from the PIC18 instruction sequences (1 cycle = 1/12us):
+//     FILTER_NONE      ~10     newest sample, no added latency
+//     FILTER_AVERAGE   ~150    mean of the 8 ring samples, 4.2ms latency
+//     FILTER_MEDIAN    ~350    median of the newest 5 samples, 2.4ms latency
+//     FILTER_IIR       ~80     first-order IIR, alpha = 1/2^FILTER_IIR_SHIFT
+// plus ~60 to copy the ring with the A-D interrupt held off, and ~30 to turn
+// the result into a fraction of VDD, or ~300 (a 32-bit multiply) on a
+// reference below VDD. Five fingers with the slowest filter cost ~3550
+// cycles (~300us) per frame.
+
+#define FILTER_NONE     0
+#define FILTER_AVERAGE  1               // Oversample and decimate
+#define FILTER_MEDIAN   2               // Median of FILTER_MEDIAN_N
+#define FILTER_IIR      3               // First-order low pass
+
+#define FILTER_MEDIAN_N     5           // Samples in the median, odd and <= ADC_RING_SIZE
+#define FILTER_IIR_SHIFT    2           // IIR time constant is 2^shift samples
+
+#ifndef FILTERTHUMB
+#define FILTERTHUMB     FILTER_AVERAGE
+#endif
+#ifndef FILTERINDEX
+#define FILTERINDEX     FILTER_AVERAGE
+#endif
+#ifndef FILTERMIDDLE
+#define FILTERMIDDLE    FILTER_AVERAGE
+#endif
+#ifndef FILTERRING
+#define FILTERRING      FILTER_AVERAGE
+#endif
+#ifndef FILTERPINKIE
+#define FILTERPINKIE    FILTER_AVERAGE
+#endif
+
+extern volatile unsigned char acAdcLatest[SENSORCOUNT]; // Newest sample of each channel, 8-bit fraction of VDD
+extern volatile unsigned int anAdcRing[SENSORCOUNT][ADC_RING_SIZE]; // Recent 10-bit samples
+extern volatile unsigned char acAdcHead[SENSORCOUNT]; // Ring index of the next sample
+extern volatile unsigned char acAdcRange[SENSORCOUNT]; // Reference of the samples in each ring
+extern volatile unsigned int anAdcSamples[SENSORCOUNT]; // Samples taken of each channel
+extern volatile unsigned int anAdcScale[ADC_RANGES]; // Each reference in VDD steps, 10.4 fixed point
+extern unsigned char acAdcBits[SENSORCOUNT]; // Steps spanned at the last look, log2 in 1/16 bits
+extern unsigned int anSensorFine[SENSORCOUNT]; // Last filtered sample of each finger, 0-65535 for 0-VDD
+extern unsigned char acSensorFiltered[SENSORCOUNT]; // Its upper 8 bits
+extern volatile unsigned int nAdcSupply; // Newest 10-bit conversion of the ADC_FVR_MV reference
+extern volatile unsigned int nAdcSupplyPeak; // Highest since cleared, ie. the lowest VDD
+extern volatile unsigned char cAdcTemp; // Newest temperature diode sample (upper 8 bits)
+
+void initSensors(void); // Background A-D initialization function prototype.
+unsigned char sensorFiltered(unsigned char finger); // Filtered sample of one finger.
+void sensorFilterAll(void); // Filter every finger into anSensorFine and acSensorFiltered.
+void adcAutoRange(void); // Move channels to the reference that fits them, call every few ms.
+void adcISR(void); // TMR2 interrupt handler, called from the low priority ISR.
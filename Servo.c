@@ -0,0 +1,485 @@
+/*==============================================================================
+    Servo engine. Interrupt driven, hardware timed servo pulses on TMR0.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "CHRPMini.h"        // Include CHRPMini constant symbols and functions
+#include    "Servo.h"           // Include servo engine constants and functions
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+const servoChannel_t asServoChannel[SERVO_CHANNELS] = SERVO_CHANNEL_TABLE;
+//asServoChannel holds the port, latch bit and sensor of each channel
+servoTrim_t asServoTrim[SERVO_CHANNELS];
+unsigned int anServoBase[SERVO_CHANNELS], anServoScale[SERVO_CHANNELS];
+//anServoBase is each servo's pulse at position 0 and anServoScale its pulse
+//span, both in TMR0 ticks, with the span pre-scaled by 4096 / SERVO_FINE_MAX
+int anServoPos[SERVO_CHANNELS];
+//anServoPos is the position of each channel in 1/16 steps
+
+servoStep_t asServoProg[2][SERVO_MAX_STEPS];
+unsigned char acServoSteps[2];
+//asServoProg holds two edge programmes. The ISR plays the active one while
+//servoSetPose() writes the other, so the ISR never sees a half written pose.
+unsigned char cServoGroup;
+unsigned int nServoFrameTicks;
+//cServoGroup is the number of servos started together, nServoFrameTicks is the frame period
+volatile unsigned char cServoActive, cServoStep, cServoEnabled, cServoEnabledC;
+//cServoActive is the programme the ISR is playing, cServoStep is the next step
+//cServoEnabled and cServoEnabledC mask the LATB and LATC servo pins that are
+//allowed to be turned on
+volatile bool isServoPending;
+//isServoPending tells the ISR to swap programmes at the end of the frame
+volatile unsigned int nServoFrames;
+
+/*==============================================================================
+    SERVO RELOAD
+        Reloads TMR0 so that it overflows nTicks after it last overflowed.
+        The ticks that passed while the interrupt was being entered are read
+        back from TMR0 and kept, so interrupt latency does not add up from one
+        step to the next and the frame stays exactly SERVO_FRAME_TICKS long.
+==============================================================================*/
+static void servoReload(unsigned int nTicks) {
+    unsigned int nCount;
+
+    SERVOTIMERREAD(nCount);
+    nCount = nCount - nTicks + SERVO_RELOAD_TICKS;
+    SERVOTIMERWRITE(nCount);
+}
+
+/*==============================================================================
+    SERVO PULSE TICKS
+        Converts a fine position into a pulse width in TMR0 ticks, from the
+        channel's trims. The span was scaled in servoBuildTrims() so
+        that a >> 12 replaces the divide by SERVO_FINE_MAX.
+==============================================================================*/
+static unsigned int servoPulseTicks(unsigned char channel, int pos) {
+    unsigned int nOffset;
+
+    if (pos < 0) {
+        pos = 0;
+    } else if (pos > SERVO_FINE_MAX) {
+        pos = SERVO_FINE_MAX;
+    }
+    nOffset = (unsigned int) (((unsigned long) pos * anServoScale[channel]) >> 12);
+    return asServoTrim[channel].isReversed ? anServoBase[channel] - nOffset : anServoBase[channel] + nOffset;
+}
+
+/*==============================================================================
+    SERVO STEP MARK
+        Adds a channel's latch bit to the set or clear bits of a step.
+==============================================================================*/
+static void servoStepMark(servoStep_t *step, unsigned char channel, bool set) {
+    unsigned char cMask = asServoChannel[channel].cMask;
+
+#if SERVO_PORTC
+    if (asServoChannel[channel].cPort == SERVO_PORT_C) {
+        if (set) {
+            step->cSetC |= cMask;
+        } else {
+            step->cClearC |= cMask;
+        }
+        return;
+    }
+#endif
+    if (set) {
+        step->cSet |= cMask;
+    } else {
+        step->cClear |= cMask;
+    }
+}
+
+/*==============================================================================
+    SERVO STEP CLEAR
+        Empties a step before its bits are marked.
+==============================================================================*/
+static void servoStepClear(servoStep_t *step) {
+    step->cSet = 0;
+    step->cClear = 0;
+#if SERVO_PORTC
+    step->cSetC = 0;
+    step->cClearC = 0;
+#endif
+}
+
+/*==============================================================================
+    SERVO GROUP PROG
+        Builds the edge programme one group of cServoGroup channels at a time.
+        A group's servos are turned on together, then their pulse widths are
+        sorted (insertion sort) and each following step clears the servos
+        whose pulse ends at that edge. Edges that are closer than
+        SERVO_MERGE_TICKS share a step. The next group is turned on by the
+        step that ends the last pulse of the group before, and the last step
+        pads the frame. Groups of one give the old sequential programme and
+        one group of all channels the old parallel programme.
+==============================================================================*/
+static unsigned char servoGroupProg(servoStep_t *step, const unsigned int *pulse) {
+    unsigned char acOrder[SERVO_CHANNELS], cSteps = 1, cFirst, cCount, i, j;
+    unsigned int nEdge, nUsed = 0;
+
+    servoStepClear(step);
+    for (cFirst = 0; cFirst < SERVO_CHANNELS; cFirst += cCount) {
+        cCount = SERVO_CHANNELS - cFirst;
+        if (cCount > cServoGroup) {
+            cCount = cServoGroup;
+        }
+        for (i = 0; i < cCount; i++) {
+            for (j = i; j != 0 && pulse[acOrder[j - 1]] > pulse[cFirst + i]; j--) {
+                acOrder[j] = acOrder[j - 1];
+            }
+            acOrder[j] = cFirst + i;
+            servoStepMark(step, cFirst + i, true); // Start the group
+        }
+        nEdge = 0;
+        for (i = 0; i < cCount; i++) {
+            if (i != 0 && pulse[acOrder[i]] - nEdge < SERVO_MERGE_TICKS) {
+                servoStepMark(step, acOrder[i], false); // Close enough, end it on this edge
+            } else {
+                step->nTicks = pulse[acOrder[i]] - nEdge;
+                nEdge = pulse[acOrder[i]];
+                step++;
+                cSteps++;
+                servoStepClear(step);
+                servoStepMark(step, acOrder[i], false);
+            }
+        }
+        nUsed += nEdge;
+    }
+    step->nTicks = nServoFrameTicks - nUsed;
+    return cSteps;
+}
+
+/*==============================================================================
+    SERVO UPDATE
+        Builds the edge programme for the next frame from anServoPos. The
+        pulse widths are worked out first, so the programme is built from a
+        copy and the positions may change afterwards.
+==============================================================================*/
+static void servoUpdate(void) {
+    unsigned int anPulse[SERVO_CHANNELS];
+    unsigned char cBack;
+
+    for (unsigned char i = 0; i < SERVO_CHANNELS; i++) {
+        anPulse[i] = servoPulseTicks(i, anServoPos[i]);
+    }
+    isServoPending = false; // The ISR will not swap while the programme is written
+    cBack = cServoActive ^ 1;
+    acServoSteps[cBack] = servoGroupProg(asServoProg[cBack], anPulse);
+    isServoPending = true;
+}
+
+/*==============================================================================
+    SERVO SET POSE FINE
+        Queues a finger pose in 1/16 steps for the next frame. Channels after
+        the fingers keep their positions.
+==============================================================================*/
+void servoSetPoseFine(const int *pos) {
+    for (unsigned char i = 0; i < SERVOCOUNT; i++) {
+        anServoPos[i] = pos[i];
+    }
+    servoUpdate();
+}
+
+/*==============================================================================
+    SERVO SET CHANNEL
+        Moves one channel after the fingers, in 1/16 steps. Takes effect with
+        the next pose, so a wrist moves in step with the fingers. Finger
+        channels are left to servoSetPoseFine().
+==============================================================================*/
+void servoSetChannel(unsigned char channel, int pos) {
+    if (channel >= SERVOCOUNT && channel < SERVO_CHANNELS) {
+        anServoPos[channel] = pos;
+    }
+}
+
+/*==============================================================================
+    SERVO SET POSE
+        Queues a pose in whole steps (0-255).
+==============================================================================*/
+void servoSetPose(const unsigned char *pos) {
+    int anPos[SERVOCOUNT];
+
+    for (unsigned char i = 0; i < SERVOCOUNT; i++) {
+        anPos[i] = (int) pos[i] << SERVO_FINE_FRAC;
+    }
+    servoSetPoseFine(anPos);
+}
+
+/*==============================================================================
+    SERVO BUILD TRIMS
+        Works out each servo's base and scale from its trims. Call after the
+        trims change. The scale is rounded so that SERVO_FINE_MAX lands on
+        the far end pulse to within a tick.
+==============================================================================*/
+void servoBuildTrims(void) {
+    unsigned int nSpan;
+
+    for (unsigned char i = 0; i < SERVO_CHANNELS; i++) {
+        nSpan = (asServoTrim[i].nMaxUs - asServoTrim[i].nMinUs) * SERVO_TICKS_PER_US;
+        anServoScale[i] = (unsigned int) ((((unsigned long) nSpan << 12) + SERVO_FINE_MAX / 2) / SERVO_FINE_MAX);
+        anServoBase[i] = (asServoTrim[i].isReversed ? asServoTrim[i].nMaxUs : asServoTrim[i].nMinUs) * SERVO_TICKS_PER_US;
+    }
+}
+
+/*==============================================================================
+    SERVO SET TRIM
+        Changes one channel's trims and rebuilds its base and scale. Both
+        ends are clamped to SERVO_TRIM_MIN_US to SERVO_TRIM_MAX_US first and
+        then put in order, so the trims always pass the servoLoadTrims()
+        checks. Takes effect with the next servoSetPose(), and is not stored
+        until servoStoreTrims() is called.
+==============================================================================*/
+void servoSetTrim(unsigned char channel, unsigned int minUs, unsigned int maxUs, bool reverse) {
+    unsigned int nSwap;
+
+    if (channel >= SERVO_CHANNELS) {
+        return;
+    }
+    minUs = (minUs < SERVO_TRIM_MIN_US) ? SERVO_TRIM_MIN_US : (minUs > SERVO_TRIM_MAX_US) ? SERVO_TRIM_MAX_US : minUs;
+    maxUs = (maxUs < SERVO_TRIM_MIN_US) ? SERVO_TRIM_MIN_US : (maxUs > SERVO_TRIM_MAX_US) ? SERVO_TRIM_MAX_US : maxUs;
+    if (minUs > maxUs) { // A span below zero would wrap in servoBuildTrims()
+        nSwap = minUs;
+        minUs = maxUs;
+        maxUs = nSwap;
+    }
+    asServoTrim[channel].nMinUs = minUs;
+    asServoTrim[channel].nMaxUs = maxUs;
+    asServoTrim[channel].isReversed = reverse;
+    servoBuildTrims();
+}
+
+/*==============================================================================
+    SERVO TRIM CHECKSUM
+        Two's complement of the byte sum of the trims, as in Calibrate.c.
+==============================================================================*/
+static unsigned char servoTrimChecksum(void) {
+    unsigned char cSum = SERVO_MAGIC;
+
+    for (unsigned char i = 0; i < SERVO_CHANNELS; i++) {
+        cSum += (unsigned char) asServoTrim[i].nMinUs + (unsigned char) (asServoTrim[i].nMinUs >> 8);
+        cSum += (unsigned char) asServoTrim[i].nMaxUs + (unsigned char) (asServoTrim[i].nMaxUs >> 8);
+        cSum += asServoTrim[i].isReversed;
+    }
+    return (unsigned char) -cSum;
+}
+
+/*==============================================================================
+    SERVO DEFAULT TRIMS
+        The servo model's mapping: SERVO_MIN_US to SERVO_MAX_US in the
+        SERVO_REVERSED direction.
+==============================================================================*/
+static void servoDefaultTrims(void) {
+    for (unsigned char i = 0; i < SERVO_CHANNELS; i++) {
+        asServoTrim[i].nMinUs = SERVO_MIN_US;
+        asServoTrim[i].nMaxUs = SERVO_MAX_US;
+        asServoTrim[i].isReversed = SERVO_REVERSED;
+    }
+}
+
+/*==============================================================================
+    SERVO LOAD TRIMS
+        Loads the stored trims from EEPROM and rebuilds each servo's base and
+        scale.
+        Returns false, and uses the default trims, if there is no record, its
+        checksum is wrong or a trim is out of range.
+==============================================================================*/
+bool servoLoadTrims(void) {
+    unsigned char cAddr = SERVO_EEPROM_ADDR;
+    bool isValid = false;
+
+    if (eepromRead(cAddr++) == SERVO_MAGIC) {
+        for (unsigned char i = 0; i < SERVO_CHANNELS; i++) {
+            asServoTrim[i].nMinUs = eepromRead(cAddr++);
+            asServoTrim[i].nMinUs |= (unsigned int) eepromRead(cAddr++) << 8;
+            asServoTrim[i].nMaxUs = eepromRead(cAddr++);
+            asServoTrim[i].nMaxUs |= (unsigned int) eepromRead(cAddr++) << 8;
+            asServoTrim[i].isReversed = eepromRead(cAddr++) != 0;
+        }
+        isValid = eepromRead(cAddr) == servoTrimChecksum();
+        for (unsigned char i = 0; i < SERVO_CHANNELS; i++) {
+            if (asServoTrim[i].nMinUs < SERVO_TRIM_MIN_US || asServoTrim[i].nMaxUs > SERVO_TRIM_MAX_US
+                    || asServoTrim[i].nMinUs > asServoTrim[i].nMaxUs) {
+                isValid = false;
+            }
+        }
+    }
+    if (!isValid) {
+        servoDefaultTrims();
+    }
+    servoBuildTrims();
+    return isValid;
+}
+
+/*==============================================================================
+    SERVO STORE TRIMS
+        Stores the trims in EEPROM. At about 4ms a byte this takes over
+        100ms, so it is only done when the trims have been changed on purpose.
+==============================================================================*/
+void servoStoreTrims(void) {
+    unsigned char cAddr = SERVO_EEPROM_ADDR;
+
+    eepromWrite(cAddr++, SERVO_MAGIC);
+    for (unsigned char i = 0; i < SERVO_CHANNELS; i++) {
+        eepromWrite(cAddr++, (unsigned char) asServoTrim[i].nMinUs);
+        eepromWrite(cAddr++, (unsigned char) (asServoTrim[i].nMinUs >> 8));
+        eepromWrite(cAddr++, (unsigned char) asServoTrim[i].nMaxUs);
+        eepromWrite(cAddr++, (unsigned char) (asServoTrim[i].nMaxUs >> 8));
+        eepromWrite(cAddr++, asServoTrim[i].isReversed);
+    }
+    eepromWrite(cAddr, servoTrimChecksum());
+}
+
+/*==============================================================================
+    SERVO ENABLE
+        Turns servo pulses on or off. Frames keep running while pulses are off
+        so that servoWaitFrame() keeps its timing.
+==============================================================================*/
+void servoEnable(bool enable) {
+    servoEnableMask(enable ? SERVO_ALL_CHANNELS : 0);
+}
+
+/*==============================================================================
+    SERVO ENABLE MASK
+        Pulses only the channels whose bit is set in mask. The mask only
+        holds back the start of a pulse, so a pulse that is already running
+        always ends on time.
+==============================================================================*/
+void servoEnableMask(unsigned int mask) {
+    unsigned char cPortB = 0, cPortC = 0;
+
+    for (unsigned char i = 0; i < SERVO_CHANNELS; i++) {
+        if (mask & 1) {
+            if (asServoChannel[i].cPort == SERVO_PORT_C) {
+                cPortC |= asServoChannel[i].cMask;
+            } else {
+                cPortB |= asServoChannel[i].cMask;
+            }
+        }
+        mask >>= 1;
+    }
+    cServoEnabled = cPortB; // Each is one byte, so the ISR never sees half of it
+    cServoEnabledC = cPortC;
+}
+
+/*==============================================================================
+    SERVO SET MODE
+        Selects sequential, parallel or grouped output and the frame period.
+        Sequential frames are kept at 20ms or more, and no frame is shorter
+        than one pulse at the widest trim plus SERVO_GAP_US, so the gap step
+        never goes negative. The groups must all fit in the frame at the
+        widest trim with SERVO_GAP_US to spare, so with many channels the
+        groups are made bigger until they do. Takes effect with the next
+        servoSetPose().
+==============================================================================*/
+void servoSetMode(unsigned char mode, unsigned int frameUs) {
+    if (mode == SERVO_SEQUENTIAL && frameUs < SERVO_FRAME_US) {
+        frameUs = SERVO_FRAME_US;
+    }
+    if (frameUs < SERVO_TRIM_MAX_US + SERVO_GAP_US) {
+        frameUs = SERVO_TRIM_MAX_US + SERVO_GAP_US; // Parallel and one big group
+    }
+    if (mode == SERVO_PARALLEL) {
+        cServoGroup = SERVO_CHANNELS;
+    } else {
+        cServoGroup = (mode == SERVO_GROUPED) ? SERVO_GROUP_SIZE : 1;
+        while (cServoGroup < SERVO_CHANNELS && (unsigned long) (SERVO_CHANNELS + cServoGroup - 1) / cServoGroup
+                * SERVO_TRIM_MAX_US + SERVO_GAP_US > frameUs) {
+            cServoGroup++;
+        }
+    }
+    nServoFrameTicks = frameUs * SERVO_TICKS_PER_US;
+}
+
+/*==============================================================================
+    SERVO WAIT FRAME
+        Waits until the ISR starts a new frame. Only the low byte of the frame
+        counter is compared as it is read in one instruction.
+==============================================================================*/
+void servoWaitFrame(void) {
+    unsigned char cFrame = (unsigned char) nServoFrames;
+    while ((unsigned char) nServoFrames == cFrame) {
+        ISRWAIT();
+    }
+}
+
+/*==============================================================================
+    SERVO GAP TICKS
+        Returns how many TMR0 ticks are left before the next frame if all
+        pulses of this frame have ended, or 0 while pulses are still running.
+        Work that stops the processor (flash writes) must fit in this gap.
+==============================================================================*/
+unsigned int servoGapTicks(void) {
+    unsigned int nCount;
+
+    if (cServoStep != 0) { // The last step of a frame is always the gap
+        return 0;
+    }
+    SERVOTIMERREAD(nCount);
+    if (cServoStep != 0) { // The frame ended while the timer was read
+        return 0;
+    }
+    return (unsigned int) -nCount; // Ticks until the timer overflows
+}
+
+/*==============================================================================
+    SERVO ISR
+        Runs one step of the active edge programme each time TMR0 overflows.
+        The new pose is swapped in only at the end of a frame. Steps that are
+        too short to leave the ISR for are waited out here by polling the overflow flag.
+==============================================================================*/
+void servoISR(void) {
+    servoStep_t *step;
+    bool isShort;
+
+    do {
+        SERVOTIMERIF = 0;
+        step = &asServoProg[cServoActive][cServoStep];
+        SERVOPORT = (SERVOPORT & ~step->cClear) | (step->cSet & cServoEnabled);
+#if SERVO_PORTC
+        SERVOPORT2 = (SERVOPORT2 & ~step->cClearC) | (step->cSetC & cServoEnabledC);
+#endif
+        servoReload(step->nTicks);
+        isShort = step->nTicks < SERVO_SPIN_TICKS;
+        cServoStep++;
+        if (cServoStep == acServoSteps[cServoActive]) {
+            cServoStep = 0;
+            nServoFrames++;
+            if (isServoPending) {
+                cServoActive ^= 1;
+                isServoPending = false;
+            }
+        }
+        if (isShort) {
+            while (!SERVOTIMERIF); // Wait for the end of the short step
+        }
+    } while (isShort);
+}
+
+/*==============================================================================
+    INIT SERVOS
+        Starts the servo engine with an open hand and any channels after the
+        fingers at SERVO_EXTRA_HOME, using the stored trims. Call initServos
+        after initPorts so TMR0 is running, then enable interrupts.
+==============================================================================*/
+void initServos(void) {
+    const unsigned char acOpen[SERVOCOUNT] = {0, 0, 0, 0, 0};
+
+    servoLoadTrims();
+    for (unsigned char i = 0; i < SERVO_CHANNELS; i++) {
+        anServoPos[i] = (i < SERVOCOUNT) ? 0 : SERVO_EXTRA_HOME << SERVO_FINE_FRAC;
+    }
+    cServoActive = 0;
+    cServoStep = 0;
+    nServoFrames = 0;
+    servoSetMode(SERVO_SEQUENTIAL, SERVO_FRAME_US);
+    servoSetPose(acOpen);
+    cServoActive = 1; // Play the programme that was just written
+    isServoPending = false;
+    servoEnable(true);
+    SERVOTIMERWRITE(0xFF00); // First frame starts on the next overflow
+    SERVOTIMERIF = 0;
+    SERVOTIMERIE = 1; // Enable TMR0 interrupts
+}
@@ -0,0 +1,177 @@
+/*==============================================================================
+    Servo engine (PIC18F25K50) symbolic constants and function prototypes.
+==============================================================================*/
+
+// The servo engine runs from the TMR0 overflow interrupt. TMR0 is set up by
+// initPorts() as a 16-bit timer clocked from FOSC/4 (12MHz) through a 1:4
+// prescaler, so each timer tick is 1/3 of a microsecond and a whole 20ms
+// frame (60000 ticks) fits in a single 16-bit reload.
+
+#include    "Variant.h"         // Include the hand variant build options
+
+#define SERVOCOUNT          5           // Number of finger servos, channels 0 to 4
+
+// Servo bank. The engine drives SERVO_CHANNELS outputs (up to 16), listed in
+// SERVO_CHANNEL_TABLE in channel order. The first SERVOCOUNT channels are the
+// fingers, which follow the poses from servoSetPoseFine(). Any channels after
+// them, such as the wrist of the wrist variant, have no flex sensor to follow.
+// They are set one at a time with servoSetChannel(), from REMOTE_CHANNEL
+// packets (Remote.h), and hold their position in between. Each entry gives
+// the port, the latch bit and the flex sensor A-D channel (SERVO_NO_SENSOR if
+// there is none). Channels on LATC need SERVO_PORTC, which adds the second
+// port write to every edge in the ISR. On this board RB0-RB3 (the motor
+// driver pins, if the driver is not fitted) and RC0-RC2 are free, eg. a wrist
+// on RC0 would add {SERVO_PORT_C, 0b00000001, SERVO_NO_SENSOR} and set
+// SERVO_CHANNELS to 6 and SERVO_PORTC to 1.
+
+#ifndef SERVO_CHANNELS
+#define SERVO_CHANNELS      SERVOCOUNT
+#endif
+#ifndef SERVO_PORTC
+#define SERVO_PORTC         0
+#endif
+
+#define SERVO_PORT_B        0           // Channel is on SERVOPORT (LATB)
+#define SERVO_PORT_C        1           // Channel is on SERVOPORT2 (LATC)
+#define SERVO_NO_SENSOR     0xFF        // Channel has no flex sensor
+
+#ifndef SERVO_CHANNEL_TABLE
+#define SERVO_CHANNEL_TABLE { \
+    {SERVO_PORT_B, SERVOTHUMBMASK, SENSORTHUMB}, \
+    {SERVO_PORT_B, SERVOINDEXMASK, SENSORINDEX}, \
+    {SERVO_PORT_B, SERVOMIDDLEMASK, SENSORMIDDLE}, \
+    {SERVO_PORT_B, SERVORINGMASK, SENSORRING}, \
+    {SERVO_PORT_B, SERVOPINKIEMASK, SENSORPINKIE}}
+#endif
+
+#define SERVO_ALL_CHANNELS  ((unsigned int) ((1UL << SERVO_CHANNELS) - 1)) // Channel mask bits
+#define SERVO_EXTRA_CHANNELS (SERVO_ALL_CHANNELS & ~((1U << SERVOCOUNT) - 1)) // Channels after the fingers
+
+#define SERVO_TICKS_PER_US  3           // TMR0 ticks per microsecond
+#define SERVO_FRAME_US      20000       // Servo frame period in microseconds
+
+// Servo model. Default trims for the servos the hand is built with (SG90s
+// unless the variant says otherwise), and the output mode main() starts.
+
+#ifndef SERVO_MIN_US
+#define SERVO_MIN_US        540         // Default pulse width for position 255 (-90 degrees)
+#endif
+#ifndef SERVO_MAX_US
+#define SERVO_MAX_US        (540 + 255 * 6) // Default pulse width for position 0, 6us a step
+#endif
+#ifndef SERVO_REVERSED
+#define SERVO_REVERSED      1           // Default direction, position 0 gives SERVO_MAX_US
+#endif
+#ifndef SERVO_OUTPUT
+#define SERVO_OUTPUT        SERVO_PARALLEL // Output mode the hand runs in
+#endif
+#ifndef SERVO_EXTRA_HOME
+#define SERVO_EXTRA_HOME    0           // Start position of the channels after the fingers
+#endif
+
+#define SERVO_FRAME_TICKS   (SERVO_FRAME_US * SERVO_TICKS_PER_US)
+
+// Fine positions. Poses can be given in 1/16 steps, the same 12 bit
+// positions the trajectory engine works in, which is 4081 steps over the
+// travel. With the default trims one fine step is 0.37us, finer than a TMR0
+// tick, so the pulse width resolution is the timer's 1/3us.
+
+#define SERVO_FINE_FRAC     4           // Fraction bits of a fine position
+#define SERVO_FINE_MAX      (255 << SERVO_FINE_FRAC)
+
+// Endpoint trims. Each servo has its own pulse width at the two ends of its
+// travel and its own direction, so servos that are mounted differently or do
+// not reach the same angles can be matched. A reversed servo gets its long
+// pulse at position 0, which is how all five are wired in this hand so the
+// threads do not cross over each other. The defaults are the old fixed
+// mapping. servoBuildTrims() turns the trims into a base and scale per servo
+// in TMR0 ticks, so a pulse width costs one multiply and no division.
+
+#define SERVO_TRIM_MIN_US   500         // Narrowest pulse a trim may ask for
+#define SERVO_TRIM_MAX_US   2500        // Widest pulse a trim may ask for
+
+// Data EEPROM layout of the stored trims.
+
+#define SERVO_EEPROM_ADDR   0x10        // After the predictor horizon
+#define SERVO_MAGIC         0x5E        // Marks a trim record
+#define SERVO_EEPROM_SIZE   (2 + 5 * SERVO_CHANNELS) // Magic, {minL minH maxL maxH reverse}[n], checksum
+
+// TMR0 ticks that pass between reading and re-writing TMR0 in servoReload(),
+// plus the prescaler count that is lost when TMR0 is written.
+
+#define SERVO_RELOAD_TICKS  3
+
+// Edges closer than SERVO_MERGE_TICKS are cleared together.
+// Steps shorter than SERVO_SPIN_TICKS are waited out inside the ISR, as
+// leaving and re-entering the interrupt would take longer than the step.
+
+#define SERVO_MERGE_TICKS   12          // 4us
+#define SERVO_SPIN_TICKS    60          // 20us
+
+// Servo output modes. The channels are split into groups that start their
+// pulses with one port write and end them in order of width, and the groups
+// run one after the other. SERVO_SEQUENTIAL uses groups of one, pulsing one
+// servo after the other. SERVO_PARALLEL starts all pulses together, so all
+// pulses are done in 2.5ms and the frame can be made much shorter than 20ms
+// for a faster update rate. SERVO_GROUPED starts SERVO_GROUP_SIZE servos at a
+// time, which spreads the current each servo draws at the start of its pulse
+// over the frame. If the groups do not fit in the frame with SERVO_GAP_US
+// left over, servoSetMode() makes them bigger until they do.
+// tools/servo_bench.c plays back the programmes for 5 to 16 channels and
+// reports the timing of each mode.
+
+#define SERVO_SEQUENTIAL    0
+#define SERVO_PARALLEL      1
+#define SERVO_GROUPED       2
+
+#define SERVO_GROUP_SIZE    4           // Servos started together in SERVO_GROUPED
+#define SERVO_GAP_US        1000        // Pulse free time kept at the end of a frame
+
+// Edge programme. Each step sets and clears servo pins in the port latches at
+// the instant TMR0 overflows and then waits nTicks before the next step runs.
+// Every channel has one edge, the first step also starts the first group and
+// the last step pads the frame, so a frame never needs more than
+// SERVO_CHANNELS + 1 steps.
+
+#define SERVO_MAX_STEPS     (SERVO_CHANNELS + 2)
+
+typedef struct {
+    unsigned char cSet;                 // LATB bits to turn on
+    unsigned char cClear;               // LATB bits to turn off
+#if SERVO_PORTC
+    unsigned char cSetC;                // LATC bits to turn on
+    unsigned char cClearC;              // LATC bits to turn off
+#endif
+    unsigned int nTicks;                // TMR0 ticks until the next step
+} servoStep_t;
+
+typedef struct {
+    unsigned char cPort;                // SERVO_PORT_B or SERVO_PORT_C
+    unsigned char cMask;                // Latch bit of the servo output
+    unsigned char cSensor;              // Flex sensor A-D channel, or SERVO_NO_SENSOR
+} servoChannel_t;
+
+typedef struct {
+    unsigned int nMinUs;                // Pulse width at the short end of the travel
+    unsigned int nMaxUs;                // Pulse width at the long end of the travel
+    bool isReversed;                    // Position 0 gives the long pulse
+} servoTrim_t;
+
+extern volatile unsigned int nServoFrames; // Count of completed servo frames
+extern const servoChannel_t asServoChannel[SERVO_CHANNELS]; // Channel table, in channel order
+extern servoTrim_t asServoTrim[SERVO_CHANNELS]; // Endpoint trims, in channel order
+
+void initServos(void); // Servo engine initialization function prototype.
+void servoSetPose(const unsigned char *pos); // Queue a new pose for the next frame.
+void servoSetPoseFine(const int *pos); // Queue a pose in 1/16 steps.
+void servoSetChannel(unsigned char channel, int pos); // Move a channel after the fingers, in 1/16 steps.
+void servoSetTrim(unsigned char channel, unsigned int minUs, unsigned int maxUs, bool reverse); // Change one servo's trims.
+bool servoLoadTrims(void); // Load the stored trims, true if they were valid.
+void servoStoreTrims(void); // Store the trims in EEPROM.
+void servoBuildTrims(void); // Turn the trims into a base and scale per servo.
+void servoEnable(bool enable); // Turn servo pulses on or off.
+void servoEnableMask(unsigned int mask); // Pulse only the channels in mask (bit n is channel n).
+void servoSetMode(unsigned char mode, unsigned int frameUs); // Select output mode and frame period.
+void servoWaitFrame(void); // Wait for the start of the next servo frame.
+unsigned int servoGapTicks(void); // Ticks left in the pulse-free end of the frame.
+void servoISR(void); // TMR0 interrupt handler, called from the ISR.
@@ -0,0 +1,125 @@
+/*==============================================================================
+    Sensor and pose telemetry. Double-buffered binary frames out of the EUSART.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "CHRPMini.h"        // Include CHRPMini constant symbols and functions
+#include    "Sensors.h"         // Include sensor acquisition constants and functions
+#include    "Tick.h"            // Include system tick constants and functions
+#include    "Remote.h"          // Include remote channel constants and functions
+#include    "Governor.h"        // Include governor constants and functions
+#include    "Telemetry.h"       // Include telemetry constants and functions
+
+#define TELEM_NONE          0xFF        // No buffer
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+unsigned char acTelemBuf[2][TELEM_FRAME_SIZE];
+unsigned char cTelemSending, cTelemWaiting, cTelemIndex;
+//cTelemSending is the buffer going out, cTelemWaiting the one queued behind it
+//cTelemIndex is the next byte to send
+unsigned char cTelemSeq, cTelemDiv;
+//cTelemSeq is the next sequence number, cTelemDiv counts ms between frames
+volatile unsigned int nTelemDropped;
+const volatile unsigned char *pTelemRaw;
+const unsigned char *pTelemFiltered, *pTelemPose, *pTelemGlove;
+//pTelemRaw, pTelemFiltered, pTelemPose and pTelemGlove are the arrays copied into each frame
+
+/*==============================================================================
+    TELEMETRY TICK
+        Builds a frame every TELEM_PERIOD_MS in a buffer that is neither being
+        sent nor waiting, then queues it and starts the TX interrupt.
+==============================================================================*/
+void telemetryTick(void) {
+    unsigned char *frame, cBuf, cSum = 0;
+    unsigned int nTime;
+
+    cTelemDiv++;
+    if (cTelemDiv < TELEM_PERIOD_MS) {
+        return;
+    }
+    cTelemDiv = 0;
+    if (cTelemWaiting != TELEM_NONE) {
+        nTelemDropped++; // Both buffers busy, never wait for the link
+        cTelemSeq++;
+        return;
+    }
+    cBuf = (cTelemSending == 0) ? 1 : 0;
+    frame = acTelemBuf[cBuf];
+    nTime = nTickMs; // Safe, this runs inside the ISR that updates it
+
+    frame[0] = TELEM_SYNC1;
+    frame[1] = TELEM_SYNC2;
+    frame[2] = cTelemSeq++;
+    frame[3] = (unsigned char) nTime;
+    frame[4] = (unsigned char) (nTime >> 8);
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        frame[5 + i] = pTelemRaw[i];
+        frame[10 + i] = pTelemFiltered[i];
+        frame[15 + i] = pTelemPose[i];
+        frame[24 + i] = pTelemGlove[i];
+    }
+    frame[20] = (unsigned char) nRemoteEcho; // Safe, only changed with GIEL off
+    frame[21] = (unsigned char) (nRemoteEcho >> 8);
+    frame[22] = cGovSupply;
+    frame[23] = cAdcTemp;
+    for (unsigned char i = 2; i < TELEM_FRAME_SIZE - 1; i++) {
+        cSum += frame[i];
+    }
+    frame[TELEM_FRAME_SIZE - 1] = (unsigned char) -cSum;
+
+    cTelemWaiting = cBuf;
+    TX1IE = 1; // Start sending if idle
+}
+
+/*==============================================================================
+    TELEMETRY TX ISR
+        Sends one byte each time the transmit register empties. Moves on to
+        the waiting buffer at the end of a frame, and turns itself off when
+        there is nothing left to send.
+==============================================================================*/
+void telemetryTxISR(void) {
+    if (cTelemSending == TELEM_NONE) {
+        if (cTelemWaiting == TELEM_NONE) {
+            TX1IE = 0; // Nothing to send
+            return;
+        }
+        cTelemSending = cTelemWaiting;
+        cTelemWaiting = TELEM_NONE;
+        cTelemIndex = 0;
+    }
+    TXREG1 = acTelemBuf[cTelemSending][cTelemIndex++];
+    if (cTelemIndex == TELEM_FRAME_SIZE) {
+        cTelemSending = TELEM_NONE;
+    }
+}
+
+/*==============================================================================
+    INIT TELEMETRY
+        Sets up the EUSART to transmit only, TELEM_BAUD 8N1. With BRG16 and
+        BRGH set the baud rate is FOSC / (4 * (SPBRG + 1)), so 23 gives
+        exactly 500000 from 48MHz.
+==============================================================================*/
+void initTelemetry(const volatile unsigned char *raw, const unsigned char *filtered,
+        const unsigned char *pose, const unsigned char *glove) {
+    pTelemRaw = raw;
+    pTelemFiltered = filtered;
+    pTelemPose = pose;
+    pTelemGlove = glove;
+    cTelemSending = TELEM_NONE;
+    cTelemWaiting = TELEM_NONE;
+    cTelemSeq = 0;
+    cTelemDiv = 0;
+    nTelemDropped = 0;
+
+    SPBRGH1 = 0;
+    SPBRG1 = (unsigned char) (_XTAL_FREQ / 4 / TELEM_BAUD - 1);
+    BAUDCON1 = 0b00001000; // BRG16 on
+    TXSTA1 = 0b00100100; // 8-bit, transmit on, asynchronous, BRGH on
+    RCSTA1 = 0b10000000; // Serial port on (RC6 becomes TX)
+    TX1IP = 0; // Low priority
+    TX1IE = 0; // Turned on when there is a frame to send
+}
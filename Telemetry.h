@@ -0,0 +1,45 @@
+/*==============================================================================
+    Sensor and pose telemetry (PIC18F25K50) constants and function prototypes.
+==============================================================================*/
+
+// Streams the raw samples, filtered samples, glove and servo poses out of the EUSART
+// TX pin (RC6, shared with LED11) every TELEM_PERIOD_MS. Connect a USB
+// serial adapter (3.3V/5V logic, TELEM_BAUD 8N1) to RC6 and ground, and
+// decode the stream with tools/telemetry_decode.c. tools/telemetry_test.c
+// runs this code against a mock EUSART and checks the frames it sends.
+//
+// Frames are built in the 1ms tick and sent a byte at a time from the TX
+// interrupt, both at low priority, so telemetry never holds up the main loop
+// or a servo edge. There are two frame buffers: one being sent and one
+// waiting. If both are busy the new frame is dropped and counted; the
+// sequence number shows the gap on the host.
+//
+// Frame format, TELEM_FRAME_SIZE bytes:
+//     0-1     0xA5 0x5A       sync
+//     2       sequence        +1 per frame, wraps
+//     3-4     time            millis(), low byte first
+//     5-9     raw[5]          newest A-D samples, thumb to pinkie
+//     10-14   filtered[5]     filtered samples
+//     15-19   pose[5]         positions sent to the servos
+//     20-21   echo            stamp of the last remote pose, low byte first
+//     22      supply          lowest VDD in the last governor run, 20mV steps
+//     23      temperature     newest die temperature diode sample, raw
+//     24-28   glove[5]        calibrated glove pose, before prediction, gesture
+//                             snapping and limits: what classifyPose() is given
+//     29      checksum        bytes 2 to 29 add up to 0
+//
+// The glove pose went on the end so the older fields kept their place. 30
+// bytes take 600us at TELEM_BAUD, under a third of the frame period.
+
+#define TELEM_BAUD          500000      // Bits per second
+#define TELEM_PERIOD_MS     2           // 500 frames per second
+#define TELEM_FRAME_SIZE    30
+#define TELEM_SYNC1         0xA5
+#define TELEM_SYNC2         0x5A
+
+extern volatile unsigned int nTelemDropped; // Frames dropped because the link was busy
+
+void initTelemetry(const volatile unsigned char *raw, const unsigned char *filtered,
+        const unsigned char *pose, const unsigned char *glove); // Start the EUSART and the stream.
+void telemetryTick(void); // Called every ms from the low priority ISR.
+void telemetryTxISR(void); // EUSART TX interrupt handler.
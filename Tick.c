@@ -0,0 +1,69 @@
+/*==============================================================================
+    System tick. Millisecond clock counted from the TMR2 interrupt.
+==============================================================================*/
+
+#include    "xc.h"              // XC compiler general include file
+#include    "stdint.h"          // Include integer definitions
+#include    "stdbool.h"         // Include Boolean (true/false) definitions
+#include    "Sensors.h"         // Include sensor acquisition constants and functions
+#include    "Tick.h"            // Include system tick constants and functions
+
+/*==============================================================================
+    VARIABLES
+==============================================================================*/
+volatile unsigned int nTickMs;
+unsigned char cTickSlot;
+//cTickSlot counts TMR2 interrupts within the current millisecond
+volatile unsigned char cTickLost;
+//cTickLost is TMR2 interrupts missed while the processor was stopped, written
+//only by tickLost() and cleared only by tickISR() once it has added them
+
+/*==============================================================================
+    TICK ISR
+        Counts TMR2 interrupts into milliseconds. Returns true on the
+        interrupt that starts a new millisecond, so per-millisecond work can
+        run straight after it. Interrupts lost in a processor stall are
+        added in here, so the count can move on more than one millisecond
+        at once; the per-millisecond work then runs only once.
+==============================================================================*/
+bool tickISR(void) {
+    bool isMs = false;
+
+    cTickSlot++;
+    if (cTickLost != 0) {
+        cTickSlot += cTickLost;
+        cTickLost = 0;
+    }
+    while (cTickSlot >= TICK_SLOTS) {
+        cTickSlot -= TICK_SLOTS;
+        nTickMs++;
+        isMs = true;
+    }
+    return isMs;
+}
+
+/*==============================================================================
+    TICK LOST
+        Adds TMR2 interrupts that were lost while the processor was stopped,
+        eg. by a flash erase or write (Record.c), which holds off every
+        interrupt: of the periods it covers only the last is seen. Call it
+        straight after the stall. The next tickISR() adds them.
+==============================================================================*/
+void tickLost(unsigned char slots) {
+    cTickLost = slots; // One byte, written in one go, so the ISR never sees half of it
+}
+
+/*==============================================================================
+    MILLIS
+        Returns the millisecond count. The count is two bytes and the ISR may
+        change it between them, so it is read until two reads agree.
+        Compare times by subtracting them, which works across the wrap.
+==============================================================================*/
+unsigned int millis(void) {
+    unsigned int nTime;
+
+    do {
+        nTime = nTickMs;
+    } while (nTime != nTickMs);
+    return nTime;
+}
@@ -0,0 +1,17 @@
+/*==============================================================================
+    System tick (PIC18F25K50) symbolic constants and function prototypes.
+==============================================================================*/
+
+// A 1ms system tick counted from the TMR2 interrupt that paces the A-D
+// converter (Sensors.c). TMR2 interrupts every ADC_SLOT_US, so every
+// TICK_SLOTS interrupts make one millisecond. Time is kept in wall-clock
+// milliseconds, not in main loop passes, so it does not change when the
+// main loop speeds up or slows down.
+
+#define TICK_SLOTS      (1000 / ADC_SLOT_US) // TMR2 interrupts per millisecond
+
+extern volatile unsigned int nTickMs; // Milliseconds since power up, wraps every 65.5s
+
+unsigned int millis(void); // Read the millisecond count.
+bool tickISR(void); // Called on every TMR2 interrupt, true when a ms has passed.
+void tickLost(unsigned char slots); // Add TMR2 interrupts lost in a processor stall.
@@ -0,0 +1,32 @@
+/*==============================================================================
+    Hand variant selection (PIC18F25K50). Picks the build profile.
+==============================================================================*/
+
+// Hands built from this code differ in servo model, pin mapping, extra
+// servos, sensor wiring, filters and the pose rules they keep to.
+// Each variant is one header in variants/ that sets the build options the
+// modules read (the #ifndef defaults in Servo.h, Sensors.h, Calibrate.h and
+// Constrain.h). The variant is picked at build time by defining VARIANT_<NAME>,
+// eg. -DVARIANT_WRIST, and Variants.mk has a build target for each one. With
+// no VARIANT_ defined the hand in this repository is built.
+//
+// Everything a variant sets is a constant, so the choices are made by the
+// preprocessor and compiler: the per finger filter calls in Sensors.c,
+// the sensor inversion in the A-D ISR and the LATC write in the servo ISR
+// are compiled in or out, with no run time checks left on the hot paths.
+//
+// This header is included by CHRPMini.h, Servo.h, Sensors.h and Constrain.h,
+// so every module sees the same variant whichever header it includes first.
+
+#ifndef VARIANT_H
+#define VARIANT_H
+
+#if defined(VARIANT_WRIST)
+#include    "variants/Wrist.h"  // Five fingers and a wrist rotation servo
+#elif defined(VARIANT_MG90)
+#include    "variants/Mg90.h"   // MG90S servos and high side flex sensors
+#else
+#include    "variants/Standard.h" // The hand as built, five SG90s
+#endif
+
+#endif
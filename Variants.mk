@@ -0,0 +1,44 @@
+#
+#  Hand variant builds. Each header in variants/ is a build profile for one
+#  kind of hand (see Variant.h). These targets build the whole firmware for
+#  one variant, or all of them, straight with xc8 and print the memory
+#  summary of each, as the IDE build does. Output goes to dist/<variant>/.
+#
+#     make variants                build every variant
+#     make variant-standard        build one variant
+#     make variants-clean          remove the variant builds
+#
+#  Set XC8 to the compiler driver if it is not on the path, eg.
+#     make variants XC8=/opt/microchip/xc8/v1.42/bin/xc8
+#
+#  The options match the IDE project: 24-bit floats, free mode, code offset
+#  0x2000 for the USB bootloader and 0x6000-0x6FFF kept free for recordings.
+#
+
+XC8 ?= xc8
+MKDIR ?= mkdir
+
+VARIANTS = standard wrist mg90
+VARIANT_SOURCES = $(wildcard *.c)
+VARIANT_FLAGS = --chip=18F25K50 --double=24 --float=24 \
+	--opt=+asm,+asmfile,-speed,+space,-debug,-local --addrqual=ignore \
+	--mode=free -P -N255 --warn=-3 --asmlist \
+	--rom=default,-0-1FFF,-2006-2007,-2016-2017,-6000-6FFF --codeoffset=0x2000 \
+	--output=default,-inhx032 --output=-mcof,+elf:multilocs \
+	--runtime=default,+clear,+init,-keep,-no_startup,-download,+config,+clib,-plib \
+	--stack=compiled:auto:auto:auto \
+	--summary=default,-psect,-class,+mem,-hex,+file
+
+.PHONY: variants variants-clean
+
+variants: $(addprefix variant-,$(VARIANTS))
+
+variant-%: $(VARIANT_SOURCES) variants/*.h
+	@echo "=== $* ==="
+	@$(MKDIR) -p dist/$*/production
+	$(XC8) $(VARIANT_FLAGS) -DVARIANT_$(shell echo $* | tr a-z A-Z) \
+		--outdir=dist/$*/production -odist/$*/production/CHRPMini-Hand.$*.elf \
+		--memorysummary dist/$*/production/memoryfile.xml $(VARIANT_SOURCES)
+
+variants-clean:
+	rm -rf $(addprefix dist/,$(VARIANTS))
@@ -0,0 +1,289 @@
+/*==============================================================================
+    Flex sensor acquisition benchmark. Runs the firmware's background A-D
+    code (Sensors.c) and calibration tables (Calibrate.c) on simulated flex
+    sensors and compares the finger positions they give with the old 8-bit
+    path.
+
+    Build:  gcc -O2 -I. -o adc_bench adc_bench.c -lm
+    Use:    ./adc_bench [noise mV]
+
+    Sensors.c is compiled in with stand-ins for the registers it touches.
+    Each TMR2 slot the bench calls adcISR() and works out the conversion it
+    started from ADCON0, ADCON1 and VREFCON0: the pin voltage, plus gaussian
+    noise (1.5mV rms by default), over the selected reference. The sensors
+    are dividers off VDD that swing 0.6V (bent) to 1.5V (straight) at 5V.
+    Sags take VDD down 0.6V for ~30ms, 4 times a second, as servo starts do.
+
+    Rows:
+        8-bit       the old path: upper 8 bits against VDD, mean of the ring
+        VDD         10-bit samples, always against VDD
+        auto        10-bit samples, adcAutoRange() every 5ms as in Hand.c
+
+    Columns:
+        sweep   distinct positions as one finger is bent slowly end to end
+        still   rms and peak to peak position noise of a still finger, and
+                the reference it ended on
+        sags    the same with supply sags
+        bits    effective bits of the still finger (acAdcBits)
+    The auto row is followed by a clip test, once the supply has been steady
+    for 3s: a finger on the fixed reference straightened past it at once,
+    the frames it was off by more than 4 positions and the time until it was
+    back on VDD.
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+
+unsigned char ADCON0, ADCON1, ADCON2, ADRESH, ADRESL, VREFCON0;
+unsigned char PR2, TMR2, T2CON, TMR2IP, TMR2IF, TMR2IE, GIEL, GO, ADON;
+//Register stand-ins for Sensors.c
+
+#include "../Sensors.c"
+#include "../Calibrate.c"
+
+const servoChannel_t asServoChannel[SERVO_CHANNELS] = SERVO_CHANNEL_TABLE;
+
+#define BENCH_VDD           5.0         // Supply, volts
+#define BENCH_SAG_V         0.6         // Depth of a sag
+#define BENCH_SAG_MS        250         // Time between sags
+#define BENCH_EXT_V         2.5         // VREF+ with ADC_EXT_REF
+#define BENCH_BENT          0.12        // Pin voltage / VDD of a bent finger
+#define BENCH_STRAIGHT      0.30        // and of a straight one
+#define BENCH_FRAME_MS      20
+#define BENCH_GOVERNOR_MS   5           // GOVERNOR_TASK_MS in Hand.c
+
+#define MODE_LEGACY         0
+#define MODE_VDD            1
+#define MODE_AUTO           2
+
+static unsigned long lNowUs;
+static double fNoiseV = 0.0015, afRatio[SENSORCOUNT];
+static bool isSagging;
+//lNowUs is the simulated time, afRatio the divider of each sensor
+static unsigned char acLegacyRing[SENSORCOUNT][ADC_RING_SIZE], acLegacyHead[SENSORCOUNT];
+//The old 8-bit ring, filled alongside the firmware's
+
+unsigned int millis(void) {
+    return (unsigned int) (lNowUs / 1000);
+}
+
+unsigned char eepromRead(unsigned char addr) {
+    (void) addr;
+    return 0xFF;
+}
+
+void eepromWrite(unsigned char addr, unsigned char data) {
+    (void) addr;
+    (void) data;
+}
+
+static double noise(void) {
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0), u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+    return fNoiseV * sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+static double vdd(void) {
+    unsigned long lMs = lNowUs / 1000 % BENCH_SAG_MS;
+
+    if (!isSagging) {
+        return BENCH_VDD;
+    }
+    if (lMs < 2) { // Falls in 2ms, holds 10ms, recovers in 20ms
+        return BENCH_VDD - BENCH_SAG_V * (lNowUs % 2000) / 2000.0;
+    } else if (lMs < 12) {
+        return BENCH_VDD - BENCH_SAG_V;
+    } else if (lMs < 32) {
+        return BENCH_VDD - BENCH_SAG_V * (32 - lMs) / 20.0;
+    }
+    return BENCH_VDD;
+}
+
+static unsigned int quantize(double volts, double ref) {
+    double fSteps = floor(volts / ref * ADC_FULL);
+
+    return fSteps < 0 ? 0 : fSteps > ADC_FULL - 1 ? ADC_FULL - 1 : (unsigned int) fSteps;
+}
+
+/*==============================================================================
+    START CONVERSION
+        Works out the conversion adcISR() just started and leaves it in
+        ADRESH:ADRESL (left justified) for the next slot. A flex sensor is
+        also converted the old way into the 8-bit ring.
+==============================================================================*/
+static void startConversion(void) {
+    unsigned char cChan = ADCON0 & 0b01111100, cRef = ADCON1 & 0b00001100;
+    double fVdd = vdd(), fFvr = 1.024 * (1 << (((VREFCON0 >> 4) & 3) - 1)), fRef, fVolts = 0;
+    unsigned int nResult;
+
+    if (!(VREFCON0 & 0x80) && (cRef == ADREFFVR || cChan == ADFVR)) {
+        fprintf(stderr, "fixed reference used while off\n");
+        exit(1);
+    }
+    fRef = cRef == ADREFFVR ? fFvr : cRef == ADREFEXT ? BENCH_EXT_V : fVdd;
+    if (cChan == ADFVR) {
+        fVolts = fFvr;
+    } else if (cChan == ADTD) {
+        fVolts = 0.7;
+    } else if (cChan == ADVREFP) {
+        fVolts = BENCH_EXT_V;
+    } else {
+        for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+            if (cChan == asServoChannel[i].cSensor) {
+                fVolts = fVdd * afRatio[i] + noise();
+                acLegacyRing[i][acLegacyHead[i]] = quantize(fVdd * afRatio[i] + noise(), fVdd) >> 2;
+                acLegacyHead[i] = (acLegacyHead[i] + 1) & (ADC_RING_SIZE - 1);
+            }
+        }
+    }
+    nResult = quantize(fVolts, fRef);
+    ADRESH = nResult >> 2;
+    ADRESL = (nResult & 3) << 6;
+}
+
+/*==============================================================================
+    RUN
+        Runs the A-D slots and the filters for ms milliseconds, in the mode of
+        the row, and leaves each finger's position in pos.
+==============================================================================*/
+static void run(int mode, unsigned int ms, unsigned char *pos) {
+    unsigned long lEnd = lNowUs + ms * 1000UL;
+    unsigned int nSum;
+
+    while (lNowUs < lEnd) {
+        lNowUs += ADC_SLOT_US;
+        adcISR();
+        startConversion();
+        if (mode == MODE_AUTO && lNowUs % (BENCH_GOVERNOR_MS * 1000UL) == 0) {
+            adcAutoRange();
+        }
+    }
+    sensorFilterAll();
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        if (mode == MODE_LEGACY) {
+            nSum = 0;
+            for (unsigned char j = 0; j < ADC_RING_SIZE; j++) {
+                nSum += acLegacyRing[i][j];
+            }
+            pos[i] = acCalLut[i][nSum / ADC_RING_SIZE];
+        } else {
+            pos[i] = calPosition(i, anSensorFine[i]);
+        }
+    }
+}
+
+/*==============================================================================
+    STILL
+        Holds the fingers still for 5s and gives the rms and peak to peak
+        position noise of finger 1.
+==============================================================================*/
+static void still(int mode, double *rms, int *p2p) {
+    unsigned char acPos[SENSORCOUNT];
+    double fSum = 0, fSquares = 0;
+    int nMin = 255, nMax = 0, nFrames = 5000 / BENCH_FRAME_MS;
+
+    for (int n = 0; n < nFrames; n++) {
+        run(mode, BENCH_FRAME_MS, acPos);
+        fSum += acPos[1];
+        fSquares += (double) acPos[1] * acPos[1];
+        nMin = acPos[1] < nMin ? acPos[1] : nMin;
+        nMax = acPos[1] > nMax ? acPos[1] : nMax;
+    }
+    fSum /= nFrames;
+    *rms = sqrt(fSquares / nFrames - fSum * fSum);
+    *p2p = nMax - nMin;
+}
+
+static void runRow(const char *name, int mode) {
+    static const char *apRange[] = {"VDD", "FVR", "EXT"};
+    unsigned char acPos[SENSORCOUNT];
+    bool aisSeen[256] = {false};
+    int nSeen = 0, nP2p, nSagP2p;
+    double fRms, fSagRms;
+    unsigned char cRange, cBits;
+
+    lNowUs = 0;
+    isSagging = false;
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        afRatio[i] = BENCH_BENT + (BENCH_STRAIGHT - BENCH_BENT) * (i + 1) / 7.0;
+    }
+    initSensors();
+    run(mode, 3000, acPos); // Settle, and range with ADC_RANGE_HOLD looks
+    for (int n = 0; n <= 10000 / BENCH_FRAME_MS; n++) { // 10s sweep of finger 0
+        afRatio[0] = BENCH_BENT + (BENCH_STRAIGHT - BENCH_BENT) * n / (10000.0 / BENCH_FRAME_MS);
+        run(mode, BENCH_FRAME_MS, acPos);
+        if (!aisSeen[acPos[0]]) {
+            aisSeen[acPos[0]] = true;
+            nSeen++;
+        }
+    }
+    still(mode, &fRms, &nP2p);
+    cRange = acAdcRange[1];
+    cBits = acAdcBits[1];
+    isSagging = true;
+    still(mode, &fSagRms, &nSagP2p);
+    isSagging = false;
+    printf("%-8s %5d  %5.2f %3d %-3s  %5.2f %3d %-3s", name, nSeen,
+            fRms, nP2p, mode == MODE_LEGACY ? "VDD" : apRange[cRange],
+            fSagRms, nSagP2p, mode == MODE_LEGACY ? "VDD" : apRange[acAdcRange[1]]);
+    if (mode == MODE_AUTO) {
+        printf(" %5.1f\n", cBits / 16.0);
+    } else {
+        printf("     -\n");
+    }
+}
+
+/*==============================================================================
+    CLIP
+        Straightens finger 2 past the fixed reference at once and counts the
+        frames its position was off until it settled.
+==============================================================================*/
+static void clip(void) {
+    unsigned char acPos[SENSORCOUNT], cTrue;
+    int nOff = 0;
+    long lBackMs = -1;
+    unsigned long lStartUs;
+
+    run(MODE_AUTO, 3000, acPos);
+    if (acAdcRange[2] == ADC_RANGE_VDD) {
+        printf("clip     finger 2 was not on a lower reference\n");
+        return;
+    }
+    afRatio[2] = BENCH_STRAIGHT * 2; // 3V at the pin
+    cTrue = calPosition(2, (unsigned int) (afRatio[2] * 65536));
+    lStartUs = lNowUs;
+    for (int n = 0; n < 1000 / BENCH_FRAME_MS; n++) {
+        run(MODE_AUTO, BENCH_FRAME_MS, acPos);
+        if (abs(acPos[2] - cTrue) > 4) {
+            nOff++;
+        }
+        if (lBackMs < 0 && acAdcRange[2] == ADC_RANGE_VDD) {
+            lBackMs = (long) ((lNowUs - lStartUs) / 1000);
+        }
+    }
+    printf("clip     %d frames off, back on VDD after %ldms\n", nOff, lBackMs);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        fNoiseV = atof(argv[1]) / 1000;
+    }
+    srand(1);
+    calReset();
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        calRecord(i, (unsigned char) (BENCH_BENT * 256));
+        calRecord(i, (unsigned char) (BENCH_STRAIGHT * 256));
+    }
+    calBuildLuts();
+
+    printf("fixed reference %dmV, noise %.1fmV rms, headroom %d%%\n", ADC_FVR_MV, fNoiseV * 1000,
+            ADC_HEADROOM(100));
+    printf("row      sweep  still rms p2p ref   sags rms p2p ref  bits\n");
+    runRow("8-bit", MODE_LEGACY);
+    runRow("VDD", MODE_VDD);
+    runRow("auto", MODE_AUTO);
+    clip();
+    return 0;
+}
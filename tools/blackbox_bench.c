@@ -0,0 +1,291 @@
+/*==============================================================================
+    Flight recorder benchmark. Runs the firmware's flight recorder
+    (Blackbox.c) on a simulated data EEPROM and checks the wear levelling,
+    the recovery after power cuts and the write throughput.
+
+    Build:  gcc -O2 -I. -o blackbox_bench blackbox_bench.c
+    Use:    ./blackbox_bench [hours] [dump.bin]
+
+    Blackbox.c is compiled in with a simulated EEPROM that takes
+    BENCH_WRITE_US to write a byte, and is run in 1ms steps with the
+    firmware's task periods.
+
+    Throughput: the queue is kept full for 10s. Shows the records and bytes
+    stored per second, the time from queueing a record to its last byte,
+    and a burst of events all at once.
+
+    Wear: runs the given simulated hours (24 by default) with faults far more
+    often than a working hand has them: a missed frame or a sag in most
+    statistics periods, a mode change every 30s on average, and the power
+    cut every 1 to 600s, half the time in the middle of writing a record.
+    After every cut the recorder is started again from the EEPROM and
+    checked: the next record must go in the slot after the last one stored,
+    with the next sequence number, and every record it can read must be one
+    that was stored there. Shows the writes of each EEPROM byte in the ring
+    and how long the EEPROM would last at that rate.
+
+    Any write started while the EEPROM was still busy (one that would wait
+    in the firmware) is counted as blocked. The final EEPROM image can be
+    saved for tools/blackbox_decode.c.
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define BENCH_WRITE_US      4000        // Data EEPROM byte write time (TDEW)
+#define BENCH_TASK_MS       2           // BLACKBOX_TASK_MS in Hand.c
+#define BENCH_FRAME_MS      20          // Servo frame
+#define BENCH_GOVERNOR_MS   5           // GOVERNOR_TASK_MS in Hand.c
+#define BENCH_ENDURANCE     100000UL    // Data EEPROM writes a byte can take
+
+static unsigned char acEeprom[256];
+static unsigned long alWrites[256];
+static unsigned long lNowUs, lBusyUntil, lBlocked;
+static unsigned char cBusyAddr;
+//acEeprom is the simulated EEPROM, alWrites the writes of each byte
+//lNowUs is the simulated time, the byte at cBusyAddr is written until lBusyUntil
+volatile unsigned int nServoFrames;
+//Stand-in for the servo engine's frame count
+
+unsigned char eepromRead(unsigned char addr) {
+    return acEeprom[addr];
+}
+
+void eepromWrite(unsigned char addr, unsigned char data) {
+    if (lNowUs < lBusyUntil) {
+        lBlocked++; // The firmware would wait here
+        lNowUs = lBusyUntil;
+    }
+    acEeprom[addr] = data;
+    alWrites[addr]++;
+    cBusyAddr = addr;
+    lBusyUntil = lNowUs + BENCH_WRITE_US;
+}
+
+bool eepromBusy(void) {
+    return lNowUs < lBusyUntil;
+}
+
+unsigned int millis(void) {
+    return (unsigned int) (lNowUs / 1000);
+}
+
+#include "../Blackbox.c"
+
+#define RING_START          BLACKBOX_EEPROM_START
+#define RING_BYTES          (BLACKBOX_SLOTS * BLACKBOX_RECORD_SIZE)
+
+static unsigned char acTruth[BLACKBOX_SLOTS][BLACKBOX_RECORD_SIZE];
+static bool isTruth[BLACKBOX_SLOTS];
+static int nLastSlot = -1;
+static unsigned char cLastSeq;
+//acTruth is the last whole record stored in each slot, nLastSlot and
+//cLastSeq the slot and sequence number of the newest one
+
+/*==============================================================================
+    BENCH STEP
+        Moves the simulated time on by 1ms. A record is stored when its
+        sequence byte (byte 0) has finished writing.
+==============================================================================*/
+static void benchStep(void) {
+    bool isWriting = eepromBusy();
+    unsigned char cSlot;
+
+    lNowUs += 1000;
+    if (isWriting && !eepromBusy() && (cBusyAddr - RING_START) % BLACKBOX_RECORD_SIZE == 0) {
+        cSlot = (cBusyAddr - RING_START) / BLACKBOX_RECORD_SIZE;
+        memcpy(acTruth[cSlot], &acEeprom[cBusyAddr], BLACKBOX_RECORD_SIZE);
+        isTruth[cSlot] = true;
+        nLastSlot = cSlot;
+        cLastSeq = acEeprom[cBusyAddr];
+    }
+}
+
+/*==============================================================================
+    POWER CUT
+        Cuts the power: a byte being written is left as anything but what
+        was being written, and the queue is lost. True if a record was cut
+        short. Its slot should then read as empty, or as the record that was
+        there before if the bytes written so far had not changed it.
+==============================================================================*/
+static bool powerCut(void) {
+    bool isTorn = eepromBusy();
+
+    if (isTorn) {
+        acEeprom[cBusyAddr] ^= 1 + rand() % 255;
+        lBusyUntil = lNowUs;
+    }
+    if (cBlackboxCount != 0 && cBlackboxByte != 0) {
+        isTorn = true; // Some of a record was written
+    }
+    return isTorn;
+}
+
+/*==============================================================================
+    CHECK RECOVERY
+        After initBlackbox(), checks where the boot record goes and that
+        every record it could read was stored in that slot. Returns the
+        number of faults.
+==============================================================================*/
+static int checkRecovery(unsigned long *bogus) {
+    unsigned char acRecord[BLACKBOX_RECORD_SIZE];
+    int nFaults = 0;
+
+    if (nLastSlot >= 0 && (cBlackboxSlot != (nLastSlot + 1) % BLACKBOX_SLOTS
+            || acBlackboxQueue[cBlackboxOut][0] != (unsigned char) (cLastSeq + 1))) { // The boot record
+        nFaults++;
+    }
+    for (unsigned char slot = 0; slot < BLACKBOX_SLOTS; slot++) {
+        if (blackboxReadSlot(slot, acRecord) && (!isTruth[slot] || memcmp(acRecord, acTruth[slot], BLACKBOX_RECORD_SIZE) != 0)) {
+            (*bogus)++; // A mix of two records that happens to add up
+        }
+    }
+    return nFaults;
+}
+
+/*==============================================================================
+    RUN THROUGHPUT
+==============================================================================*/
+static void runThroughput(void) {
+    unsigned long lStart, lQueued[256], lLatency = 0, lLatencyMax = 0, lStored = 0;
+    unsigned char cSeqQueued = 0, cSeqDone;
+    unsigned int nDropped;
+
+    memset(acEeprom, 0xFF, sizeof (acEeprom));
+    initBlackbox(RESET_POWER);
+    lStart = lNowUs;
+    cSeqDone = (unsigned char) (cBlackboxSeq - 1);
+    lQueued[cSeqDone] = lNowUs; // The boot record
+    while (lNowUs - lStart < 10000000UL) {
+        while (cBlackboxCount < BLACKBOX_QUEUE) {
+            cSeqQueued = cBlackboxSeq;
+            lQueued[cSeqQueued] = lNowUs;
+            blackboxEvent(BLACKBOX_MODE, 1, 0, 0);
+        }
+        if (millis() % BENCH_TASK_MS == 0) {
+            blackboxService();
+        }
+        benchStep();
+        while (nLastSlot >= 0 && cSeqDone != (unsigned char) (cLastSeq + 1)) {
+            unsigned long lTime = lNowUs - lQueued[cSeqDone];
+
+            lLatency += lTime;
+            lLatencyMax = lTime > lLatencyMax ? lTime : lLatencyMax;
+            lStored++;
+            cSeqDone++;
+        }
+    }
+    printf("throughput, queue kept full for 10s\n");
+    printf("  %.1f records/s, %.0f bytes/s, %.1fms a record\n", lStored / 10.0,
+            lStored * BLACKBOX_RECORD_SIZE / 10.0, 10000.0 / lStored);
+    printf("  queued to stored %.1fms mean, %.1fms max (%u records queued ahead)\n",
+            lLatency / 1000.0 / lStored, lLatencyMax / 1000.0, BLACKBOX_QUEUE - 1);
+
+    memset(acEeprom, 0xFF, sizeof (acEeprom));
+    nLastSlot = -1;
+    initBlackbox(RESET_POWER);
+    nDropped = nBlackboxDropped;
+    for (int i = 0; i < 10; i++) {
+        blackboxEvent(BLACKBOX_MODE, i, 0, 0);
+    }
+    lStart = lNowUs;
+    while (cBlackboxCount != 0) {
+        if (millis() % BENCH_TASK_MS == 0) {
+            blackboxService();
+        }
+        benchStep();
+    }
+    printf("  burst of 10 events after the boot record: %u stored, %u dropped, all stored after %.0fms\n",
+            10 - (nBlackboxDropped - nDropped), nBlackboxDropped - nDropped,
+            (lNowUs - lStart) / 1000.0);
+}
+
+/*==============================================================================
+    RUN WEAR
+==============================================================================*/
+static void runWear(double hours) {
+    unsigned long lEnd = lNowUs + (unsigned long) (hours * 3600e6), lCutAt, lCuts = 0, lTorn = 0;
+    unsigned long lBogus = 0, lRecords = 0, lMin = ~0UL, lMax = 0, lSum = 0;
+    unsigned char acRaw[SENSORCOUNT] = {128, 128, 128, 128, 128};
+    unsigned char cMode = 0, cNewMode, cSeqStart;
+    bool isMidRecord;
+    int nFaults = 0;
+    double dPerHour;
+
+    memset(acEeprom, 0xFF, sizeof (acEeprom));
+    memset(alWrites, 0, sizeof (alWrites));
+    memset(isTruth, 0, sizeof (isTruth));
+    nLastSlot = -1;
+    lBlocked = 0;
+    while (lNowUs < lEnd) {
+        initBlackbox(RESET_BROWNOUT);
+        nFaults += checkRecovery(&lBogus);
+        cSeqStart = cBlackboxSeq;
+        lCutAt = lNowUs + (1 + rand() % 600) * 1000000UL;
+        isMidRecord = rand() % 2 == 0;
+        while ((lNowUs < lCutAt || (isMidRecord && cBlackboxCount == 0)) && lNowUs < lEnd) {
+            unsigned int nMs = millis();
+
+            if (nMs % BENCH_FRAME_MS == 0) {
+                nServoFrames += (rand() % 400 == 0) ? 2 : 1; // Now and then a missed frame
+                blackboxFrame();
+            }
+            if (nMs % BENCH_GOVERNOR_MS == 0) {
+                acRaw[rand() % SENSORCOUNT] = (rand() % 20000 == 0) ? 255 : 128;
+                blackboxWatch((rand() % 2000 == 0) ? 4400 : 4900, acRaw);
+            }
+            if (rand() % 30000 == 0) {
+                cNewMode = rand() % 6;
+                blackboxEvent(BLACKBOX_MODE, cNewMode, cMode, 0);
+                cMode = cNewMode;
+            }
+            if (nMs % BENCH_TASK_MS == 0) {
+                blackboxService();
+            }
+            benchStep();
+            if (lNowUs >= lCutAt && isMidRecord && cBlackboxCount != 0) {
+                lCutAt = lNowUs + (rand() % 32) * 1000UL; // Somewhere in this record
+                isMidRecord = false;
+            }
+        }
+        lRecords += (unsigned char) (cBlackboxSeq - cSeqStart);
+        lTorn += powerCut();
+        lCuts++;
+    }
+    for (int a = RING_START; a < RING_START + RING_BYTES; a++) {
+        lMin = alWrites[a] < lMin ? alWrites[a] : lMin;
+        lMax = alWrites[a] > lMax ? alWrites[a] : lMax;
+        lSum += alWrites[a];
+    }
+    dPerHour = lMax / hours;
+    printf("wear, %.0f simulated hours\n", hours);
+    printf("  %lu records queued, %lu power cuts, %lu in the middle of a record\n", lRecords, lCuts, lTorn);
+    printf("  recovery faults %d, torn records read as whole %lu, blocked writes %lu\n", nFaults, lBogus, lBlocked);
+    printf("  writes per byte min %lu max %lu mean %.1f (max/mean %.2f)\n", lMin, lMax,
+            (double) lSum / RING_BYTES, lMax * RING_BYTES / (double) lSum);
+    printf("  %.1f writes per byte per hour, EEPROM lasts %.0f hours (%.0f days) at this rate\n",
+            dPerHour, BENCH_ENDURANCE / dPerHour, BENCH_ENDURANCE / dPerHour / 24);
+}
+
+int main(int argc, char **argv) {
+    double dHours = (argc > 1) ? atof(argv[1]) : 24;
+    FILE *fp;
+
+    srand(1);
+    printf("ring 0x%02X-0xFF, %u slots of %u bytes, %uus a byte\n", BLACKBOX_EEPROM_START,
+            BLACKBOX_SLOTS, BLACKBOX_RECORD_SIZE, BENCH_WRITE_US);
+    runThroughput();
+    runWear(dHours);
+    if (argc > 2) {
+        fp = fopen(argv[2], "wb");
+        if (fp == NULL) {
+            perror(argv[2]);
+            return 1;
+        }
+        fwrite(acEeprom, 1, sizeof (acEeprom), fp);
+        fclose(fp);
+    }
+    return (lBlocked != 0) ? 1 : 0;
+}
@@ -0,0 +1,178 @@
+/*==============================================================================
+    Flight recorder decoder for Linux. Reads a dump of the hand's data
+    EEPROM and prints the flight recorder (Blackbox.h), oldest record first.
+
+    Build:  gcc -O2 -I. -o blackbox_decode blackbox_decode.c
+    Use:    ./blackbox_decode eeprom.hex
+            ./blackbox_decode eeprom.bin
+
+    The dump is an Intel hex file, as written by MPLAB IPE or the MPLAB X
+    EEPROM window export (data EEPROM at 0xF00000, or at 0 if the file
+    only holds the EEPROM), or a raw 256 byte image.
+
+    Each record shows its sequence number, ring slot and the time since the
+    reset it was logged in. A reset starts a new section. Slots that do not
+    hold a whole record (never written, or cut short by a power loss) are
+    counted at the end.
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "../CHRPMini.h"
+#include "../Blackbox.h"
+
+#define HEX_EEPROM          0xF00000UL  // Data EEPROM address in PIC18 hex files
+
+static const char *apModeName[] = {
+    "glove", "gestures", "come here", "record", "play", "remote"
+};
+static const char *apFingerName[] = {"thumb", "index", "middle", "ring", "pinkie"};
+
+/*==============================================================================
+    READ HEX
+        Loads the data EEPROM bytes of an Intel hex file. Returns false if
+        there were none.
+==============================================================================*/
+static bool readHex(FILE *fp, unsigned char *eeprom) {
+    char acLine[600];
+    unsigned char acLow[256];
+    unsigned long lBase = 0, lAddr;
+    unsigned int nCount, nAddr, nType, nByte;
+    bool isHigh = false, isLow = false;
+
+    memset(acLow, 0xFF, sizeof (acLow));
+    while (fgets(acLine, sizeof (acLine), fp) != NULL) {
+        if (acLine[0] != ':' || sscanf(acLine + 1, "%2x%4x%2x", &nCount, &nAddr, &nType) != 3) {
+            continue;
+        }
+        if (nType == 4 && sscanf(acLine + 9, "%4x", &nByte) == 1) {
+            lBase = (unsigned long) nByte << 16;
+        } else if (nType == 0) {
+            for (unsigned int i = 0; i < nCount && sscanf(acLine + 9 + 2 * i, "%2x", &nByte) == 1; i++) {
+                lAddr = lBase + nAddr + i;
+                if (lAddr >= HEX_EEPROM && lAddr < HEX_EEPROM + 256) {
+                    eeprom[lAddr - HEX_EEPROM] = nByte;
+                    isHigh = true;
+                } else if (lAddr < 256) {
+                    acLow[lAddr] = nByte;
+                    isLow = true;
+                }
+            }
+        }
+    }
+    if (!isHigh && isLow) {
+        memcpy(eeprom, acLow, sizeof (acLow));
+    }
+    return isHigh || isLow;
+}
+
+/*==============================================================================
+    READ SLOT
+        Copies a ring slot out of the dump and checks it, as the firmware's
+        blackboxReadSlot() does.
+==============================================================================*/
+static bool readSlot(const unsigned char *eeprom, int slot, unsigned char *record) {
+    unsigned char cSum = 0;
+
+    memcpy(record, eeprom + BLACKBOX_EEPROM_START + slot * BLACKBOX_RECORD_SIZE, BLACKBOX_RECORD_SIZE);
+    for (int i = 0; i < BLACKBOX_RECORD_SIZE; i++) {
+        cSum += record[i];
+    }
+    return cSum == 0 && record[1] >= BLACKBOX_BOOT && record[1] <= BLACKBOX_STATS;
+}
+
+/*==============================================================================
+    PRINT RECORD
+==============================================================================*/
+static void printRecord(const unsigned char *record, int slot) {
+    unsigned int nTime = record[2] | (record[3] << 8);
+    unsigned char cRails = record[6] & ((1 << BLACKBOX_SAG_SHIFT) - 1);
+
+    if (record[1] == BLACKBOX_BOOT) {
+        printf("\n");
+    }
+    printf("%3u  %2d  %2u:%02u:%02u  ", record[0], slot, nTime / 3600, nTime / 60 % 60, nTime % 60);
+    switch (record[1]) {
+        case BLACKBOX_BOOT:
+            printf("reset:");
+            if (record[4] & RESET_POWER) printf(" power-on");
+            if (record[4] & RESET_BROWNOUT) printf(" BROWNOUT");
+            if (record[4] & RESET_WATCHDOG) printf(" WATCHDOG");
+            if (record[4] & RESET_INSTRUCTION) printf(" reset instruction");
+            if (record[4] & RESET_STACK) printf(" STACK OVERFLOW");
+            if (record[4] & RESET_MCLR) printf(" reset pin");
+            printf(", %u records found\n", record[5]);
+            break;
+        case BLACKBOX_MODE:
+            printf("mode %u (%s), was %u\n", record[4], record[4] < 6 ? apModeName[record[4]] : "?", record[5]);
+            break;
+        case BLACKBOX_STATS:
+            printf("missed %u%s frames, lowest supply %umV, %u sags",
+                    record[4], record[4] == 255 ? "+" : "", record[5] * 20, record[6] >> BLACKBOX_SAG_SHIFT);
+            if (cRails != 0) {
+                printf(", at a rail:");
+                for (int i = 0; i < 5; i++) {
+                    if (cRails & (1 << i)) printf(" %s", apFingerName[i]);
+                }
+            }
+            printf("\n");
+            break;
+    }
+}
+
+int main(int argc, char **argv) {
+    unsigned char acEeprom[256], acRecord[BLACKBOX_RECORD_SIZE], cNewestSeq = 0;
+    int nNewest = -1, nFound = 0, nSlot;
+    FILE *fp;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <eeprom.hex | eeprom.bin>\n", argv[0]);
+        return 1;
+    }
+    fp = fopen(argv[1], "rb");
+    if (fp == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    memset(acEeprom, 0xFF, sizeof (acEeprom));
+    if (fgetc(fp) == ':') {
+        rewind(fp);
+        if (!readHex(fp, acEeprom)) {
+            fprintf(stderr, "%s: no data EEPROM in the hex file\n", argv[1]);
+            return 1;
+        }
+    } else {
+        rewind(fp);
+        if (fread(acEeprom, 1, sizeof (acEeprom), fp) != sizeof (acEeprom)) {
+            fprintf(stderr, "%s: not a 256 byte EEPROM image\n", argv[1]);
+            return 1;
+        }
+    }
+    fclose(fp);
+
+    for (int slot = 0; slot < BLACKBOX_SLOTS; slot++) {
+        if (readSlot(acEeprom, slot, acRecord)) {
+            if (nNewest < 0 || (unsigned char) (acRecord[0] - cNewestSeq) < 128) {
+                cNewestSeq = acRecord[0];
+                nNewest = slot;
+            }
+            nFound++;
+        }
+    }
+    if (nNewest < 0) {
+        printf("no records\n");
+        return 0;
+    }
+    printf("seq slot    time  event\n");
+    for (int i = 1; i <= BLACKBOX_SLOTS; i++) {
+        nSlot = (nNewest + i) % BLACKBOX_SLOTS; // Oldest first
+        if (readSlot(acEeprom, nSlot, acRecord)) {
+            printRecord(acRecord, nSlot);
+        }
+    }
+    printf("\n%d records, %d empty or cut short slots\n", nFound, BLACKBOX_SLOTS - nFound);
+    return 0;
+}
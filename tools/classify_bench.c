@@ -0,0 +1,153 @@
+/*==============================================================================
+    Classifier benchmark. Runs the firmware's pose classifier (Classify.c)
+    over a recorded trace and reports its accuracy and speed.
+
+    Build:  gcc -O2 -I. -o classify_bench classify_bench.c ../Classify.c \
+                ../Gesture.c ../Tick.c
+    Use:    ./telemetry_decode /dev/ttyUSB0 > trace.csv      (mode 0)
+            ./classify_bench trace.csv
+            ./classify_bench traces/classify.csv
+
+    The trace is the CSV written by telemetry_decode. The glove columns
+    (glove0..glove4) are classified frame by frame: the calibrated glove
+    pose, which is what classifyPose() is given in mode 0, not the pos
+    columns the servos were sent after snapping and motion limits. If a
+    "label" column is added after the last column (the gesture number that
+    was being held, or -1 for none), the matches are scored against it.
+
+    traces/classify.csv is labelled: the telemetry of hand_sim playing
+    traces/classify.trace, every 10th frame from the end of calibration,
+    with the gesture each glove event of the trace was aimed at. The glove
+    there is simulated, so it has no sensor noise; record a real one for
+    that. Without labels the
+    classifier is compared with a full precision nearest gesture search
+    with no hysteresis, which shows what the 8-bit kernel and the
+    hysteresis change.
+
+    The speed shown is for this PC. The firmware cost is measured with
+    PROFILE_ENABLE=1 (PROF_CLASSIFY).
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "../Sensors.h"
+#include "../Gesture.h"
+#include "../Classify.h"
+
+#define MAX_FRAMES          200000
+#define GLOVE_COLUMN        20          // glove0 in the telemetry_decode CSV
+#define LABEL_COLUMN        25          // Optional label after the last column
+
+static unsigned char acTrace[MAX_FRAMES][SENSORCOUNT];
+static int anLabel[MAX_FRAMES];
+
+/*==============================================================================
+    NEAREST
+        Full precision nearest gesture, for comparison.
+==============================================================================*/
+static int nearest(const unsigned char *pos) {
+    int nBest = -1, nBestDist = 1 << 30;
+
+    for (int g = 0; g < GESTURE_COUNT; g++) {
+        const unsigned char *pose = gesturePose(g);
+        int nDist = 0;
+
+        for (int i = 0; i < SENSORCOUNT; i++) {
+            nDist += abs(pos[i] - pose[i]);
+        }
+        if (nDist < nBestDist) {
+            nBest = g;
+            nBestDist = nDist;
+        }
+    }
+    return (nBestDist <= CLASS_FAR_DIST << CLASS_SHIFT) ? nBest : CLASS_NONE;
+}
+
+int main(int argc, char **argv) {
+    char line[512];
+    unsigned char acPos[SENSORCOUNT];
+    int nFrames = 0, nLabelled = 0, nRight = 0, nAgree = 0, nSwitches = 0, nRefSwitches = 0;
+    int nLast = CLASS_NONE, nRefLast = CLASS_NONE, nClass, nRef, anCount[GESTURE_COUNT + 1] = {0};
+    clock_t start;
+    double seconds;
+    FILE *file;
+
+    if (argc != 2 || (file = fopen(argv[1], "r")) == NULL) {
+        fprintf(stderr, "usage: %s <trace.csv>\n", argv[0]);
+        return 1;
+    }
+    while (fgets(line, sizeof (line), file) != NULL && nFrames < MAX_FRAMES) {
+        char *field = strtok(line, ",");
+        int nColumn = 0;
+
+        if (line[0] < '0' || line[0] > '9') {
+            continue; // Header
+        }
+        anLabel[nFrames] = -2;
+        for (; field != NULL; field = strtok(NULL, ","), nColumn++) {
+            if (nColumn >= GLOVE_COLUMN && nColumn < GLOVE_COLUMN + SENSORCOUNT) {
+                acTrace[nFrames][nColumn - GLOVE_COLUMN] = (unsigned char) atoi(field);
+            } else if (nColumn == LABEL_COLUMN) {
+                anLabel[nFrames] = atoi(field);
+            }
+        }
+        if (nColumn >= GLOVE_COLUMN + SENSORCOUNT) {
+            nFrames++;
+        }
+    }
+    fclose(file);
+    if (nFrames == 0) {
+        fprintf(stderr, "no frames in %s\n", argv[1]);
+        return 1;
+    }
+
+    initClassify();
+    for (int f = 0; f < nFrames; f++) {
+        memcpy(acPos, acTrace[f], SENSORCOUNT);
+        nClass = classifyPose(acPos);
+        nRef = nearest(acTrace[f]);
+        anCount[nClass == CLASS_NONE ? GESTURE_COUNT : nClass]++;
+        nSwitches += (nClass != nLast);
+        nRefSwitches += (nRef != nRefLast);
+        nAgree += (nClass == nRef);
+        nLast = nClass;
+        nRefLast = nRef;
+        if (anLabel[f] != -2) {
+            nLabelled++;
+            nRight += (nClass == (anLabel[f] < 0 ? CLASS_NONE : anLabel[f]));
+        }
+    }
+
+    start = clock();
+    for (int n = 0; n < 100; n++) {
+        classifyReset();
+        for (int f = 0; f < nFrames; f++) {
+            memcpy(acPos, acTrace[f], SENSORCOUNT);
+            classifyPose(acPos);
+        }
+    }
+    seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%d frames\n", nFrames);
+    for (int g = 0; g <= GESTURE_COUNT; g++) {
+        if (anCount[g] == 0) {
+            continue;
+        }
+        if (g == GESTURE_COUNT) {
+            printf("  none       %6d frames\n", anCount[g]);
+        } else {
+            printf("  gesture %d  %6d frames\n", g, anCount[g]);
+        }
+    }
+    printf("match changes: %d (full precision, no hysteresis: %d)\n", nSwitches, nRefSwitches);
+    printf("agreement with full precision nearest: %.1f%%\n", 100.0 * nAgree / nFrames);
+    if (nLabelled != 0) {
+        printf("accuracy against labels: %.1f%% of %d frames\n", 100.0 * nRight / nLabelled, nLabelled);
+    }
+    printf("host speed: %.0f poses/s\n", 100.0 * nFrames / (seconds > 0 ? seconds : 1e-9));
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*==============================================================================
+    Constraint engine benchmark. Runs the firmware's pose rules (Constrain.c)
+    over random poses with longer and longer rule tables and reports the
+    cost per frame.
+
+    Build:  gcc -O2 -I. -o constrain_bench constrain_bench.c ../Constrain.c
+    Use:    ./constrain_bench [poses]
+
+    For each table length from 0 to CONSTRAIN_MAX_RULES a table of random
+    rules (all four types, random fingers and limits) is run over random
+    poses, 100000 by default. The last line runs the variant's own table in
+    mode 0 (build with eg. -DVARIANT_MG90 to pick the variant). The columns
+    are:
+        rules   rules in use in mode 0
+        est     firmware cycles per frame from the per rule estimates in
+                Constrain.h, the same for every pose
+        max     the bound for this many rules of the dearest type
+        ns      time per frame on this PC
+        moved   poses changed by the rules
+        broken  poses still breaking a rule after CONSTRAIN_PASSES passes,
+                from rules fighting each other (random tables are far
+                more contrary than a real one)
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "../Constrain.h"
+
+#define RULE_LOOP_CYCLES    20          // Loop and table read, per rule
+
+static const unsigned int anRuleCycles[4] = {30, 60, 50, 90};
+//anRuleCycles is the Constrain.h estimate for each rule type
+static const rule_t asVariant[] = CONSTRAIN_RULES;
+//asVariant is the rule table the firmware is built with
+
+/*==============================================================================
+    RANDOM RULE
+        Makes a random rule that applies in every mode.
+==============================================================================*/
+static void randomRule(rule_t *rule) {
+    rule->cType = rand() % 4;
+    rule->cA = rand() % 5;
+    do {
+        rule->cB = rand() % 5;
+    } while (rule->cB == rule->cA);
+    rule->cLo = 64 + rand() % 160;
+    rule->cHi = 64 + rand() % 160;
+    if (rule->cType == RULE_RANGE && rule->cLo > rule->cHi) {
+        unsigned char cSwap = rule->cLo;
+
+        rule->cLo = rule->cHi;
+        rule->cHi = cSwap;
+    }
+    rule->cModes = 0xFF;
+}
+
+/*==============================================================================
+    IS BROKEN
+        True if a pose breaks a rule, checked independently of Constrain.c.
+==============================================================================*/
+static bool isBroken(const unsigned char *pos, const rule_t *rule) {
+    int nA = pos[rule->cA], nB = pos[rule->cB];
+
+    switch (rule->cType) {
+        case RULE_RANGE:
+            return nA < rule->cLo || nA > rule->cHi;
+        case RULE_GAP:
+            return abs(nA - nB) > rule->cLo;
+        case RULE_ZONE:
+            return nA > rule->cLo && nB > rule->cHi;
+        default:
+            for (int i = 0; i < 5; i++) {
+                if (i != rule->cA && pos[i] <= nA) {
+                    return false;
+                }
+            }
+            return true;
+    }
+}
+
+/*==============================================================================
+    RUN TABLE
+        Runs one rule table over all the poses and prints one line.
+==============================================================================*/
+static void runTable(const char *name, const rule_t *rules, int count, unsigned char (*poses)[5], int nPoses) {
+    unsigned char acPos[5];
+    unsigned int nEst = 0, nMoved = 0, nBroken = 0, nUsed = 0;
+    struct timespec sStart, sEnd;
+    double dNs;
+
+    initConstrain(rules, count);
+    for (int i = 0; i < count; i++) {
+        if (rules[i].cModes & CONSTRAIN_MODE(0)) {
+            nEst += (anRuleCycles[rules[i].cType] + RULE_LOOP_CYCLES) * CONSTRAIN_PASSES;
+            nUsed++;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &sStart);
+    for (int n = 0; n < nPoses; n++) {
+        memcpy(acPos, poses[n], 5);
+        constrainPose(acPos, CONSTRAIN_MODE(0));
+        if (memcmp(acPos, poses[n], 5) != 0) {
+            nMoved++;
+        }
+        for (int i = 0; i < count; i++) {
+            if ((rules[i].cModes & CONSTRAIN_MODE(0)) && isBroken(acPos, &rules[i])) {
+                nBroken++;
+                break;
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &sEnd);
+    dNs = ((sEnd.tv_sec - sStart.tv_sec) * 1e9 + (sEnd.tv_nsec - sStart.tv_nsec)) / nPoses;
+    printf("%-7s %5u %5u %6u %7.1f %5.1f%% %6.2f%%\n", name, nUsed, nEst,
+            nUsed * (90 + RULE_LOOP_CYCLES) * CONSTRAIN_PASSES, dNs,
+            100.0 * nMoved / nPoses, 100.0 * nBroken / nPoses);
+}
+
+int main(int argc, char **argv) {
+    int nPoses = (argc > 1) ? atoi(argv[1]) : 100000;
+    rule_t asRules[CONSTRAIN_MAX_RULES];
+    unsigned char (*pPoses)[5] = malloc((size_t) nPoses * 5);
+
+    srand(1);
+    for (int n = 0; n < nPoses; n++) {
+        for (int i = 0; i < 5; i++) {
+            pPoses[n][i] = rand() % 256;
+        }
+    }
+    for (int i = 0; i < CONSTRAIN_MAX_RULES; i++) {
+        randomRule(&asRules[i]);
+    }
+
+    printf("table   rules   est    max      ns  moved  broken\n");
+    for (int nRules = 0; nRules <= CONSTRAIN_MAX_RULES; nRules++) {
+        runTable("random", asRules, nRules, pPoses, nPoses);
+    }
+    runTable("variant", asVariant, sizeof (asVariant) / sizeof (asVariant[0]), pPoses, nPoses);
+    free(pPoses);
+    return 0;
+}
@@ -0,0 +1,1139 @@
+/*==============================================================================
+    Hand simulation. Runs the whole firmware, Hand.c's main() included, in
+    virtual time against a model of the PIC18F25K50 peripherals it uses, and
+    drives the glove, S1, the supply and the remote peer from a trace file.
+    First checks the servo engine (Servo.c) on its own, then plays the trace
+    and reports the frame, pulse and latency timing of each mode.
+
+    Build:  make sim (Host.mk), which builds hand_sim for every variant and
+            plays each trace in tools/traces/ on it
+    Use:    ./hand_sim [trace [frames [capture.bin]]]
+
+    The firmware modules are built with CHRP_HOST set to hand_sim.h, so the
+    hardware access block of CHRPMini.h and every register the firmware
+    touches are replaced by the model below, and CHRPMini.c is replaced by
+    its EEPROM and flash functions here. Hand.c's main() is renamed
+    handMain() and its ISRs are called when their flags are set, so a
+    change to how Hand.c wires the modules together shows up here.
+
+    Time is counted in instruction cycles (12 per microsecond). TMR0 counts
+    every 4 cycles (FOSC/4 through the 1:4 prescaler), stops for 2 cycles
+    after it is written and sets its flag when it overflows. TMR2 sets its
+    flag every period that PR2 and T2CON give, TMR3 when it overflows after
+    beeperISR() loads it. The EUSART sends and receives a byte in 10 bit
+    times at the baud rate in SPBRG1, and its receiver holds 2 bytes; a
+    third sets OERR and is lost. An interrupt is taken SIM_ENTRY_CYCLES
+    after its flag is set (plus one more cycle half the time, for a two
+    cycle instruction), and every register access in an ISR takes
+    SIM_ACCESS_CYCLES. Port latch writes are timed to the cycle. The sum in
+    servoReload() takes SIM_RELOAD_CYCLES, so that from the TMR0 read to the
+    timer running again is the 3 ticks of SERVO_RELOAD_TICKS on average; build
+    with -DSIM_RELOAD_CYCLES=n to see how the frame drifts if it is not.
+
+    The servo ISR is high priority and is taken at the first register access
+    after its flag, even in the middle of the low priority ISR. The low
+    priority ISR and the scheduled tasks run their C code at once and hold
+    the processor for the SIM_*_CYCLES they are estimated to take, with
+    interrupts taken in between. A data EEPROM write takes SIM_EEPROM_MS,
+    and a flash erase or write stops the processor for SIM_FLASH_CYCLES with
+    every interrupt held off, so only one of the TMR2 periods it covers
+    is seen, as on the chip.
+
+    Servo test
+        Each output mode is run at the 20ms frame for the given number of
+        frames (200 by default) with every servo at position 0, at 255, and
+        on a mix of positions, the channels after the fingers set with
+        servoSetChannel(). A frame (step 0 of one frame to the next) must be
+        SERVO_FRAME_US and each pulse the width the trims give, both to
+        within SIM_TOLERANCE_US.
+
+    Trace
+        One event per line, at a time in ms from power up; # starts a
+        comment. Times must not go backwards.
+            <ms> glove t i m r p    bend of each glove finger, 0 straight to
+                                    1 bent; all straight at power up
+            <ms> press <held ms>    S1 down, up again after held ms
+            <ms> vdd <volts>        supply, 5.0 at power up
+            <ms> remote <type> <payload...>
+                                    a remote packet (Remote.h), the sync
+                                    bytes and checksum are added
+            <ms> expect pose t i m r p [tol]
+                                    arcServoPos, each within tol (8 by
+                                    default); - for a finger not checked
+            <ms> expect mode <n>    cMode
+            <ms> expect select <0/1> modeSelect
+            <ms> expect match <g>   cClassMatch, the gesture the classifier
+                                    (MIRROR_SNAP) matched, -1 for none
+            <ms> end                report and exit
+        The EEPROM starts erased, so the hand calibrates for 10s at power
+        up. tools/traces/modes.trace steps through every mode, and
+        tools/traces/classify.trace holds the glove near each gesture.
+
+    Columns of the trace report, one row for each mode and for mode select:
+        frames  frames checked, counted from SIM_BOOT_MS
+        mean    mean frame period
+        jitter  longest less shortest frame period
+        pulse   largest error of a finger pulse width from the pose that was
+                queued when the frame began
+        adc     longest delay from the TMR2 flag to the conversion start
+        latency mean and longest time from a glove move of the index finger
+                (or an S1 release) to the start of the first index finger
+                pulse that has moved
+
+    Every byte sent on the telemetry TX pin is written to capture.bin if
+    given, for ./telemetry_decode - < capture.bin.
+
+    Then the millisecond tick against virtual time, the flash stalls, the
+    telemetry frames sent and dropped (nTelemDropped) and the remote bytes
+    and overruns. Exits with 1 if any frame or pulse is out of tolerance,
+    millis() is more than SIM_TICK_MS off (tickLost() must make up the
+    stalls) or an expect fails. Fingers can be close enough for their edges to be
+    merged, so in the trace a pulse may also be off by SERVO_MERGE_TICKS.
+
+    Not modelled: the task and ISR times, which are only estimates. Profile
+    a PROFILE_ENABLE build (Profile.h) for the real ones.
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "../CHRPMini.h"
+#include "../Servo.h"
+#include "../Sensors.h"
+#include "../Tick.h"
+#include "../Sched.h"
+#include "../Telemetry.h"
+#include "../Remote.h"
+#include "../Record.h"
+#include "../Classify.h"
+#undef main
+
+#define SIM_CYCLES_PER_US   12          // FOSC/4
+#define SIM_CYCLES_PER_MS   (1000UL * SIM_CYCLES_PER_US)
+#define SIM_TMR0_PRESCALE   4           // Cycles per TMR0 tick
+#define SIM_TMR3_PRESCALE   8           // Cycles per TMR3 tick (T3CON in initBeeper())
+#define SIM_WRITE_CYCLES    2           // TMR0 holds after a write
+#define SIM_ENTRY_CYCLES    20          // Flag to the first ISR statement (latency, context save)
+#define SIM_EXIT_CYCLES     10          // Context restore and RETFIE
+#define SIM_ACCESS_CYCLES   2           // Each register access in an ISR
+#ifndef SIM_RELOAD_CYCLES
+#define SIM_RELOAD_CYCLES   6           // 16-bit sum between the TMR0 read and write in servoReload()
+#endif
+#define SIM_TOLERANCE_US    2.0         // Allowed frame and pulse width error
+#define SIM_SETTLE_FRAMES   2           // Frames before a new pose is checked
+#define SIM_MERGE_US        ((double) SERVO_MERGE_TICKS / SERVO_TICKS_PER_US) // Merged edges, on top
+
+#ifndef SIM_LOW_CYCLES
+#define SIM_LOW_CYCLES      360         // TMR2 in the low ISR: a ring sample, the tick and its 1ms work
+#endif
+#define SIM_BEEP_CYCLES     60          // TMR3 in the low ISR: reload and toggle
+#define SIM_RX_CYCLES       100         // RX in the low ISR: one receiver step
+#define SIM_TX_CYCLES       80          // TX in the low ISR: one byte
+#ifndef SIM_SERVO_TASK_CYCLES
+#define SIM_SERVO_TASK_CYCLES 6000      // Constraints, motion step and edge programme
+#endif
+#ifndef SIM_SENSOR_TASK_CYCLES
+#define SIM_SENSOR_TASK_CYCLES 4800     // Five filters and table lookups, prediction
+#endif
+#ifndef SIM_GESTURE_TASK_CYCLES
+#define SIM_GESTURE_TASK_CYCLES 1200    // One gesture update
+#endif
+#define SIM_GOVERNOR_TASK_CYCLES 1200   // Supply filter and auto-ranging
+#define SIM_SMALL_TASK_CYCLES 300       // Any other task
+#define SIM_EEPROM_CYCLES   20          // An EEPROM read or the start of a write
+#define SIM_EEPROM_MS       4           // An EEPROM write
+#define SIM_FLASH_CYCLES    (2 * SIM_CYCLES_PER_MS) // A flash erase or write, processor stopped
+#define SIM_MAX_TASKS       8           // Tasks that can be timed
+
+#define SIM_TICK_MS         1           // Allowed millis() error, the stalls are not exact
+#define SIM_BOOT_MS         100         // Time from power up before frames are checked
+#define SIM_WATCH           1           // Finger whose latency is measured
+#define SIM_MOVE_US         6.0         // Pulse change that counts as a move, one position
+#define SIM_LATENCY_MS      1000        // Longest latency looked for
+#define SIM_BENT            0.12        // Sensor pin voltage / VDD of a bent finger
+#define SIM_STRAIGHT        0.30        // and of a straight one
+#define SIM_VDD             5.0
+#define SIM_EXT_V           2.5         // VREF+ with ADC_EXT_REF
+#define SIM_RX_FIFO         2           // Received bytes the EUSART holds
+#define SIM_RX_QUEUE        1024        // Bytes of remote packets waiting to be sent
+#define SIM_MAX_EVENTS      512
+#define SIM_MAX_ARGS        9
+#define SIM_POSE_TOL        8           // Default tolerance of expect pose
+#define SIM_SELECT          (MODE_REMOTE + 1) // Report row of mode select
+#define SIM_ROWS            (SIM_SELECT + 1)
+
+#define SIM_GLOVE           0           // Trace event kinds
+#define SIM_PRESS           1
+#define SIM_VDD_EVENT       2
+#define SIM_REMOTE          3
+#define SIM_EXPECT_POSE     4
+#define SIM_EXPECT_MODE     5
+#define SIM_EXPECT_SELECT   6
+#define SIM_EXPECT_MATCH    7
+#define SIM_END             8
+
+typedef struct {
+    unsigned long lFrames, lPulses, lAdcLate;
+    double fFrameMin, fFrameMax, fFrameSum, fPulseErr;
+    unsigned long lLatencySum, lLatencyMax, lLatencies;
+} simStats_t;
+
+typedef struct {
+    unsigned long lMs;
+    unsigned char cKind, cArgs;
+    double afArg[SIM_MAX_ARGS];         // Negative for '-'
+    unsigned int nLine;
+} simEvent_t;
+
+extern unsigned char arcPos[5], arcServoPos[5], cMode;
+extern bool modeSelect;
+void isr(void);
+void isrLow(void);
+void servoTask(void);
+void controlTask(void);
+void governorTask(void);
+//From Hand.c
+extern volatile unsigned char cServoStep;
+extern volatile bool isServoPending;
+extern int anServoPos[SERVO_CHANNELS];
+//From Servo.c
+extern task_t *pSchedTasks;
+extern unsigned char cSchedCount;
+//From Sched.c
+
+simPortA_t PORTAbits;
+simLatA_t LATAbits;
+simPortB_t PORTBbits;
+simLatB_t LATBbits;
+simPortC_t PORTCbits;
+simLatC_t LATCbits;
+simPortE_t PORTEbits;
+unsigned char cLatB, cLatC, cTmr0Ie;
+unsigned char ADCON0, ADCON1, ADCON2, ADRESH, ADRESL, VREFCON0;
+unsigned char PR2, TMR2, T2CON, TMR2IP, TMR2IF, TMR2IE, ADON;
+unsigned char T3CON, TMR3H, TMR3L, TMR3ON, TMR3IP, TMR3IF, TMR3IE;
+unsigned char T1CON, cTmr1High;
+unsigned char SPBRGH1, SPBRG1, BAUDCON1, TXSTA1, RCSTA1;
+unsigned char TX1IP, TX1IE, TX1IF, RC1IP, RC1IE, RC1IF;
+unsigned char IPEN, GIEH, GIEL, IDLEN;
+//Register stand-ins, see hand_sim.h
+
+static unsigned long lCycle, lTmrStart, lOverflow, lPortCycle;
+static unsigned int nTmrStart;
+//lCycle is the virtual time, TMR0 counted nTmrStart at lTmrStart and
+//overflows next at lOverflow, lPortCycle is the last port latch access
+static unsigned char cSeenB, cSeenC, cTmr0If;
+//Latches at the last check and the TMR0 flag
+static unsigned long lTmr2Next, lTmr2Flag, lTmr3Next;
+static unsigned int nAdcResult;
+static unsigned char cLevel;
+//TMR2 flags next at lTmr2Next and last did at lTmr2Flag, TMR3 overflows at
+//lTmr3Next (0 when not counting), cLevel is 0 in the main loop, 1 in the
+//low priority ISR and 2 in the servo ISR
+static unsigned long lTxFree, lTxBytes, lRxBytes, lRxOverruns;
+static unsigned char acRxQueue[SIM_RX_QUEUE], acRxFifo[SIM_RX_FIFO], cRxFifo;
+static unsigned int nRxHead, nRxTail;
+static unsigned long lRxNext;
+//The TX byte on the wire has gone at lTxFree. Remote bytes wait in
+//acRxQueue, the next arrives at lRxNext, and cRxFifo are in the receiver
+static FILE *pCapture;
+//pCapture gets the telemetry bytes, if a capture file was given
+static unsigned char acEeprom[256], acFlash[REC_FLASH_END - REC_FLASH_START];
+static unsigned long lEepromDone, lStalls;
+//Data EEPROM and the recording region of flash, lEepromDone is when the
+//EEPROM write in progress ends, lStalls counts flash erases and writes
+
+static int anPose[SERVO_CHANNELS];
+static unsigned long alRise[SERVO_CHANNELS], lLastFrame;
+static bool isChecking, isFrameEdge;
+static unsigned char cChecked;
+//anPose is the fine pose the pulses are checked against, swapped in with
+//the programme, alRise each pulse start, cChecked the channels checked,
+//isFrameEdge is set while the ISR that starts a frame has not yet written the port
+static simStats_t asStats[SIM_ROWS], *pStats = &asStats[0];
+//Statistics of each report row, pStats the row of the frame running
+static unsigned long lStep;
+static double fWatchUs;
+//lStep is when the glove moved (0 once the move is seen), fWatchUs the
+//steady pulse width of the watched finger before it
+
+static simEvent_t asEvents[SIM_MAX_EVENTS];
+static unsigned int nEvents, nEvent, nExpects, nExpectsFailed;
+static unsigned long lRelease;
+static bool isHand;
+static double afGlove[SENSORCOUNT], fVdd = SIM_VDD;
+//The trace, the next event, the expects tried and failed, when S1 is let
+//go (0 if not pressed), set once the firmware runs, and the sensor dividers
+//and supply
+
+static void (*apSimRun[SIM_MAX_TASKS])(void);
+static bool isWrapped;
+//The firmware's task functions, once wrapped to be timed
+
+static void simInterrupts(void);
+static void simEvents(void);
+
+/*==============================================================================
+    SIM NEXT
+        Time of the next flag, byte or trace event after now.
+==============================================================================*/
+static unsigned long simNext(void) {
+    unsigned long lNext = lOverflow;
+
+    if (lTmr2Next != 0 && lTmr2Next < lNext) {
+        lNext = lTmr2Next;
+    }
+    if (lTmr3Next != 0 && lTmr3Next < lNext) {
+        lNext = lTmr3Next;
+    }
+    if (!TX1IF && lTxFree < lNext) {
+        lNext = lTxFree;
+    }
+    if (nRxHead != nRxTail && lRxNext < lNext) {
+        lNext = lRxNext;
+    }
+    if (isHand && lRelease != 0 && lRelease * SIM_CYCLES_PER_MS < lNext) {
+        lNext = lRelease * SIM_CYCLES_PER_MS;
+    }
+    if (isHand && nEvent < nEvents && asEvents[nEvent].lMs * SIM_CYCLES_PER_MS < lNext) {
+        lNext = asEvents[nEvent].lMs * SIM_CYCLES_PER_MS;
+    }
+    return lNext > lCycle ? lNext : lCycle;
+}
+
+/*==============================================================================
+    SIM BYTE CYCLES
+        Cycles the EUSART takes for a byte, 10 bits at the rate set in
+        SPBRGH1:SPBRG1, BRG16 and BRGH.
+==============================================================================*/
+static unsigned long simByteCycles(void) {
+    unsigned long lDivide = (BAUDCON1 & 0b00001000) ? ((TXSTA1 & 0b00000100) ? 4 : 16)
+            : ((TXSTA1 & 0b00000100) ? 16 : 64);
+
+    return 10 * lDivide * ((SPBRGH1 << 8 | SPBRG1) + 1UL) / 4;
+}
+
+/*==============================================================================
+    SIM OVERFLOWS
+        Sets the TMR0, TMR2 and TMR3 flags for every overflow or period up to
+        now, frees the TX register, moves remote bytes into the receiver and
+        plays the trace.
+==============================================================================*/
+static void simOverflows(void) {
+    unsigned long lPeriod;
+
+    while (lOverflow <= lCycle) {
+        cTmr0If = 1;
+        lTmrStart = lOverflow;
+        nTmrStart = 0;
+        lOverflow += 65536UL * SIM_TMR0_PRESCALE;
+    }
+    if (!(T2CON & 0b00000100)) { // TMR2 off
+        lTmr2Next = 0;
+    } else {
+        lPeriod = (PR2 + 1UL) * (((T2CON >> 3) & 0x0F) + 1) * ((T2CON & 3) == 0 ? 1 : (T2CON & 3) == 1 ? 4 : 16);
+        if (lTmr2Next == 0) {
+            lTmr2Next = lCycle + lPeriod;
+        }
+        while (lTmr2Next <= lCycle) {
+            TMR2IF = 1;
+            lTmr2Flag = lTmr2Next;
+            lTmr2Next += lPeriod;
+        }
+    }
+    if (!TMR3ON) {
+        lTmr3Next = 0;
+    } else if (lTmr3Next != 0 && lTmr3Next <= lCycle) {
+        TMR3IF = 1;
+        lTmr3Next = 0; // Counts again once beeperISR() reloads it
+    }
+    if (lTxFree <= lCycle) {
+        TX1IF = 1;
+    }
+    while (nRxHead != nRxTail && lRxNext <= lCycle) {
+        if (!(RCSTA1 & 0b00010000)) {
+            // Receiver off, the byte is lost
+        } else if (cRxFifo == SIM_RX_FIFO || (RCSTA1 & 0b00000010)) {
+            RCSTA1 |= 0b00000010; // OERR, the receiver stops until CREN is cleared
+            lRxOverruns++;
+        } else {
+            acRxFifo[cRxFifo++] = acRxQueue[nRxTail];
+        }
+        nRxTail = (nRxTail + 1) % SIM_RX_QUEUE;
+        lRxNext += simByteCycles();
+    }
+    RC1IF = cRxFifo != 0;
+    if (isHand) {
+        simEvents();
+    }
+}
+
+void simAccess(void) {
+    lCycle += SIM_ACCESS_CYCLES;
+    simInterrupts(); // The servo ISR is taken between two accesses of the low ISR
+}
+
+unsigned long simTimerRead(void) {
+    simAccess();
+    if (lCycle < lTmrStart) {
+        return nTmrStart;
+    }
+    return (nTmrStart + (lCycle - lTmrStart) / SIM_TMR0_PRESCALE) & 0xFFFF;
+}
+
+void simTimerWrite(unsigned int n) {
+    lCycle += SIM_RELOAD_CYCLES;
+    simAccess();
+    lTmrStart = lCycle + SIM_WRITE_CYCLES; // The prescaler starts again from 0
+    nTmrStart = n & 0xFFFF; // TMR0H:TMR0L, an int is wider here
+    lOverflow = lTmrStart + (65536UL - nTmrStart) * SIM_TMR0_PRESCALE;
+}
+
+unsigned char *simTimerFlag(void) {
+    simAccess();
+    return &cTmr0If;
+}
+
+unsigned char simTimer1Low(void) {
+    unsigned int nCount = (unsigned int) (lCycle / 8); // Profile.c runs TMR1 at 1:8
+
+    simAccess();
+    cTmr1High = (unsigned char) (nCount >> 8);
+    return (unsigned char) nCount;
+}
+
+/*==============================================================================
+    SIM TX REG
+        The TXREG1 write: puts the byte on the wire and clears TX1IF until it
+        has been sent.
+==============================================================================*/
+unsigned char *simTxReg(void) {
+    static unsigned char cByte;
+
+    simAccess();
+    if (!TX1IF) {
+        fprintf(stderr, "TXREG1 written while full\n");
+        exit(1);
+    }
+    if (pCapture != NULL && lTxBytes != 0) {
+        fputc(cByte, pCapture); // The byte written last time, now that it is in
+    }
+    TX1IF = 0;
+    lTxFree = lCycle + simByteCycles();
+    lTxBytes++;
+    return &cByte;
+}
+
+unsigned char simRxReg(void) {
+    unsigned char cByte = acRxFifo[0];
+
+    simAccess();
+    if (cRxFifo != 0) {
+        cRxFifo--;
+        acRxFifo[0] = acRxFifo[1];
+    }
+    RC1IF = cRxFifo != 0;
+    return cByte;
+}
+
+/*==============================================================================
+    SIM ADC START
+        Works out the conversion adcISR() just started from ADCON0, ADCON1
+        and VREFCON0, the pin voltage over the selected reference, and keeps
+        it for simAdcResult(). A conversion (~17us) is always done by the
+        next slot.
+==============================================================================*/
+void simAdcStart(void) {
+    unsigned char cChan = ADCON0 & 0b01111100, cRef = ADCON1 & 0b00001100;
+    double fFvr = 1.024 * (1 << (((VREFCON0 >> 4) & 3) - 1)), fRef, fVolts = 0, fSteps;
+
+    simAccess();
+    if (cLevel == 1 && lCycle - lTmr2Flag > pStats->lAdcLate) {
+        pStats->lAdcLate = lCycle - lTmr2Flag;
+    }
+    fRef = cRef == ADREFFVR ? fFvr : cRef == ADREFEXT ? SIM_EXT_V : fVdd;
+    if (cChan == ADFVR) {
+        fVolts = fFvr;
+    } else if (cChan == ADTD) {
+        fVolts = 0.7;
+    } else if (cChan == ADVREFP && ADC_EXT_REF) { // RA3 is VREF+, not the ring sensor
+        fVolts = SIM_EXT_V;
+    } else {
+        for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+            if (cChan == asServoChannel[i].cSensor) {
+                fVolts = fVdd * afGlove[i];
+            }
+        }
+    }
+    fSteps = fVolts / fRef * ADC_FULL;
+    nAdcResult = fSteps > ADC_FULL - 1 ? ADC_FULL - 1 : (unsigned int) fSteps;
+}
+
+unsigned int simAdcResult(void) {
+    simAccess();
+    return nAdcResult;
+}
+
+/*==============================================================================
+    SIM FRAME
+        Counts a frame from the first latch access of the ISR call that runs
+        step 0, so frames are timed even while the fingers rest.
+==============================================================================*/
+static void simFrame(void) {
+    double fWidth = (double) (lPortCycle - lLastFrame) / SIM_CYCLES_PER_US;
+
+    if (isHand) {
+        pStats = &asStats[modeSelect ? SIM_SELECT : cMode < MODE_REMOTE ? cMode : MODE_REMOTE];
+    }
+    if (isChecking && lLastFrame != 0) {
+        pStats->fFrameMin = fWidth < pStats->fFrameMin ? fWidth : pStats->fFrameMin;
+        pStats->fFrameMax = fWidth > pStats->fFrameMax ? fWidth : pStats->fFrameMax;
+        pStats->fFrameSum += fWidth;
+        pStats->lFrames++;
+    }
+    lLastFrame = lPortCycle;
+    isFrameEdge = false;
+}
+
+/*==============================================================================
+    SIM EDGES
+        Finds the servo pins that changed since the last check, at the time
+        of the last latch access, and checks each finished pulse and frame.
+        A pulse is checked against the pose that was swapped in at the end
+        of the frame before it.
+==============================================================================*/
+static void simEdges(void) {
+    unsigned char cRose, cFell;
+    double fWidth, fWant, fErr;
+    int nPos;
+
+    for (unsigned char ch = 0; ch < cChecked; ch++) {
+        unsigned char cNow = asServoChannel[ch].cPort == SERVO_PORT_C ? cLatC : cLatB;
+        unsigned char cWas = asServoChannel[ch].cPort == SERVO_PORT_C ? cSeenC : cSeenB;
+
+        cRose = cNow & ~cWas & asServoChannel[ch].cMask;
+        cFell = ~cNow & cWas & asServoChannel[ch].cMask;
+        if (cRose) {
+            alRise[ch] = lPortCycle;
+        }
+        if (!cFell) {
+            continue;
+        }
+        fWidth = (double) (lPortCycle - alRise[ch]) / SIM_CYCLES_PER_US;
+        nPos = anPose[ch] < 0 ? 0 : anPose[ch] > SERVO_FINE_MAX ? SERVO_FINE_MAX : anPose[ch]; // As servoPulseTicks()
+        fWant = asServoTrim[ch].nMaxUs - (double) (asServoTrim[ch].nMaxUs - asServoTrim[ch].nMinUs)
+                * nPos / SERVO_FINE_MAX;
+        if (!asServoTrim[ch].isReversed) {
+            fWant = asServoTrim[ch].nMinUs + asServoTrim[ch].nMaxUs - fWant;
+        }
+        fErr = fWidth > fWant ? fWidth - fWant : fWant - fWidth;
+        if (isChecking) {
+            pStats->fPulseErr = fErr > pStats->fPulseErr ? fErr : pStats->fPulseErr;
+            pStats->lPulses++;
+        }
+        if (ch != SIM_WATCH) {
+            continue;
+        }
+        if (lStep == 0) {
+            fWatchUs = fWidth;
+        } else if (alRise[ch] > lStep && (fWidth > fWatchUs + SIM_MOVE_US || fWidth < fWatchUs - SIM_MOVE_US)) {
+            if (isChecking) {
+                pStats->lLatencySum += alRise[ch] - lStep;
+                pStats->lLatencyMax = alRise[ch] - lStep > pStats->lLatencyMax
+                        ? alRise[ch] - lStep : pStats->lLatencyMax;
+                pStats->lLatencies++;
+            }
+            lStep = 0;
+            fWatchUs = fWidth;
+        }
+    }
+    cSeenB = cLatB;
+    cSeenC = cLatC;
+}
+
+unsigned char *simPort(unsigned char *port) {
+    simEdges(); // A write from the access before is seen now
+    lCycle += 1;
+    lPortCycle = lCycle;
+    if (isFrameEdge) {
+        simFrame();
+    }
+    return port;
+}
+
+/*==============================================================================
+    SIM BUSY
+        Holds the processor at the current level for cycles, taking the
+        interrupts that may run over it. The time they take is added on.
+==============================================================================*/
+static void simBusy(unsigned long cycles) {
+    unsigned long lEnd = lCycle + cycles, lFrom, lNext;
+
+    for (;;) {
+        lFrom = lCycle;
+        simInterrupts();
+        lEnd += lCycle - lFrom; // Held off while the interrupts ran
+        if (lCycle >= lEnd) {
+            return;
+        }
+        lNext = simNext();
+        lCycle = (lNext > lCycle && lNext < lEnd) ? lNext : lEnd;
+    }
+}
+
+/*==============================================================================
+    SIM TASKS
+        The scheduler's tasks, wrapped once initSched() has been called so
+        that each holds the processor for its estimated time before its C
+        code runs.
+==============================================================================*/
+static unsigned long simTaskCycles(void (*run)(void)) {
+    if (run == servoTask) {
+        return SIM_SERVO_TASK_CYCLES;
+    }
+    if (run == governorTask) {
+        return SIM_GOVERNOR_TASK_CYCLES;
+    }
+    if (run != controlTask || modeSelect) {
+        return SIM_SMALL_TASK_CYCLES;
+    }
+    if (cMode == 0 || cMode == 3) {
+        return SIM_SENSOR_TASK_CYCLES;
+    }
+    return (cMode == 1 || cMode == 2) ? SIM_GESTURE_TASK_CYCLES : SIM_SMALL_TASK_CYCLES;
+}
+
+static void simTask(unsigned char task) {
+    simBusy(simTaskCycles(apSimRun[task]));
+    apSimRun[task]();
+}
+
+static void simTask0(void) { simTask(0); }
+static void simTask1(void) { simTask(1); }
+static void simTask2(void) { simTask(2); }
+static void simTask3(void) { simTask(3); }
+static void simTask4(void) { simTask(4); }
+static void simTask5(void) { simTask(5); }
+static void simTask6(void) { simTask(6); }
+static void simTask7(void) { simTask(7); }
+
+static void (*const apSimTask[SIM_MAX_TASKS])(void) = {
+    simTask0, simTask1, simTask2, simTask3, simTask4, simTask5, simTask6, simTask7
+};
+
+static void simWrapTasks(void) {
+    if (cSchedCount > SIM_MAX_TASKS) {
+        fprintf(stderr, "%u tasks, only %d can be timed\n", cSchedCount, SIM_MAX_TASKS);
+        exit(2);
+    }
+    for (unsigned char i = 0; i < cSchedCount; i++) {
+        apSimRun[i] = pSchedTasks[i].pRun;
+        pSchedTasks[i].pRun = apSimTask[i];
+    }
+    isWrapped = true;
+}
+
+/*==============================================================================
+    SIM INTERRUPTS
+        Takes every interrupt that is flagged, enabled and of a higher
+        priority than the code that is running. The servo ISR swaps in a new
+        programme at the end of a frame, and with it the pose its pulses
+        are checked against.
+==============================================================================*/
+static void simInterrupts(void) {
+    unsigned char cWas = cLevel;
+    unsigned long lCycles;
+    bool isPending, isRx;
+
+    if (!isWrapped && pSchedTasks != NULL) {
+        simWrapTasks();
+    }
+    for (;;) {
+        simOverflows();
+        if (cTmr0If && cTmr0Ie && GIEH && cLevel < 2) {
+            cLevel = 2;
+            lCycle += SIM_ENTRY_CYCLES + (rand() & 1);
+            isFrameEdge = cServoStep == 0;
+            isPending = isServoPending;
+            isr();
+            simEdges(); // The last pulses of the frame end before the swap
+            if (isPending && !isServoPending) { // The queued pose plays from the next frame
+                for (unsigned char i = 0; i < SERVO_CHANNELS; i++) {
+                    anPose[i] = anServoPos[i];
+                }
+            }
+            lCycle += SIM_EXIT_CYCLES;
+            cLevel = cWas;
+        } else if (((TMR2IF && TMR2IE) || (TMR3IF && TMR3IE) || (RC1IF && RC1IE) || (TX1IF && TX1IE))
+                && GIEH && GIEL && cLevel < 1) {
+            cLevel = 1;
+            simBusy(SIM_ENTRY_CYCLES + (rand() & 1)); // The servo ISR may cut into the context save
+            lCycles = SIM_EXIT_CYCLES;
+            lCycles += (TMR2IF && TMR2IE) ? SIM_LOW_CYCLES : 0;
+            lCycles += (TMR3IF && TMR3IE) ? SIM_BEEP_CYCLES : 0;
+            lCycles += (TX1IF && TX1IE) ? SIM_TX_CYCLES : 0;
+            isRx = RC1IF && RC1IE;
+            lCycles += isRx ? SIM_RX_CYCLES : 0;
+            isrLow();
+            if (isRx) {
+                RCSTA1 &= 0b11111101; // remoteRxISR() has toggled CREN, which clears OERR
+            }
+            if (TMR3ON && !TMR3IF && lTmr3Next == 0) {
+                lTmr3Next = lCycle + (65536UL - (TMR3H << 8 | TMR3L)) * SIM_TMR3_PRESCALE;
+            }
+            simBusy(lCycles);
+            cLevel = cWas;
+        } else {
+            return;
+        }
+    }
+}
+
+/*==============================================================================
+    SIM IDLE
+        Nothing to do in the main loop: waits for the next interrupt.
+==============================================================================*/
+void simIdle(void) {
+    lCycle = simNext();
+    simInterrupts();
+}
+
+/*==============================================================================
+    CHRPMINI
+        The EEPROM, flash and reset functions of CHRPMini.c. An EEPROM write
+        runs on for SIM_EEPROM_MS and the next read or write waits for it; a
+        flash erase or write stops the processor.
+==============================================================================*/
+void initOsc(void) {
+}
+
+void initPorts(void) {
+}
+
+void initANA(void) {
+}
+
+bool eepromBusy(void) {
+    simAccess();
+    return lCycle < lEepromDone;
+}
+
+unsigned char eepromRead(unsigned char addr) {
+    while (eepromBusy()) {
+        simBusy(lEepromDone - lCycle);
+    }
+    simBusy(SIM_EEPROM_CYCLES);
+    return acEeprom[addr];
+}
+
+void eepromWrite(unsigned char addr, unsigned char data) {
+    while (eepromBusy()) {
+        simBusy(lEepromDone - lCycle);
+    }
+    simBusy(SIM_EEPROM_CYCLES);
+    acEeprom[addr] = data;
+    lEepromDone = lCycle + SIM_EEPROM_MS * SIM_CYCLES_PER_MS;
+}
+
+unsigned char resetCause(void) {
+    return RESET_POWER;
+}
+
+unsigned char flashRead(unsigned int addr) {
+    if (addr < REC_FLASH_START || addr >= REC_FLASH_END) {
+        return 0xFF;
+    }
+    return acFlash[addr - REC_FLASH_START];
+}
+
+static void simStall(void) {
+    lCycle += SIM_FLASH_CYCLES; // No interrupts, the flags they missed are set once
+    lStalls++;
+}
+
+void flashErase(unsigned int addr) {
+    addr &= ~(FLASHBLOCK - 1);
+    if (addr >= REC_FLASH_START && addr < REC_FLASH_END) {
+        memset(&acFlash[addr - REC_FLASH_START], 0xFF, FLASHBLOCK);
+    }
+    simStall();
+}
+
+void flashWrite(unsigned int addr, const unsigned char *data) {
+    addr &= ~(FLASHBLOCK - 1);
+    if (addr >= REC_FLASH_START && addr < REC_FLASH_END) {
+        memcpy(&acFlash[addr - REC_FLASH_START], data, FLASHBLOCK);
+    }
+    simStall();
+}
+
+/*==============================================================================
+    SIM RUN
+        Runs the interrupts until frames more frames have started.
+==============================================================================*/
+static void simRun(unsigned long frames) {
+    unsigned long lEnd = nServoFrames + frames;
+
+    while (nServoFrames != lEnd) {
+        simIdle();
+    }
+}
+
+static void simReset(void) {
+    for (unsigned char i = 0; i < SIM_ROWS; i++) {
+        memset(&asStats[i], 0, sizeof (asStats[i]));
+        asStats[i].fFrameMin = 1e9;
+    }
+}
+
+static double simFrameErr(const simStats_t *stats) {
+    return stats->fFrameMax - SERVO_FRAME_US > SERVO_FRAME_US - stats->fFrameMin
+            ? stats->fFrameMax - SERVO_FRAME_US : SERVO_FRAME_US - stats->fFrameMin;
+}
+
+/*==============================================================================
+    SIM CHECK
+        Plays a pose in one output mode and prints the frame and pulse
+        width errors. Returns false if either is out of tolerance.
+==============================================================================*/
+static bool simCheck(const char *mode, const char *name, const int *pos, unsigned long frames) {
+    unsigned char acPos[SERVOCOUNT];
+    bool isPass;
+
+    for (unsigned char i = 0; i < SERVOCOUNT; i++) {
+        acPos[i] = (unsigned char) (pos[i] >> SERVO_FINE_FRAC);
+    }
+    for (unsigned char i = SERVOCOUNT; i < SERVO_CHANNELS; i++) {
+        servoSetChannel(i, pos[i]); // Goes out with the pose
+    }
+    servoSetPose(acPos);
+    isChecking = false;
+    simRun(SIM_SETTLE_FRAMES);
+    simReset();
+    isChecking = true;
+    simRun(frames);
+    isChecking = false;
+    isPass = pStats->lFrames != 0 && pStats->lPulses == pStats->lFrames * SERVO_CHANNELS
+            && simFrameErr(pStats) <= SIM_TOLERANCE_US && pStats->fPulseErr <= SIM_TOLERANCE_US;
+    printf("%-10s %-8s %6lu %10.2f %10.2f %6.2f %7.2f  %s\n", mode, name, pStats->lFrames,
+            pStats->fFrameMin, pStats->fFrameMax, simFrameErr(pStats), pStats->fPulseErr,
+            isPass ? "pass" : "FAIL");
+    return isPass;
+}
+
+/*==============================================================================
+    SIM LOAD
+        Reads a trace file into asEvents. Exits with 2 on a bad line.
+==============================================================================*/
+static void simLoad(const char *path) {
+    static const char *apKind[] = {"glove", "press", "vdd", "remote", "pose", "mode", "select", "match", "end"};
+    char acLine[256], *pWord, *pEnd;
+    unsigned int nLine = 0;
+    simEvent_t *pEvent;
+    FILE *pFile = fopen(path, "r");
+
+    if (pFile == NULL) {
+        perror(path);
+        exit(2);
+    }
+    while (fgets(acLine, sizeof (acLine), pFile) != NULL) {
+        nLine++;
+        if ((pEnd = strchr(acLine, '#')) != NULL) {
+            *pEnd = '\0';
+        }
+        if ((pWord = strtok(acLine, " \t\r\n")) == NULL) {
+            continue;
+        }
+        if (nEvents == SIM_MAX_EVENTS) {
+            fprintf(stderr, "%s:%u: more than %d events\n", path, nLine, SIM_MAX_EVENTS);
+            exit(2);
+        }
+        pEvent = &asEvents[nEvents];
+        pEvent->nLine = nLine;
+        pEvent->lMs = strtoul(pWord, &pEnd, 10);
+        pWord = strtok(NULL, " \t\r\n");
+        if (*pEnd != '\0' || pWord == NULL || (nEvents != 0 && pEvent->lMs < asEvents[nEvents - 1].lMs)) {
+            fprintf(stderr, "%s:%u: needs a time, not before the last, and an event\n", path, nLine);
+            exit(2);
+        }
+        if (strcmp(pWord, "expect") == 0 && (pWord = strtok(NULL, " \t\r\n")) == NULL) {
+            pWord = "expect";
+        }
+        for (pEvent->cKind = 0; pEvent->cKind <= SIM_END; pEvent->cKind++) {
+            if (strcmp(pWord, apKind[pEvent->cKind]) == 0) {
+                break;
+            }
+        }
+        for (pEvent->cArgs = 0; (pWord = strtok(NULL, " \t\r\n")) != NULL; pEvent->cArgs++) {
+            if (pEvent->cArgs == SIM_MAX_ARGS) {
+                break;
+            }
+            pEvent->afArg[pEvent->cArgs] = strcmp(pWord, "-") == 0 ? -1 : strtod(pWord, &pEnd);
+            if (strcmp(pWord, "-") != 0 && *pEnd != '\0') {
+                break;
+            }
+        }
+        if (pEvent->cKind > SIM_END || pWord != NULL
+                || (pEvent->cKind == SIM_GLOVE && pEvent->cArgs != SENSORCOUNT)
+                || ((pEvent->cKind == SIM_PRESS || pEvent->cKind == SIM_VDD_EVENT
+                || pEvent->cKind == SIM_EXPECT_MODE || pEvent->cKind == SIM_EXPECT_SELECT
+                || pEvent->cKind == SIM_EXPECT_MATCH) && pEvent->cArgs != 1)
+                || (pEvent->cKind == SIM_REMOTE && pEvent->cArgs < 1)
+                || (pEvent->cKind == SIM_EXPECT_POSE && pEvent->cArgs != SERVOCOUNT
+                && pEvent->cArgs != SERVOCOUNT + 1)
+                || (pEvent->cKind == SIM_END && pEvent->cArgs != 0)) {
+            fprintf(stderr, "%s:%u: bad event\n", path, nLine);
+            exit(2);
+        }
+        nEvents++;
+    }
+    fclose(pFile);
+}
+
+/*==============================================================================
+    SIM REMOTE
+        Queues a packet for the receiver: sync bytes, type, payload and the
+        checksum that makes the type to the end sum to 0. Bytes follow each
+        other at the baud rate.
+==============================================================================*/
+static void simRemoteByte(unsigned char data) {
+    if ((nRxHead + 1) % SIM_RX_QUEUE == nRxTail) {
+        fprintf(stderr, "remote queue full\n");
+        exit(2);
+    }
+    if (nRxHead == nRxTail && lRxNext < lCycle + simByteCycles()) {
+        lRxNext = lCycle + simByteCycles();
+    }
+    acRxQueue[nRxHead] = data;
+    nRxHead = (nRxHead + 1) % SIM_RX_QUEUE;
+}
+
+static void simRemote(const simEvent_t *event) {
+    unsigned char cSum = 0;
+
+    simRemoteByte(REMOTE_SYNC1);
+    simRemoteByte(REMOTE_SYNC2);
+    for (unsigned char i = 0; i < event->cArgs; i++) {
+        simRemoteByte((unsigned char) event->afArg[i]);
+        cSum += (unsigned char) event->afArg[i];
+    }
+    simRemoteByte((unsigned char) -cSum);
+    lRxBytes += event->cArgs + 3;
+}
+
+/*==============================================================================
+    SIM EXPECT
+        Checks an expect event and prints it if it fails.
+==============================================================================*/
+static void simExpect(const simEvent_t *event) {
+    double fTol = event->cArgs > SERVOCOUNT ? event->afArg[SERVOCOUNT] : SIM_POSE_TOL;
+    bool isPass = true;
+
+    nExpects++;
+    if (event->cKind == SIM_EXPECT_MODE) {
+        isPass = cMode == event->afArg[0];
+    } else if (event->cKind == SIM_EXPECT_SELECT) {
+        isPass = modeSelect == (event->afArg[0] != 0);
+    } else if (event->cKind == SIM_EXPECT_MATCH) {
+        isPass = cClassMatch == (event->afArg[0] < 0 ? CLASS_NONE : event->afArg[0]);
+    } else {
+        for (unsigned char i = 0; i < SERVOCOUNT; i++) {
+            if (event->afArg[i] >= 0 && (arcServoPos[i] > event->afArg[i] + fTol
+                    || arcServoPos[i] < event->afArg[i] - fTol)) {
+                isPass = false;
+            }
+        }
+    }
+    if (isPass) {
+        return;
+    }
+    nExpectsFailed++;
+    printf("line %u, %lums: expected", event->nLine, event->lMs);
+    for (unsigned char i = 0; i < event->cArgs; i++) {
+        printf(event->afArg[i] < 0 ? " -" : " %g", event->afArg[i]);
+    }
+    printf(", got pose %u %u %u %u %u, mode %u%s, match %d\n", arcServoPos[0], arcServoPos[1], arcServoPos[2],
+            arcServoPos[3], arcServoPos[4], cMode, modeSelect ? " (select)" : "",
+            cClassMatch == CLASS_NONE ? -1 : cClassMatch);
+}
+
+/*==============================================================================
+    SIM REPORT
+        Prints the report of the trace run and exits, with 1 if any frame
+        or pulse was out of tolerance, millis() had drifted or an expect
+        failed.
+==============================================================================*/
+static void simReport(void) {
+    static const char *apRow[SIM_ROWS] = {"0 glove", "1 gesture", "2 come here", "3 record", "4 playback",
+        "5 remote", "select"};
+    unsigned long lMs = lCycle / SIM_CYCLES_PER_MS;
+    short nDrift = (short) (nTickMs - (unsigned int) lMs);
+    bool isPass = nExpectsFailed == 0 && nDrift <= SIM_TICK_MS && nDrift >= -SIM_TICK_MS;
+    simStats_t *pRow;
+
+    printf("row          frames    mean us  jitter   pulse adc us  latency ms max\n");
+    for (unsigned char r = 0; r < SIM_ROWS; r++) {
+        pRow = &asStats[r];
+        if (pRow->lFrames == 0) {
+            continue;
+        }
+        if (simFrameErr(pRow) > SIM_TOLERANCE_US || pRow->fPulseErr > SIM_TOLERANCE_US + SIM_MERGE_US) {
+            isPass = false;
+        }
+        printf("%-12s %6lu %9.2f %7.2f %7.2f %6.1f", apRow[r], pRow->lFrames, pRow->fFrameSum / pRow->lFrames,
+                pRow->fFrameMax - pRow->fFrameMin, pRow->fPulseErr, (double) pRow->lAdcLate / SIM_CYCLES_PER_US);
+        if (pRow->lLatencies != 0) {
+            printf(" %8.1f %6.1f", (double) pRow->lLatencySum / pRow->lLatencies / SIM_CYCLES_PER_MS,
+                    (double) pRow->lLatencyMax / SIM_CYCLES_PER_MS);
+        } else {
+            printf(" %8s %6s", "-", "-");
+        }
+        printf("  %s\n", simFrameErr(pRow) <= SIM_TOLERANCE_US
+                && pRow->fPulseErr <= SIM_TOLERANCE_US + SIM_MERGE_US ? "pass" : "FAIL");
+    }
+    printf("tick      %lums simulated, millis() %+dms\n", lMs, nDrift);
+    printf("flash     %lu erases and writes, %lums stopped\n", lStalls,
+            lStalls * SIM_FLASH_CYCLES / SIM_CYCLES_PER_MS);
+    printf("telemetry %lu frames sent, %u dropped\n", lTxBytes / TELEM_FRAME_SIZE, nTelemDropped);
+    printf("remote    %lu bytes received, %lu overruns\n", lRxBytes, lRxOverruns);
+    printf("expects   %u of %u passed\n", nExpects - nExpectsFailed, nExpects);
+    printf("%s\n", isPass ? "all passed" : "FAILED");
+    if (pCapture != NULL) {
+        fclose(pCapture); // The last byte is left out, it may be half a frame anyway
+    }
+    exit(isPass ? 0 : 1);
+}
+
+/*==============================================================================
+    SIM EVENTS
+        Plays the trace events that are due. A glove move of the watched
+        finger and an S1 release start a latency measurement.
+==============================================================================*/
+static void simEvents(void) {
+    const simEvent_t *pEvent;
+    double fBend;
+
+    isChecking = lCycle >= SIM_BOOT_MS * SIM_CYCLES_PER_MS;
+    if (lStep != 0 && lCycle - lStep > SIM_LATENCY_MS * SIM_CYCLES_PER_MS) {
+        lStep = 0; // The finger did not move, eg. the mode ignores the glove
+    }
+    if (lRelease != 0 && lCycle >= lRelease * SIM_CYCLES_PER_MS) {
+        PORTEbits.RE3 = 1;
+        lRelease = 0;
+        lStep = lStep != 0 ? lStep : lCycle;
+    }
+    while (nEvent < nEvents && lCycle >= asEvents[nEvent].lMs * SIM_CYCLES_PER_MS) {
+        pEvent = &asEvents[nEvent++];
+        switch (pEvent->cKind) {
+            case SIM_GLOVE:
+                for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+                    fBend = SIM_STRAIGHT + (SIM_BENT - SIM_STRAIGHT) * pEvent->afArg[i];
+                    fBend = SENSOR_INVERT ? 1 - fBend : fBend; // Top half of the divider
+                    if (i == SIM_WATCH && fBend != afGlove[i] && lStep == 0) {
+                        lStep = lCycle;
+                    }
+                    afGlove[i] = fBend;
+                }
+                break;
+            case SIM_PRESS:
+                PORTEbits.RE3 = 0;
+                lRelease = pEvent->lMs + (unsigned long) pEvent->afArg[0];
+                break;
+            case SIM_VDD_EVENT:
+                fVdd = pEvent->afArg[0];
+                break;
+            case SIM_REMOTE:
+                simRemote(pEvent);
+                break;
+            case SIM_END:
+                simReport();
+                break;
+            default:
+                simExpect(pEvent);
+                break;
+        }
+    }
+    if (nEvent == nEvents && lRelease == 0) {
+        simReport(); // No end event
+    }
+}
+
+/*==============================================================================
+    SIM HAND
+        Powers the hand up with the trace loaded and runs Hand.c's main(),
+        which never returns: the trace's end event prints the report and
+        exits.
+==============================================================================*/
+static void simHand(const char *path) {
+    simLoad(path);
+    cTmr0Ie = 0; // Power up
+    GIEH = 0;
+    GIEL = 0;
+    T2CON = 0;
+    lLastFrame = 0;
+    lCycle = 0;
+    lTmrStart = 0;
+    nTmrStart = 0;
+    lOverflow = 65536UL * SIM_TMR0_PRESCALE;
+    lTmr2Next = 0;
+    TX1IF = 1;
+    PORTEbits.RE3 = 1; // S1 up
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        afGlove[i] = SENSOR_INVERT ? 1 - SIM_STRAIGHT : SIM_STRAIGHT;
+    }
+    memset(acEeprom, 0xFF, sizeof (acEeprom));
+    memset(acFlash, 0xFF, sizeof (acFlash));
+    simReset();
+    cChecked = SERVOCOUNT; // Channels after the fingers can move before their pose is queued
+    isChecking = false;
+    isHand = true;
+    printf("\n%s, %s output\n", path, SERVO_OUTPUT == SERVO_SEQUENTIAL ? "sequential"
+            : SERVO_OUTPUT == SERVO_PARALLEL ? "parallel" : "grouped");
+    handMain();
+}
+
+int main(int argc, char **argv) {
+    static const char *apMode[] = {"sequential", "parallel", "grouped"};
+    unsigned long lFramesToRun = (argc > 2) ? strtoul(argv[2], NULL, 10) : 200;
+    int anPos[SERVO_CHANNELS];
+    bool isPass = true;
+
+    srand(1);
+    lOverflow = 65536UL * SIM_TMR0_PRESCALE;
+    memset(acEeprom, 0xFF, sizeof (acEeprom)); // Erased, so the default trims are used
+    cChecked = SERVO_CHANNELS;
+    GIEH = 1;
+    initServos();
+    printf("%d channels, trims %u-%uus, tolerance %.1fus\n", SERVO_CHANNELS, SERVO_MIN_US, SERVO_MAX_US,
+            SIM_TOLERANCE_US);
+    printf("mode       pose     frames  frame min  frame max    err  pulse err\n");
+    for (unsigned char mode = SERVO_SEQUENTIAL; mode <= SERVO_GROUPED; mode++) {
+        servoSetMode(mode, SERVO_FRAME_US);
+        for (unsigned char i = 0; i < SERVO_CHANNELS; i++) {
+            anPos[i] = 0;
+        }
+        isPass &= simCheck(apMode[mode], "all 0", anPos, lFramesToRun);
+        for (unsigned char i = 0; i < SERVO_CHANNELS; i++) {
+            anPos[i] = 255 << SERVO_FINE_FRAC;
+        }
+        isPass &= simCheck(apMode[mode], "all 255", anPos, lFramesToRun);
+        for (unsigned char i = 0; i < SERVO_CHANNELS; i++) {
+            anPos[i] = ((i * 67 + 3) % 256) << SERVO_FINE_FRAC; // No two closer than SERVO_SPIN_TICKS
+        }
+        isPass &= simCheck(apMode[mode], "mixed", anPos, lFramesToRun);
+    }
+    if (!isPass) {
+        printf("FAILED\n");
+        return 1;
+    }
+    if (argc > 3 && (pCapture = fopen(argv[3], "wb")) == NULL) {
+        perror(argv[3]);
+        return 1;
+    }
+    if (argc > 1) {
+        simHand(argv[1]);
+    }
+    printf("all passed\n");
+    return 0;
+}
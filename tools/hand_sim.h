@@ -0,0 +1,90 @@
+/*==============================================================================
+    Hardware access block of the hand simulation (hand_sim.c). Built with
+    -DCHRP_HOST='"hand_sim.h"', CHRPMini.h includes this in place of its own
+    block, so every register the firmware touches is either a variable here
+    or a call into the simulator, which counts the time it takes and takes
+    interrupts. The whole firmware is built this way, Hand.c included: its
+    main() becomes handMain(), which the simulator starts, and its ISRs are
+    plain functions the simulator calls when their flags are set.
+==============================================================================*/
+
+#define interrupt                       // isr() and isrLow() are called by the simulator
+#define low_priority
+#define main                handMain    // Hand.c's main(), started by the simulator
+#define SLEEP()             simIdle()   // Idle until the next interrupt
+#define NOP()               ((void) 0)
+
+typedef struct {
+    unsigned RA0 : 1, RA1 : 1, RA2 : 1, RA3 : 1, RA4 : 1, RA5 : 1, RA6 : 1, RA7 : 1;
+} simPortA_t;
+typedef struct {
+    unsigned LATA0 : 1, LATA1 : 1, LATA2 : 1, LATA3 : 1, LATA4 : 1, LATA5 : 1, LATA6 : 1, LATA7 : 1;
+} simLatA_t;
+typedef struct {
+    unsigned RB0 : 1, RB1 : 1, RB2 : 1, RB3 : 1, RB4 : 1, RB5 : 1, RB6 : 1, RB7 : 1;
+} simPortB_t;
+typedef struct {
+    unsigned LATB0 : 1, LATB1 : 1, LATB2 : 1, LATB3 : 1, LATB4 : 1, LATB5 : 1, LATB6 : 1, LATB7 : 1;
+} simLatB_t;
+typedef struct {
+    unsigned RC0 : 1, RC1 : 1, RC2 : 1, RC3 : 1, RC4 : 1, RC5 : 1, RC6 : 1, RC7 : 1;
+} simPortC_t;
+typedef struct {
+    unsigned LATC0 : 1, LATC1 : 1, LATC2 : 1, LATC3 : 1, LATC4 : 1, LATC5 : 1, LATC6 : 1, LATC7 : 1;
+} simLatC_t;
+typedef struct {
+    unsigned RE0 : 1, RE1 : 1, RE2 : 1, RE3 : 1;
+} simPortE_t;
+//Pin registers for the pin names of CHRPMini.h (S1 is PORTEbits.RE3)
+
+extern simPortA_t PORTAbits;
+extern simLatA_t LATAbits;
+extern simPortB_t PORTBbits;
+extern simLatB_t LATBbits;
+extern simPortC_t PORTCbits;
+extern simLatC_t LATCbits;
+extern simPortE_t PORTEbits;
+extern unsigned char cLatB, cLatC, cTmr0Ie;
+//Servo port latches and TMR0 interrupt enable
+extern unsigned char ADCON0, ADCON1, ADCON2, ADRESH, ADRESL, VREFCON0;
+extern unsigned char PR2, TMR2, T2CON, TMR2IP, TMR2IF, TMR2IE, ADON;
+//A-D converter and TMR2, for Sensors.c and Tick.c
+extern unsigned char T3CON, TMR3H, TMR3L, TMR3ON, TMR3IP, TMR3IF, TMR3IE;
+//TMR3, for Beeper.c
+extern unsigned char T1CON, cTmr1High;
+//TMR1, for Profile.c
+extern unsigned char SPBRGH1, SPBRG1, BAUDCON1, TXSTA1, RCSTA1;
+extern unsigned char TX1IP, TX1IE, TX1IF, RC1IP, RC1IE, RC1IF;
+//EUSART, for Telemetry.c and Remote.c
+extern unsigned char IPEN, GIEH, GIEL, IDLEN;
+//Interrupt priorities and enables, Idle mode
+
+int handMain(void); // Hand.c's main().
+unsigned long simTimerRead(void); // TMR0, after the access time.
+void simTimerWrite(unsigned int n); // Load TMR0, after the reload sum and access time.
+unsigned char *simTimerFlag(void); // TMR0 overflow flag.
+unsigned char *simPort(unsigned char *port); // A servo latch, timed to the cycle.
+void simAccess(void); // Count one register access.
+void simAdcStart(void); // Start a conversion of the selected channel.
+unsigned int simAdcResult(void); // Result of the last conversion, 10 bits.
+unsigned char simTimer1Low(void); // TMR1L, latches TMR1H into cTmr1High.
+unsigned char *simTxReg(void); // TXREG1, sends the byte written to it.
+unsigned char simRxReg(void); // RCREG1, the oldest received byte.
+void simIdle(void); // Idle mode, wait for the next interrupt.
+
+#define SERVOPORT           (*simPort(&cLatB))
+#define SERVOPORT2          (*simPort(&cLatC))
+#define SERVOTIMERREAD(n)   ((n) = (unsigned int) simTimerRead())
+#define SERVOTIMERWRITE(n)  simTimerWrite(n)
+#define SERVOTIMERIF        (*simTimerFlag())
+#define SERVOTIMERIE        cTmr0Ie
+#define ADCRESULT           ((unsigned char) (simAdcResult() >> 2))
+#define ADCRESULT10()       simAdcResult()
+#define ADCSELECT(chan)     (simAccess(), ADCON0 = (ADCON0 & 0b10000011) | (chan))
+#define ADCREFERENCE(ref)   (simAccess(), ADCON1 = (ref))
+#define ADCSTART()          simAdcStart()
+#define ISRWAIT()           simIdle()
+#define TMR1L               simTimer1Low()
+#define TMR1H               cTmr1High
+#define TXREG1              (*simTxReg())
+#define RCREG1              simRxReg()
@@ -0,0 +1,219 @@
+/*==============================================================================
+    Remote peer for Linux. Drives the hand over the remote pose channel and
+    measures how long each pose takes to reach the servos.
+
+    Build:  gcc -O2 -o remote_peer remote_peer.c
+    Use:    ./remote_peer /dev/ttyUSB0 [poses per second] [seconds]
+            ./remote_peer /dev/ttyUSB0 mode <n>
+            ./remote_peer /dev/ttyUSB0 gesture <n>
+            ./remote_peer /dev/ttyUSB0 trim <servo> <min us> <max us> <reverse> [store]
+            ./remote_peer /dev/ttyUSB0 channel <n> <position>
+
+    With no command the fingers sweep open and closed, one after the other,
+    at 50 poses per second for 10 seconds. Each pose carries the low 16 bits
+    of a millisecond clock. The hand echoes the stamp in its telemetry frames
+    once the pose has been sent to the servos, so the time from sending a
+    pose to seeing its echo is the round trip: serial out, up to one servo
+    frame of waiting, and the telemetry frame back. The packet format is in
+    Remote.h and the telemetry format in Telemetry.h.
+
+    The trim command sets one servo's endpoint pulse widths (servo 0 is the
+    thumb). Send a pose or a gesture to see the result, and add "store" once
+    the trims are right to keep them in the hand's EEPROM.
+
+    The channel command moves a servo after the fingers (channel 5 is the
+    wrist of the wrist variant) to a position from 0 to 255.
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+
+#include "../Remote.h"
+#include "../Telemetry.h"
+
+#define MAX_SAMPLES         100000
+
+static unsigned int anLatency[MAX_SAMPLES];
+
+/*==============================================================================
+    OPEN PORT
+        Opens a serial port raw at TELEM_BAUD for reading and writing.
+==============================================================================*/
+static int openPort(const char *path) {
+    struct termios tio;
+    int fd;
+
+    fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror(path);
+        exit(1);
+    }
+    tcgetattr(fd, &tio);
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B500000);
+    cfsetospeed(&tio, B500000);
+    tcsetattr(fd, TCSANOW, &tio);
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+/*==============================================================================
+    NOW MS
+        Milliseconds from a monotonic clock.
+==============================================================================*/
+static unsigned long nowMs(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*==============================================================================
+    SEND PACKET
+        Adds the sync bytes and checksum to a type and payload and sends it.
+==============================================================================*/
+static void sendPacket(int fd, unsigned char type, const unsigned char *payload, int length) {
+    unsigned char packet[3 + REMOTE_MAX_PAYLOAD + 1], cSum = type;
+
+    packet[0] = REMOTE_SYNC1;
+    packet[1] = REMOTE_SYNC2;
+    packet[2] = type;
+    for (int i = 0; i < length; i++) {
+        packet[3 + i] = payload[i];
+        cSum += payload[i];
+    }
+    packet[3 + length] = (unsigned char) -cSum;
+    if (write(fd, packet, 4 + length) != 4 + length) {
+        perror("write");
+        exit(1);
+    }
+}
+
+/*==============================================================================
+    SWEEP POSE
+        Closes and opens each finger in turn, one second per finger.
+==============================================================================*/
+static void sweepPose(unsigned long ms, unsigned char *pose) {
+    unsigned int nPhase = ms % 1000, cFinger = (ms / 1000) % 5;
+
+    memset(pose, 0, 5);
+    pose[cFinger] = (nPhase < 500) ? nPhase * 255 / 500 : (999 - nPhase) * 255 / 500;
+}
+
+static int compare(const void *a, const void *b) {
+    return (int) *(const unsigned int *) a - (int) *(const unsigned int *) b;
+}
+
+int main(int argc, char **argv) {
+    unsigned char payload[REMOTE_MAX_PAYLOAD], frame[TELEM_FRAME_SIZE], c, cSum;
+    unsigned int nRate = 50, nSeconds = 10, nEcho, nLastEcho = 0, nMinUs, nMaxUs;
+    unsigned long lStart, lNext, lNow, lSent = 0, lTotal = 0;
+    int fd, nHave = 0, nSamples = 0;
+    struct pollfd pfd;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <serial port> [rate seconds | mode n | gesture n | trim servo min max reverse [store] | channel n pos]\n", argv[0]);
+        return 1;
+    }
+    fd = openPort(argv[1]);
+    if (argc == 4 && (strcmp(argv[2], "mode") == 0 || strcmp(argv[2], "gesture") == 0)) {
+        payload[0] = (unsigned char) atoi(argv[3]);
+        sendPacket(fd, argv[2][0] == 'm' ? REMOTE_MODE : REMOTE_GESTURE, payload, 1);
+        tcdrain(fd);
+        return 0;
+    }
+    if ((argc == 7 || argc == 8) && strcmp(argv[2], "trim") == 0) {
+        nMinUs = (unsigned int) atoi(argv[4]);
+        nMaxUs = (unsigned int) atoi(argv[5]);
+        payload[0] = (unsigned char) atoi(argv[3]) | (argc == 8 ? REMOTE_TRIM_STORE : 0);
+        payload[1] = (unsigned char) nMinUs;
+        payload[2] = (unsigned char) (nMinUs >> 8);
+        payload[3] = (unsigned char) nMaxUs;
+        payload[4] = (unsigned char) (nMaxUs >> 8);
+        payload[5] = (unsigned char) (atoi(argv[6]) != 0);
+        sendPacket(fd, REMOTE_TRIM, payload, 6);
+        tcdrain(fd);
+        return 0;
+    }
+    if (argc == 5 && strcmp(argv[2], "channel") == 0) {
+        payload[0] = (unsigned char) atoi(argv[3]);
+        payload[1] = (unsigned char) atoi(argv[4]);
+        sendPacket(fd, REMOTE_CHANNEL, payload, 2);
+        tcdrain(fd);
+        return 0;
+    }
+    if (argc > 2) {
+        nRate = atoi(argv[2]);
+    }
+    if (argc > 3) {
+        nSeconds = atoi(argv[3]);
+    }
+    if (nRate == 0 || nRate > 1000) {
+        fprintf(stderr, "rate must be 1 to 1000 poses per second\n");
+        return 1;
+    }
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    lStart = nowMs();
+    lNext = lStart;
+    while ((lNow = nowMs()) - lStart < nSeconds * 1000UL) {
+        if (lNow >= lNext) {
+            sweepPose(lNow - lStart, payload);
+            payload[5] = (unsigned char) lNow; // Stamp, low byte first
+            payload[6] = (unsigned char) (lNow >> 8);
+            sendPacket(fd, REMOTE_POSE, payload, 7);
+            lSent++;
+            lNext += 1000 / nRate;
+        }
+        if (poll(&pfd, 1, 1) <= 0) {
+            continue;
+        }
+        while (read(fd, &c, 1) == 1) {
+            if (nHave == 0 && c != TELEM_SYNC1) {
+                break; // Hunt for the start of a frame
+            }
+            if (nHave == 1 && c != TELEM_SYNC2) {
+                nHave = (c == TELEM_SYNC1) ? 1 : 0;
+                break;
+            }
+            frame[nHave++] = c;
+            if (nHave < TELEM_FRAME_SIZE) {
+                continue;
+            }
+            nHave = 0;
+            cSum = 0;
+            for (int i = 2; i < TELEM_FRAME_SIZE; i++) {
+                cSum += frame[i];
+            }
+            nEcho = frame[20] | (frame[21] << 8);
+            if (cSum != 0 || nEcho == nLastEcho) {
+                break;
+            }
+            nLastEcho = nEcho; // A new pose reached the servos
+            if (nSamples < MAX_SAMPLES) {
+                anLatency[nSamples] = (unsigned int) ((nowMs() - nEcho) & 0xFFFF);
+                lTotal += anLatency[nSamples++];
+            }
+            break;
+        }
+    }
+
+    if (nSamples == 0) {
+        fprintf(stderr, "%lu poses sent, no echoes seen\n", lSent);
+        return 1;
+    }
+    qsort(anLatency, nSamples, sizeof(anLatency[0]), compare);
+    printf("%lu poses sent, %d echoed\n", lSent, nSamples);
+    printf("round trip ms: min %u  mean %.1f  median %u  99%% %u  max %u\n",
+            anLatency[0], (double) lTotal / nSamples, anLatency[nSamples / 2],
+            anLatency[nSamples * 99 / 100], anLatency[nSamples - 1]);
+    return 0;
+}
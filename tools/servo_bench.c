@@ -0,0 +1,204 @@
+/*==============================================================================
+    Servo bank benchmark. Builds the firmware's edge programmes (Servo.c)
+    for a bank of SERVO_CHANNELS servos and reports the frame timing of
+    each output mode.
+
+    Build:  for n in 5 8 12 16; do
+                gcc -O2 -I. -DSERVO_CHANNELS=$n -DSERVO_PORTC=1 \
+                    -o servo_bench servo_bench.c && ./servo_bench
+            done
+    Use:    ./servo_bench [poses]
+
+    Servo.c is compiled in with stand-ins for the registers it touches.
+    Channels 0-7 are put on LATB and 8-15 on LATC. Each mode is run over
+    random poses (1000 by default) plus the worst case of every pulse at its
+    widest, with the default trims, with the widest trims allowed and with
+    trims out of range at both ends, which servoSetTrim() pins. Every
+    frame is played back edge by edge to check that each channel got one
+    pulse of the right width, within its trims, and that the frame is
+    exactly 20ms long.
+
+    Columns:
+        group   servos started together
+        steps   TMR0 interrupts per frame
+        busy    time from the frame start to the last pulse edge (worst case)
+        gap     pulse free time left in the frame (worst case)
+        short   steps spun inside the ISR (< SERVO_SPIN_TICKS), per frame
+        isr     estimated ISR time per frame, at BENCH_STEP_US per step
+        err     largest pulse width error from merged edges
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+unsigned char LATB, LATC, TMR0L, TMR0H, TMR0IF, TMR0IE;
+//Register stand-ins for Servo.c
+
+#define BENCH_STEP_US       5           // ISR entry, step and exit, ~60 instruction cycles
+
+#define BC(i) {(i) < 8 ? SERVO_PORT_B : SERVO_PORT_C, 1 << ((i) & 7), SERVO_NO_SENSOR}
+#if SERVO_CHANNELS == 5
+#define SERVO_CHANNEL_TABLE {BC(0), BC(1), BC(2), BC(3), BC(4)}
+#elif SERVO_CHANNELS == 8
+#define SERVO_CHANNEL_TABLE {BC(0), BC(1), BC(2), BC(3), BC(4), BC(5), BC(6), BC(7)}
+#elif SERVO_CHANNELS == 12
+#define SERVO_CHANNEL_TABLE {BC(0), BC(1), BC(2), BC(3), BC(4), BC(5), BC(6), BC(7), \
+    BC(8), BC(9), BC(10), BC(11)}
+#elif SERVO_CHANNELS == 16
+#define SERVO_CHANNEL_TABLE {BC(0), BC(1), BC(2), BC(3), BC(4), BC(5), BC(6), BC(7), \
+    BC(8), BC(9), BC(10), BC(11), BC(12), BC(13), BC(14), BC(15)}
+#else
+#error "SERVO_CHANNELS must be 5, 8, 12 or 16"
+#endif
+
+#include "../Servo.c"
+
+typedef struct {
+    unsigned int nSteps, nShort;
+    unsigned int nBusy, nGap;           // Ticks
+    unsigned int nErr;                  // Ticks
+    bool isBad;
+} frame_t;
+
+unsigned char eepromRead(unsigned char addr) {
+    (void) addr;
+    return 0xFF; // Erased, so the default trims are used
+}
+
+void eepromWrite(unsigned char addr, unsigned char data) {
+    (void) addr;
+    (void) data;
+}
+
+/*==============================================================================
+    PLAY FRAME
+        Walks the programme servoUpdate() just wrote, as the ISR would, and
+        times the pulse on every channel.
+==============================================================================*/
+static void playFrame(frame_t *frame) {
+    unsigned char cProg = cServoActive ^ 1, acOn[SERVO_CHANNELS] = {0};
+    unsigned int anRise[SERVO_CHANNELS], nTime = 0, nWidth, nWant, i, ch;
+    servoStep_t *step;
+
+    frame->nSteps = acServoSteps[cProg];
+    frame->nShort = 0;
+    frame->nBusy = 0;
+    frame->nErr = 0;
+    frame->isBad = false;
+    for (i = 0; i < acServoSteps[cProg]; i++) {
+        step = &asServoProg[cProg][i];
+        for (ch = 0; ch < SERVO_CHANNELS; ch++) {
+            unsigned char cSet = asServoChannel[ch].cPort == SERVO_PORT_C ? step->cSetC : step->cSet;
+            unsigned char cClear = asServoChannel[ch].cPort == SERVO_PORT_C ? step->cClearC : step->cClear;
+
+            if (cClear & asServoChannel[ch].cMask) {
+                if (acOn[ch] != 1) {
+                    frame->isBad = true; // Ended a pulse that was not running
+                }
+                acOn[ch] = 2;
+                nWidth = nTime - anRise[ch];
+                if (nWidth + SERVO_MERGE_TICKS < asServoTrim[ch].nMinUs * SERVO_TICKS_PER_US
+                        || nWidth > asServoTrim[ch].nMaxUs * SERVO_TICKS_PER_US + SERVO_MERGE_TICKS) {
+                    frame->isBad = true; // Outside the channel's trims
+                }
+                nWant = servoPulseTicks(ch, anServoPos[ch]);
+                nWidth = nWidth > nWant ? nWidth - nWant : nWant - nWidth;
+                if (nWidth > frame->nErr) {
+                    frame->nErr = nWidth;
+                }
+                frame->nBusy = nTime;
+            }
+            if (cSet & asServoChannel[ch].cMask) {
+                if (acOn[ch] != 0) {
+                    frame->isBad = true; // Second pulse in one frame
+                }
+                acOn[ch] = 1;
+                anRise[ch] = nTime;
+            }
+        }
+        if (step->nTicks < SERVO_SPIN_TICKS) {
+            frame->nShort++;
+        }
+        nTime += step->nTicks;
+    }
+    for (ch = 0; ch < SERVO_CHANNELS; ch++) {
+        if (acOn[ch] != 2) {
+            frame->isBad = true; // Missed a pulse
+        }
+    }
+    if (nTime != nServoFrameTicks) {
+        frame->isBad = true;
+    }
+    frame->nGap = nServoFrameTicks - frame->nBusy;
+}
+
+/*==============================================================================
+    RUN MODE
+        Builds and plays one mode over random poses and the widest pose, and
+        prints the worst of each column.
+==============================================================================*/
+static void runMode(const char *name, unsigned char mode, int poses) {
+    frame_t sFrame, sWorst = {0, 0, 0, 0xFFFF, 0, false};
+    int anPos[SERVOCOUNT];
+
+    servoSetMode(mode, SERVO_FRAME_US);
+    for (int n = 0; n <= poses; n++) {
+        for (unsigned char ch = 0; ch < SERVO_CHANNELS; ch++) {
+            // The last pose puts every channel at its long end
+            int nPos = (n == poses) ? (asServoTrim[ch].isReversed ? 0 : SERVO_FINE_MAX) : rand() % (SERVO_FINE_MAX + 1);
+
+            if (ch < SERVOCOUNT) {
+                anPos[ch] = nPos;
+            } else {
+                servoSetChannel(ch, nPos);
+            }
+        }
+        servoSetPoseFine(anPos);
+        playFrame(&sFrame);
+        sWorst.isBad |= sFrame.isBad;
+        if (sFrame.nSteps > sWorst.nSteps) {
+            sWorst.nSteps = sFrame.nSteps;
+        }
+        if (sFrame.nShort > sWorst.nShort) {
+            sWorst.nShort = sFrame.nShort;
+        }
+        if (sFrame.nBusy > sWorst.nBusy) {
+            sWorst.nBusy = sFrame.nBusy;
+        }
+        if (sFrame.nGap < sWorst.nGap) {
+            sWorst.nGap = sFrame.nGap;
+        }
+        if (sFrame.nErr > sWorst.nErr) {
+            sWorst.nErr = sFrame.nErr;
+        }
+    }
+    printf("%8u %-10s %5u %5u %6.2fms %6.2fms %5u %5uus %5.1fus %s\n", SERVO_CHANNELS, name,
+            cServoGroup, sWorst.nSteps, sWorst.nBusy / 3000.0, sWorst.nGap / 3000.0, sWorst.nShort,
+            sWorst.nSteps * BENCH_STEP_US, sWorst.nErr / 3.0, sWorst.isBad ? "BAD" : "ok");
+}
+
+int main(int argc, char **argv) {
+    int nPoses = (argc > 1) ? atoi(argv[1]) : 1000;
+
+    srand(1);
+    servoLoadTrims();
+    printf("channels mode       group steps     busy      gap short   isr     err\n");
+    printf("default trims, %u-%uus\n", SERVO_MIN_US, SERVO_MAX_US);
+    runMode("sequential", SERVO_SEQUENTIAL, nPoses);
+    runMode("grouped", SERVO_GROUPED, nPoses);
+    runMode("parallel", SERVO_PARALLEL, nPoses);
+    for (unsigned char ch = 0; ch < SERVO_CHANNELS; ch++) {
+        servoSetTrim(ch, SERVO_TRIM_MIN_US, SERVO_TRIM_MAX_US, true);
+    }
+    printf("widest trims, %u-%uus\n", SERVO_TRIM_MIN_US, SERVO_TRIM_MAX_US);
+    runMode("sequential", SERVO_SEQUENTIAL, nPoses);
+    runMode("grouped", SERVO_GROUPED, nPoses);
+    runMode("parallel", SERVO_PARALLEL, nPoses);
+    for (unsigned char ch = 0; ch < SERVO_CHANNELS; ch++) {
+        servoSetTrim(ch, (ch & 1) ? 2700 : 100, (ch & 1) ? 2600 : 200, ch & 2); // Out of range, as a remote peer may send
+    }
+    printf("out of range trims, pinned to %u or %uus\n", SERVO_TRIM_MIN_US, SERVO_TRIM_MAX_US);
+    runMode("grouped", SERVO_GROUPED, nPoses);
+    return 0;
+}
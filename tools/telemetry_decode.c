@@ -0,0 +1,100 @@
+/*==============================================================================
+    Telemetry decoder for Linux. Reads the hand's telemetry stream from a
+    serial port and writes one CSV line per frame.
+
+    Build:  gcc -O2 -o telemetry_decode telemetry_decode.c
+    Use:    ./telemetry_decode /dev/ttyUSB0 > glove.csv
+            ./telemetry_decode - < capture.bin > glove.csv
+
+    The frame format is described in Telemetry.h. Frames with a bad checksum
+    are skipped, and gaps in the sequence number are counted as lost frames.
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+#include "../Telemetry.h"
+
+/*==============================================================================
+    OPEN PORT
+        Opens a serial port raw at TELEM_BAUD, or stdin for "-".
+==============================================================================*/
+static int openPort(const char *path) {
+    struct termios tio;
+    int fd;
+
+    if (strcmp(path, "-") == 0) {
+        return 0;
+    }
+    fd = open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        perror(path);
+        exit(1);
+    }
+    tcgetattr(fd, &tio);
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B500000);
+    cfsetospeed(&tio, B500000);
+    tcsetattr(fd, TCSANOW, &tio);
+    return fd;
+}
+
+int main(int argc, char **argv) {
+    unsigned char frame[TELEM_FRAME_SIZE], cSum, cSeq = 0, c;
+    unsigned long lFrames = 0, lLost = 0, lBad = 0;
+    int fd, nHave = 0, isFirst = 1;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <serial port | ->\n", argv[0]);
+        return 1;
+    }
+    fd = openPort(argv[1]);
+    printf("seq,ms,raw0,raw1,raw2,raw3,raw4,filt0,filt1,filt2,filt3,filt4,"
+            "pos0,pos1,pos2,pos3,pos4,echo,supply_mv,temp,glove0,glove1,glove2,glove3,glove4\n");
+
+    while (read(fd, &c, 1) == 1) {
+        if (nHave == 0 && c != TELEM_SYNC1) {
+            continue; // Hunt for the start of a frame
+        }
+        if (nHave == 1 && c != TELEM_SYNC2) {
+            nHave = (c == TELEM_SYNC1) ? 1 : 0;
+            continue;
+        }
+        frame[nHave++] = c;
+        if (nHave < TELEM_FRAME_SIZE) {
+            continue;
+        }
+        nHave = 0;
+
+        cSum = 0;
+        for (int i = 2; i < TELEM_FRAME_SIZE; i++) {
+            cSum += frame[i];
+        }
+        if (cSum != 0) {
+            lBad++;
+            continue;
+        }
+        if (!isFirst) {
+            lLost += (unsigned char) (frame[2] - cSeq - 1);
+        }
+        isFirst = 0;
+        cSeq = frame[2];
+        lFrames++;
+
+        printf("%u,%u", frame[2], frame[3] | (frame[4] << 8));
+        for (int i = 5; i < 20; i++) {
+            printf(",%u", frame[i]);
+        }
+        printf(",%u,%u,%u", frame[20] | (frame[21] << 8), frame[22] * 20, frame[23]);
+        for (int i = 24; i < 29; i++) {
+            printf(",%u", frame[i]);
+        }
+        printf("\n");
+    }
+    fprintf(stderr, "%lu frames, %lu lost, %lu bad checksums\n", lFrames, lLost, lBad);
+    return 0;
+}
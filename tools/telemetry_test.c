@@ -0,0 +1,279 @@
+/*==============================================================================
+    Telemetry host test. Runs the firmware's frame builder and TX interrupt
+    (Telemetry.c) against a mock EUSART and decodes the bytes that come out
+    of the TX pin.
+
+    Build:  gcc -O2 -Wall -I. -o telemetry_test telemetry_test.c
+    Use:    ./telemetry_test [capture.bin]
+
+    Telemetry.c is compiled in with stand-ins for the EUSART registers. The
+    mock takes each byte written to TXREG1 onto the wire and holds TX1IF low
+    for the 10 bit times it takes to send, at the baud rate initTelemetry()
+    set in SPBRG1. The test steps 1us at a time, calls telemetryTick() every
+    ms, as the low priority ISR does, and telemetryTxISR() whenever TX1IE and
+    TX1IF are both set. The raw, filtered, pose, echo, supply, temperature
+    and glove inputs are set from millis() before each tick, so the decoder can check
+    every field of a frame against its time stamp.
+
+    Rows:
+        link        the TELEM_BAUD link: every frame arrives, back to back
+        corrupt     the link row with one payload byte flipped on the wire:
+                    that frame must fail its checksum and the next be found
+        slow        a 100000 baud link: frames are dropped and the gaps in
+                    the sequence number must add up to nTelemDropped
+
+    Columns:
+        frames      good frames decoded
+        lost        frames missing from the sequence
+        dropped     nTelemDropped
+        bad         sync found but the checksum failed
+        errors      good frames whose length, time or fields were wrong
+
+    A capture of the link row is written to capture.bin if given, for
+    ./telemetry_decode - < capture.bin. Exits 1 if any row fails.
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+unsigned char SPBRGH1, SPBRG1, BAUDCON1, TXSTA1, RCSTA1, TX1IP, TX1IE, TX1IF;
+//Register stand-ins for Telemetry.c
+unsigned char *eusartTx(void);
+#define TXREG1  (*eusartTx())
+//Every write to TXREG1 goes onto the mock wire
+
+#include "../Telemetry.c"
+
+#define TEST_RUN_MS         1000        // Time each row sends frames for
+#define TEST_DRAIN_MS       10          // Time left to finish the last frame
+#define TEST_SLOW_BAUD      100000      // Baud rate of the slow row
+#define TEST_WIRE_SIZE      (TEST_RUN_MS / TELEM_PERIOD_MS * TELEM_FRAME_SIZE + 64)
+#define TEST_CORRUPT_FRAME  100         // Frame whose byte the corrupt row flips
+
+volatile unsigned int nTickMs, nRemoteEcho;
+volatile unsigned char acAdcLatest[SENSORCOUNT], cAdcTemp;
+unsigned char acSensorFiltered[SENSORCOUNT], arcServoPos[SENSORCOUNT], arcGlovePos[SENSORCOUNT], cGovSupply;
+//Stand-ins for the modules Telemetry.c reads
+
+static unsigned long lNowUs, lTxFreeUs, lByteUs;
+//lTxFreeUs is when the byte on the wire has gone, lByteUs the time per byte
+static unsigned char acWire[TEST_WIRE_SIZE];
+static unsigned int nWire;
+//acWire holds the bytes sent, nWire counts them
+
+typedef struct {
+    unsigned int nFrames, nLost, nBad, nErrors;
+} decoded_t;
+
+/*==============================================================================
+    EUSART TX
+        The TXREG1 write: puts the byte on the wire and clears TX1IF until it
+        has been sent.
+==============================================================================*/
+unsigned char *eusartTx(void) {
+    static unsigned char cSpill;
+
+    if (!TX1IF) {
+        fprintf(stderr, "TXREG1 written while full\n");
+        exit(1);
+    }
+    TX1IF = 0;
+    lTxFreeUs = lNowUs + lByteUs;
+    if (nWire == TEST_WIRE_SIZE) {
+        return &cSpill;
+    }
+    return &acWire[nWire++];
+}
+
+/*==============================================================================
+    INPUTS
+        The values every input of a frame stamped ms should hold. Used to set
+        them before each tick and to check the decoded frames.
+==============================================================================*/
+static unsigned char inRaw(unsigned int ms, unsigned char i) {
+    return (unsigned char) (ms * 3 + i * 41);
+}
+
+static unsigned char inFiltered(unsigned int ms, unsigned char i) {
+    return (unsigned char) (ms * 5 + i * 17 + 1);
+}
+
+static unsigned char inPose(unsigned int ms, unsigned char i) {
+    return (unsigned char) (255 - ms - i * 29);
+}
+
+static unsigned char inGlove(unsigned int ms, unsigned char i) {
+    return (unsigned char) (ms * 11 + i * 53 + 7);
+}
+
+static unsigned int inEcho(unsigned int ms) {
+    return (ms * 7 + 0x1234) & 0xFFFF; // 16 bits, as on the PIC
+}
+
+static unsigned char inSupply(unsigned int ms) {
+    return (unsigned char) (200 + (ms >> 4) % 50);
+}
+
+static unsigned char inTemp(unsigned int ms) {
+    return (unsigned char) (ms >> 2);
+}
+
+/*==============================================================================
+    RUN
+        Starts the stream at the given baud rate and sends frames for
+        TEST_RUN_MS, then lets the wire drain.
+==============================================================================*/
+static void run(unsigned long baud) {
+    unsigned long lBrgBaud;
+
+    lNowUs = 0;
+    lTxFreeUs = 0;
+    nWire = 0;
+    nTickMs = 0;
+    TX1IF = 1;
+    initTelemetry(acAdcLatest, acSensorFiltered, arcServoPos, arcGlovePos);
+    lBrgBaud = _XTAL_FREQ / 4 / ((SPBRGH1 << 8 | SPBRG1) + 1UL);
+    if (!(BAUDCON1 & 0b00001000) || !(TXSTA1 & 0b00000100) || lBrgBaud != TELEM_BAUD) {
+        fprintf(stderr, "EUSART set up for %lu baud, not %d\n", lBrgBaud, TELEM_BAUD);
+        exit(1);
+    }
+    lByteUs = 10 * 1000000UL / baud;
+
+    for (; lNowUs < (TEST_RUN_MS + TEST_DRAIN_MS) * 1000UL; lNowUs++) {
+        if (lNowUs % 1000 == 0 && lNowUs < TEST_RUN_MS * 1000UL) {
+            nTickMs++;
+            for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+                acAdcLatest[i] = inRaw(nTickMs, i);
+                acSensorFiltered[i] = inFiltered(nTickMs, i);
+                arcServoPos[i] = inPose(nTickMs, i);
+                arcGlovePos[i] = inGlove(nTickMs, i);
+            }
+            nRemoteEcho = inEcho(nTickMs);
+            cGovSupply = inSupply(nTickMs);
+            cAdcTemp = inTemp(nTickMs);
+            telemetryTick();
+        }
+        if (lNowUs >= lTxFreeUs) {
+            TX1IF = 1;
+        }
+        if (TX1IE && TX1IF) {
+            telemetryTxISR();
+        }
+    }
+}
+
+/*==============================================================================
+    CHECK FRAME
+        Checks the fields of a good frame against its time stamp. Returns
+        false if any is wrong.
+==============================================================================*/
+static bool checkFrame(const unsigned char *frame) {
+    unsigned int nMs = frame[3] | frame[4] << 8;
+
+    for (unsigned char i = 0; i < SENSORCOUNT; i++) {
+        if (frame[5 + i] != inRaw(nMs, i) || frame[10 + i] != inFiltered(nMs, i)
+                || frame[15 + i] != inPose(nMs, i) || frame[24 + i] != inGlove(nMs, i)) {
+            return false;
+        }
+    }
+    return (unsigned int) (frame[20] | frame[21] << 8) == inEcho(nMs) && frame[22] == inSupply(nMs)
+            && frame[23] == inTemp(nMs);
+}
+
+/*==============================================================================
+    DECODE
+        Finds the frames on the wire as telemetry_decode does: hunts for the
+        sync bytes, takes TELEM_FRAME_SIZE bytes and checks the sum, and
+        moves on a byte at a time after a bad one. A good frame must start
+        right where the last one ended, unless a bad one came between, and
+        its time stamp must follow the last by TELEM_PERIOD_MS for each step
+        of the sequence number.
+==============================================================================*/
+static decoded_t decode(void) {
+    decoded_t sResult = {0, 0, 0, 0};
+    unsigned int nPos = 0, nEnd = 0, nLastMs = 0, nLastBad = 0;
+    unsigned char cSum, cGap, cLastSeq = 0;
+
+    while (nPos + TELEM_FRAME_SIZE <= nWire) {
+        if (acWire[nPos] != TELEM_SYNC1 || acWire[nPos + 1] != TELEM_SYNC2) {
+            nPos++;
+            continue;
+        }
+        cSum = 0;
+        for (unsigned char i = 2; i < TELEM_FRAME_SIZE; i++) {
+            cSum += acWire[nPos + i];
+        }
+        if (cSum != 0) {
+            sResult.nBad++;
+            nPos++;
+            continue;
+        }
+        cGap = sResult.nFrames ? (unsigned char) (acWire[nPos + 2] - cLastSeq) : 1;
+        if (sResult.nFrames) {
+            sResult.nLost += (unsigned char) (cGap - 1);
+        }
+        if (!checkFrame(&acWire[nPos]) || (nPos != nEnd && sResult.nBad == nLastBad)
+                || (sResult.nFrames && (unsigned int) ((acWire[nPos + 3] | acWire[nPos + 4] << 8)
+                - nLastMs) != cGap * TELEM_PERIOD_MS)) {
+            sResult.nErrors++;
+        }
+        cLastSeq = acWire[nPos + 2];
+        nLastMs = acWire[nPos + 3] | acWire[nPos + 4] << 8;
+        sResult.nFrames++;
+        nPos += TELEM_FRAME_SIZE;
+        nEnd = nPos;
+        nLastBad = sResult.nBad;
+    }
+    if (nEnd != nWire) {
+        sResult.nErrors++; // Part of a frame left over
+    }
+    return sResult;
+}
+
+static bool report(const char *name, decoded_t result, bool pass) {
+    printf("%-8s %6u %5u %7u %4u %6u  %s\n", name, result.nFrames, result.nLost, nTelemDropped,
+            result.nBad, result.nErrors, pass ? "pass" : "FAIL");
+    return pass;
+}
+
+int main(int argc, char **argv) {
+    const unsigned int nSent = TEST_RUN_MS / TELEM_PERIOD_MS;
+    unsigned int nCorrupt;
+    decoded_t sResult;
+    bool isPass = true;
+    FILE *pCapture;
+
+    printf("%u frames of %d bytes at %dms, %d baud\n", nSent, TELEM_FRAME_SIZE, TELEM_PERIOD_MS,
+            TELEM_BAUD);
+    printf("row      frames  lost dropped  bad errors\n");
+
+    run(TELEM_BAUD);
+    sResult = decode();
+    isPass &= report("link", sResult, sResult.nFrames == nSent && sResult.nLost == 0
+            && nTelemDropped == 0 && sResult.nBad == 0 && sResult.nErrors == 0
+            && nWire == nSent * TELEM_FRAME_SIZE);
+    if (argc > 1) {
+        pCapture = fopen(argv[1], "wb");
+        if (pCapture == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+        fwrite(acWire, 1, nWire, pCapture);
+        fclose(pCapture);
+    }
+
+    nCorrupt = TEST_CORRUPT_FRAME * TELEM_FRAME_SIZE + 12;
+    acWire[nCorrupt] ^= 0x10;
+    sResult = decode();
+    isPass &= report("corrupt", sResult, sResult.nFrames == nSent - 1 && sResult.nLost == 1
+            && sResult.nBad >= 1 && sResult.nErrors == 0);
+
+    run(TEST_SLOW_BAUD);
+    sResult = decode();
+    isPass &= report("slow", sResult, nTelemDropped > 0 && sResult.nLost == nTelemDropped
+            && sResult.nFrames + nTelemDropped == nSent && sResult.nBad == 0
+            && sResult.nErrors == 0);
+
+    return isPass ? 0 : 1;
+}
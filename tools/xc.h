@@ -0,0 +1,4 @@
+/*==============================================================================
+    Host stand-in for the XC8 compiler header. Lets the host tools build the
+    firmware modules that are plain C (no SFRs), eg. Classify.c.
+==============================================================================*/
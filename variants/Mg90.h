@@ -0,0 +1,37 @@
+/*==============================================================================
+    MG90 variant. MG90S metal gear servos and high side flex sensors.
+==============================================================================*/
+
+// MG90S servos mounted the other way round, so position 0 is the short
+// pulse, over a wider 500-2400us range. The flex sensors are wired as the
+// top half of their voltage dividers, so a bent finger reads high instead of
+// low and the samples are inverted in the A-D ISR before anything else sees
+// them. The median filter is used so that a single noisy sample never
+// reaches the servos. The pose rules (Constrain.h) censor the middle finger
+// when the glove is followed. In every mode that follows the glove or the
+// remote peer they also keep the threads of neighbouring fingers from
+// crossing, the thumb and index tips apart and the thumb short of its end
+// stop. The built in gestures are known to be safe and are left alone.
+
+#define SERVO_MIN_US        500
+#define SERVO_MAX_US        2400
+#define SERVO_REVERSED      0
+
+#define SENSOR_INVERT       1
+
+#define FILTERTHUMB         FILTER_MEDIAN
+#define FILTERINDEX         FILTER_MEDIAN
+#define FILTERMIDDLE        FILTER_MEDIAN
+#define FILTERRING          FILTER_MEDIAN
+#define FILTERPINKIE        FILTER_MEDIAN
+
+#define VARIANT_RULE_MODES  (CONSTRAIN_MODE(0) | CONSTRAIN_MODE(3) | CONSTRAIN_MODE(4) \
+                            | CONSTRAIN_MODE(5)) // Glove, recording, playback, remote
+
+#define CONSTRAIN_RULES { \
+    {RULE_ALONE, 2, 0, 0, 0, CONSTRAIN_MODE(0)}, \
+    {RULE_GAP, 1, 2, 192, 0, VARIANT_RULE_MODES}, \
+    {RULE_GAP, 2, 3, 192, 0, VARIANT_RULE_MODES}, \
+    {RULE_GAP, 3, 4, 192, 0, VARIANT_RULE_MODES}, \
+    {RULE_ZONE, 0, 1, 200, 224, VARIANT_RULE_MODES}, \
+    {RULE_RANGE, 0, 0, 0, 230, VARIANT_RULE_MODES | CONSTRAIN_SELECT}}
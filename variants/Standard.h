@@ -0,0 +1,7 @@
+/*==============================================================================
+    Standard hand variant. Five SG90 servos on the H13-H18 header pins.
+==============================================================================*/
+
+// The hand as built. Every option is left at the module default, which is
+// this hand, so this profile is empty. It is here so that each variant has
+// a header to copy from.
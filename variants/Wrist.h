@@ -0,0 +1,23 @@
+/*==============================================================================
+    Wrist variant. The standard hand plus a wrist rotation servo on RC0.
+==============================================================================*/
+
+// The wrist servo is channel 5, after the fingers, on RC0 (SERVO_PORTC adds
+// the LATC write to the servo ISR). It has no flex sensor, so it starts
+// centred and is turned by REMOTE_CHANNEL packets from the remote peer
+// (Remote.h), eg. ./remote_peer /dev/ttyUSB0 channel 5 200. Six servos are
+// started four at a time (SERVO_GROUPED), which keeps the current step at
+// the start of the frame down to what five servos drew before.
+
+#define SERVO_CHANNELS      6
+#define SERVO_PORTC         1
+#define SERVO_OUTPUT        SERVO_GROUPED
+#define SERVO_EXTRA_HOME    128
+
+#define SERVO_CHANNEL_TABLE { \
+    {SERVO_PORT_B, SERVOTHUMBMASK, SENSORTHUMB}, \
+    {SERVO_PORT_B, SERVOINDEXMASK, SENSORINDEX}, \
+    {SERVO_PORT_B, SERVOMIDDLEMASK, SENSORMIDDLE}, \
+    {SERVO_PORT_B, SERVORINGMASK, SENSORRING}, \
+    {SERVO_PORT_B, SERVOPINKIEMASK, SENSORPINKIE}, \
+    {SERVO_PORT_C, 0b00000001, SERVO_NO_SENSOR}}